@@ -0,0 +1,471 @@
+#include <WickedWinchProtocol/Message.h>
+#include <WickedWinchProtocol/MessageBatch.h>
+#include <WickedWinchProtocol/MessageDispatch.h>
+#include <WickedWinchProtocol/MessageFramer.h>
+#include <WickedWinchProtocol/Path.h>
+#include <WickedWinchProtocol/PathBuilder.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+namespace wickedwinch::protocol {
+namespace {
+
+// A batch of the status traffic a controller receives from its devices.
+MessageWriter StatusBatch(size_t messages) {
+  MessageWriter writer;
+  for (size_t i = 0; i < messages; ++i) {
+    uint8_t target = i % 8;
+    switch (i % 3) {
+    case 0:
+      writer.Write(target, WickedWinchStatus{uint32_t(i), uint32_t(i * 3), WickedWinchStatusFlag_PositionKnown});
+      break;
+    case 1:
+      writer.Write(target, WickedBmpStatus{uint32_t(i), 20.0f, 101325.0f});
+      break;
+    case 2:
+      writer.Write(target, WickedPingResponse{uint32_t(i), uint32_t(i)});
+      break;
+    }
+  }
+  return writer;
+}
+
+PathBuilder MakePath(size_t segments) {
+  PathBuilder builder;
+  for (size_t s = 0; s < segments; ++s) {
+    builder.BeginSegment(s * 1000);
+    builder.add_op(PostfixOp::PolyVec);
+    builder.add_i(4 << 1 | 1);
+    for (float c : {0.0f, 0.5f, 0.25f, -0.125f}) builder.add_f(c + 0.01f * s);
+  }
+  return builder;
+}
+
+void BM_MessageRead(benchmark::State& state) {
+  MessageWriter batch = StatusBatch(1024);
+  for (auto _ : state) {
+    std::span<const uint8_t> data = batch.data();
+    MessageReader reader;
+    uint32_t sum = 0;
+    while (reader.Read(data)) {
+      switch (reader.payload_type()) {
+      case WickedMessageType_NotifyWinchStatus:
+        sum += reader.winch_status().position;
+        break;
+      case WickedMessageType_NotifyBmpStatus:
+        sum += reader.bmp_status().device_time;
+        break;
+      case WickedMessageType_PingResponse:
+        sum += reader.ping_response().device_time;
+        break;
+      default:
+        break;
+      }
+      data = data.subspan(reader.data_size());
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * 1024);
+}
+BENCHMARK(BM_MessageRead);
+
+void BM_MessageWrite(benchmark::State& state) {
+  MessageWriter writer;
+  for (auto _ : state) {
+    writer.clear();
+    for (uint32_t i = 0; i < 1024; ++i) {
+      writer.Write(i % 8, WickedWinchStatus{i, i * 3, WickedWinchStatusFlag_PositionKnown});
+    }
+    benchmark::DoNotOptimize(writer.data().data());
+  }
+  state.SetItemsProcessed(state.iterations() * 1024);
+}
+BENCHMARK(BM_MessageWrite);
+
+// A set-path message from the host, copied out and read down to a segment
+// lookup.
+void BM_MessageReadPath(benchmark::State& state) {
+  MessageWriter writer;
+  writer.WriteWinchPath(1, WickedWinchMode_LinearPosition, MakePath(state.range(0)));
+  std::vector<uint8_t> buffer;
+  for (auto _ : state) {
+    MessageReader reader;
+    PathReader path;
+    bool ok = reader.Read(writer.data());
+    reader.CopyPathData(buffer);
+    ok = ok && path.Read(buffer);
+    benchmark::DoNotOptimize(ok);
+    benchmark::DoNotOptimize(path.SegmentAt(500));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MessageReadPath)->Arg(16)->Arg(256);
+
+void BM_MessageWritePath(benchmark::State& state) {
+  PathBuilder path = MakePath(state.range(0));
+  MessageWriter writer;
+  for (auto _ : state) {
+    writer.clear();
+    writer.WriteWinchPath(1, WickedWinchMode_LinearPosition, path);
+    benchmark::DoNotOptimize(writer.data().data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MessageWritePath)->Arg(16)->Arg(256);
+
+// Status messages with a 256-segment path message every 64 of them, as a
+// host and its devices exchange.
+struct MixedStream {
+  MixedStream() {
+    MessageWriter writer = StatusBatch(1024);
+    std::span<const uint8_t> status = writer.data();
+    MessageWriter path;
+    path.WriteWinchPath(1, WickedWinchMode_LinearPosition, MakePath(256));
+    MessageReader reader;
+    for (size_t i = 0; reader.Read(status); ++i) {
+      if (i % 64 == 0) {
+        data.insert(data.end(), path.data().begin(), path.data().end());
+        ++messages;
+      }
+      data.insert(data.end(), status.begin(), status.begin() + reader.data_size());
+      status = status.subspan(reader.data_size());
+      ++messages;
+    }
+  }
+
+  std::vector<uint8_t> data;
+  size_t messages = 0;
+};
+
+// Feeds a MixedStream over a local socket from a thread that keeps writing
+// it until stopped.
+class SocketFeed {
+public:
+  SocketFeed() {
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds_);
+    thread_ = std::thread([this] {
+      while (!stop_.load(std::memory_order_relaxed)) {
+        if (send(fds_[1], stream_.data.data(), stream_.data.size(), MSG_NOSIGNAL) < 0) break;
+      }
+    });
+  }
+
+  ~SocketFeed() {
+    stop_ = true;
+    // Fails the writer's blocked send.
+    shutdown(fds_[1], SHUT_RDWR);
+    thread_.join();
+    close(fds_[0]);
+    close(fds_[1]);
+  }
+
+  int fd() const { return fds_[0]; }
+  size_t stream_size() const { return stream_.data.size(); }
+  // Messages in one pass of the stream.
+  size_t messages() const { return stream_.messages; }
+
+private:
+  MixedStream stream_;
+  int fds_[2];
+  std::atomic<bool> stop_ = false;
+  std::thread thread_;
+};
+
+// Reads the socket straight into the framer's ring.
+void BM_MessageFramerSocket(benchmark::State& state) {
+  SocketFeed feed;
+  MessageFramer framer;
+  MessageReader reader;
+  size_t messages = 0;
+  uint32_t sum = 0;
+  for (auto _ : state) {
+    size_t end = messages + feed.messages();
+    while (messages < end) {
+      std::span<uint8_t> space = framer.write_span();
+      ssize_t size = read(feed.fd(), space.data(), space.size());
+      if (size <= 0) break;
+      framer.Commit(size);
+      for (std::span<const uint8_t> message = framer.Next(); !message.empty(); message = framer.Next()) {
+        if (reader.Read(message)) sum += reader.payload_size();
+        ++messages;
+      }
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * feed.messages());
+  state.SetBytesProcessed(state.iterations() * feed.stream_size());
+}
+BENCHMARK(BM_MessageFramerSocket)->UseRealTime();
+
+// Reassembly by appending each read to a vector and erasing whole messages
+// from its front, for comparison.
+void BM_MessageVectorSocket(benchmark::State& state) {
+  SocketFeed feed;
+  std::vector<uint8_t> pending;
+  uint8_t chunk[0x10000];
+  MessageReader reader;
+  size_t messages = 0;
+  uint32_t sum = 0;
+  for (auto _ : state) {
+    size_t end = messages + feed.messages();
+    while (messages < end) {
+      ssize_t size = read(feed.fd(), chunk, sizeof(chunk));
+      if (size <= 0) break;
+      pending.insert(pending.end(), chunk, chunk + size);
+      std::span<const uint8_t> data = pending;
+      while (reader.Read(data)) {
+        sum += reader.payload_size();
+        ++messages;
+        data = data.subspan(reader.data_size());
+      }
+      pending.erase(pending.begin(), pending.end() - data.size());
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * feed.messages());
+  state.SetBytesProcessed(state.iterations() * feed.stream_size());
+}
+BENCHMARK(BM_MessageVectorSocket)->UseRealTime();
+
+// The same stream from memory in fixed-size chunks, as a serial driver
+// delivers it, without the socket's cost.
+void BM_MessageFramerChunks(benchmark::State& state) {
+  MixedStream stream;
+  size_t chunk = state.range(0);
+  MessageFramer framer;
+  MessageReader reader;
+  uint32_t sum = 0;
+  for (auto _ : state) {
+    for (size_t offset = 0; offset < stream.data.size(); offset += chunk) {
+      framer.Push(std::span(stream.data).subspan(offset, std::min(chunk, stream.data.size() - offset)));
+      for (std::span<const uint8_t> message = framer.Next(); !message.empty(); message = framer.Next()) {
+        if (reader.Read(message)) sum += reader.payload_size();
+      }
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * stream.messages);
+  state.SetBytesProcessed(state.iterations() * stream.data.size());
+}
+BENCHMARK(BM_MessageFramerChunks)->Arg(64)->Arg(4096);
+
+void BM_MessageVectorChunks(benchmark::State& state) {
+  MixedStream stream;
+  size_t chunk = state.range(0);
+  std::vector<uint8_t> pending;
+  MessageReader reader;
+  uint32_t sum = 0;
+  for (auto _ : state) {
+    for (size_t offset = 0; offset < stream.data.size(); offset += chunk) {
+      auto begin = stream.data.begin() + offset;
+      pending.insert(pending.end(), begin, begin + std::min(chunk, stream.data.size() - offset));
+      std::span<const uint8_t> data = pending;
+      while (reader.Read(data)) {
+        sum += reader.payload_size();
+        data = data.subspan(reader.data_size());
+      }
+      pending.erase(pending.begin(), pending.end() - data.size());
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * stream.messages);
+  state.SetBytesProcessed(state.iterations() * stream.data.size());
+}
+BENCHMARK(BM_MessageVectorChunks)->Arg(64)->Arg(4096);
+
+// Drains a local socket from a thread, so writes to the other end measure
+// the sender's cost.
+class SocketSink {
+public:
+  SocketSink() {
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds_);
+    thread_ = std::thread([this] {
+      uint8_t chunk[0x10000];
+      while (read(fds_[0], chunk, sizeof(chunk)) > 0) {}
+    });
+  }
+
+  ~SocketSink() {
+    close(fds_[1]);
+    thread_.join();
+    close(fds_[0]);
+  }
+
+  int fd() const { return fds_[1]; }
+
+private:
+  int fds_[2];
+  std::thread thread_;
+};
+
+// A cue change: one serialized 16-segment path per target.
+std::vector<std::vector<uint8_t>> CuePaths(size_t targets) {
+  std::vector<std::vector<uint8_t>> paths;
+  for (size_t t = 0; t < targets; ++t) paths.push_back(MakePath(16).Write());
+  return paths;
+}
+
+// One message built and written per target. The writes counter is the
+// number of syscalls per cue.
+void BM_CueWritePerTarget(benchmark::State& state) {
+  std::vector<std::vector<uint8_t>> paths = CuePaths(state.range(0));
+  SocketSink sink;
+  MessageWriter writer;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    for (size_t t = 0; t < paths.size(); ++t) {
+      writer.clear();
+      writer.WriteWinchPath(t, WickedWinchMode_LinearPosition, paths[t]);
+      bytes += write(sink.fd(), writer.data().data(), writer.data().size());
+    }
+  }
+  state.counters["writes"] = paths.size();
+  state.SetItemsProcessed(state.iterations() * paths.size());
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_CueWritePerTarget)->Arg(16)->Arg(256)->UseRealTime();
+
+// Every target's message in one MessageBatch, flushed with one writev.
+void BM_CueWriteBatch(benchmark::State& state) {
+  std::vector<std::vector<uint8_t>> paths = CuePaths(state.range(0));
+  SocketSink sink;
+  MessageBatch batch;
+  size_t bytes = 0;
+  size_t writes = 0;
+  for (auto _ : state) {
+    batch.clear();
+    for (size_t t = 0; t < paths.size(); ++t) {
+      batch.AddWinchPath(t, WickedWinchMode_LinearPosition, paths[t]);
+    }
+    size_t flush_writes;
+    batch.Flush(sink.fd(), &flush_writes);
+    writes += flush_writes;
+    bytes += batch.data_size();
+  }
+  // Writes per cue.
+  state.counters["writes"] = benchmark::Counter(writes, benchmark::Counter::kAvgIterations);
+  state.SetItemsProcessed(state.iterations() * paths.size());
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_CueWriteBatch)->Arg(16)->Arg(256)->UseRealTime();
+
+// Sums a field of each message a controller typically handles.
+struct StatusHandler {
+  void operator()(MessageTag<WickedMessageType_NotifyWinchStatus>, uint8_t, const WickedWinchStatus& status) {
+    sum += status.position;
+  }
+  void operator()(MessageTag<WickedMessageType_NotifyBmpStatus>, uint8_t, const WickedBmpStatus& status) {
+    sum += status.device_time;
+  }
+  void operator()(MessageTag<WickedMessageType_PingResponse>, uint8_t, const WickedPingResponse& ping) {
+    sum += ping.device_time;
+  }
+  void operator()(MessageTag<WickedMessageType_SetWinchPath>, uint8_t, const MessageWinchPath& path) {
+    sum += path.path_data.size();
+  }
+
+  uint32_t sum = 0;
+};
+
+void BM_MessageDispatch(benchmark::State& state) {
+  std::vector<uint8_t> data;
+  if (state.range(0)) {
+    data = MixedStream().data;
+  } else {
+    MessageWriter batch = StatusBatch(1024);
+    data.assign(batch.data().begin(), batch.data().end());
+  }
+  size_t messages = 0;
+  for (auto _ : state) {
+    StatusHandler handler;
+    std::span<const uint8_t> rest = data;
+    while (size_t size = DispatchMessage(rest, handler)) {
+      rest = rest.subspan(size);
+      ++messages;
+    }
+    benchmark::DoNotOptimize(handler.sum);
+  }
+  state.SetItemsProcessed(messages);
+}
+BENCHMARK(BM_MessageDispatch)->ArgName("mixed")->Arg(0)->Arg(1);
+
+// The hand-written switch the dispatcher replaces, for comparison.
+void BM_MessageSwitch(benchmark::State& state) {
+  std::vector<uint8_t> data;
+  if (state.range(0)) {
+    data = MixedStream().data;
+  } else {
+    MessageWriter batch = StatusBatch(1024);
+    data.assign(batch.data().begin(), batch.data().end());
+  }
+  size_t messages = 0;
+  for (auto _ : state) {
+    uint32_t sum = 0;
+    std::span<const uint8_t> rest = data;
+    while (rest.size() >= sizeof(WickedMessageHeader)) {
+      WickedMessageHeader header;
+      std::memcpy(&header, rest.data(), sizeof(header));
+      size_t size = sizeof(header) + header.payload_size;
+      if (rest.size() < size) break;
+      const uint8_t* payload = rest.data() + sizeof(header);
+      bool ok = true;
+      switch (header.payload_type) {
+      case WickedMessageType_NotifyWinchStatus: {
+        WickedWinchStatus status = {};
+        ok = header.payload_size >= 9;
+        if (ok) {
+          std::memcpy(&status, payload, 9);
+          sum += status.position;
+        }
+        break;
+      }
+      case WickedMessageType_NotifyBmpStatus: {
+        WickedBmpStatus status;
+        ok = header.payload_size >= sizeof(status);
+        if (ok) {
+          std::memcpy(&status, payload, sizeof(status));
+          sum += status.device_time;
+        }
+        break;
+      }
+      case WickedMessageType_PingResponse: {
+        WickedPingResponse ping;
+        ok = header.payload_size >= sizeof(ping);
+        if (ok) {
+          std::memcpy(&ping, payload, sizeof(ping));
+          sum += ping.device_time;
+        }
+        break;
+      }
+      case WickedMessageType_SetWinchPath: {
+        uint16_t path_size = 0;
+        ok = header.payload_size >= 4;
+        if (ok) std::memcpy(&path_size, payload + 2, sizeof(path_size));
+        ok = ok && header.payload_size >= 4 + path_size;
+        if (ok) sum += path_size;
+        break;
+      }
+      default:
+        break;
+      }
+      if (!ok) break;
+      rest = rest.subspan(size);
+      ++messages;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(messages);
+}
+BENCHMARK(BM_MessageSwitch)->ArgName("mixed")->Arg(0)->Arg(1);
+
+}
+}
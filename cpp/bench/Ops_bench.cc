@@ -0,0 +1,214 @@
+#include <WickedWinchProtocol/PostfixBatch.h>
+#include <WickedWinchProtocol/PostfixProgram.h>
+#include <WickedWinchProtocol/Postfix.h>
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace wickedwinch::protocol {
+namespace {
+
+// Per-opcode microbenchmarks of the checked interpreter. Each iteration
+// restores the op's inputs and evaluates one op, so the reported time is ns
+// per op and items_per_second is ops per second.
+
+// Deterministic inputs in (0.1, 0.9), inside every op's domain.
+float Input(size_t i) {
+  return 0.1f + 0.05f * float((i * 7) % 16);
+}
+
+void RunOp(
+    benchmark::State& state, const PostfixWriter& writer, size_t input_size,
+    PostfixPrecision precision = PostfixPrecision::Exact) {
+  auto buffer = writer.Write();
+  PostfixReader reader;
+  if (!reader.Read(buffer)) {
+    state.SkipWithError("read failed");
+    return;
+  }
+
+  std::vector<float> inputs(input_size);
+  for (size_t i = 0; i < input_size; ++i) inputs[i] = Input(i);
+  std::vector<float> data(1024);
+  PostfixStack stack{
+    .stack_data     = data.data(),
+    .stack_size     = 0,
+    .stack_capacity = data.size(),
+  };
+  for (auto _ : state) {
+    std::copy(inputs.begin(), inputs.end(), data.begin());
+    stack.stack_size = input_size;
+    EvalStatus status = stack.Eval(reader, precision);
+    if (status != EvalStatus::Ok) {
+      state.SkipWithError("eval failed");
+      return;
+    }
+    benchmark::DoNotOptimize(data[0]);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+PostfixWriter Op(PostfixOp op, std::initializer_list<uint8_t> i = {}) {
+  PostfixWriter writer;
+  writer.add_op(op);
+  for (uint8_t v : i) writer.add_i(v);
+  return writer;
+}
+
+void BM_Push(benchmark::State& state) {
+  PostfixWriter writer;
+  writer.Push({1, 2});
+  RunOp(state, writer, 0);
+}
+BENCHMARK(BM_Push);
+
+void BM_StackOp(benchmark::State& state, PostfixOp op) {
+  uint8_t n = state.range(0);
+  RunOp(state, Op(op, {n}), n + 1);
+}
+BENCHMARK_CAPTURE(BM_StackOp, Pop, PostfixOp::Pop)->Arg(1)->Arg(16);
+BENCHMARK_CAPTURE(BM_StackOp, Dup, PostfixOp::Dup)->Arg(0)->Arg(15);
+BENCHMARK_CAPTURE(BM_StackOp, RotL, PostfixOp::RotL)->Arg(2)->Arg(16);
+BENCHMARK_CAPTURE(BM_StackOp, RotR, PostfixOp::RotR)->Arg(2)->Arg(16);
+BENCHMARK_CAPTURE(BM_StackOp, Rev, PostfixOp::Rev)->Arg(2)->Arg(16);
+
+void BM_Scalar(benchmark::State& state, PostfixOp op, size_t input_size) {
+  RunOp(state, Op(op), input_size);
+}
+BENCHMARK_CAPTURE(BM_Scalar, Add, PostfixOp::Add, 2);
+BENCHMARK_CAPTURE(BM_Scalar, Sub, PostfixOp::Sub, 2);
+BENCHMARK_CAPTURE(BM_Scalar, Mul, PostfixOp::Mul, 2);
+BENCHMARK_CAPTURE(BM_Scalar, MulAdd, PostfixOp::MulAdd, 3);
+BENCHMARK_CAPTURE(BM_Scalar, Div, PostfixOp::Div, 2);
+BENCHMARK_CAPTURE(BM_Scalar, Mod, PostfixOp::Mod, 2);
+BENCHMARK_CAPTURE(BM_Scalar, Neg, PostfixOp::Neg, 1);
+BENCHMARK_CAPTURE(BM_Scalar, Abs, PostfixOp::Abs, 1);
+BENCHMARK_CAPTURE(BM_Scalar, Inv, PostfixOp::Inv, 1);
+BENCHMARK_CAPTURE(BM_Scalar, Pow, PostfixOp::Pow, 2);
+BENCHMARK_CAPTURE(BM_Scalar, Sqrt, PostfixOp::Sqrt, 1);
+BENCHMARK_CAPTURE(BM_Scalar, Exp, PostfixOp::Exp, 1);
+BENCHMARK_CAPTURE(BM_Scalar, Ln, PostfixOp::Ln, 1);
+BENCHMARK_CAPTURE(BM_Scalar, Sin, PostfixOp::Sin, 1);
+BENCHMARK_CAPTURE(BM_Scalar, Cos, PostfixOp::Cos, 1);
+BENCHMARK_CAPTURE(BM_Scalar, Tan, PostfixOp::Tan, 1);
+BENCHMARK_CAPTURE(BM_Scalar, Asin, PostfixOp::Asin, 1);
+BENCHMARK_CAPTURE(BM_Scalar, Acos, PostfixOp::Acos, 1);
+BENCHMARK_CAPTURE(BM_Scalar, Atan2, PostfixOp::Atan2, 2);
+
+// The transcendental ops under each PostfixPrecision; the argument is the
+// precision value, so /0 is Exact and /1 is Fast.
+void BM_Precision(benchmark::State& state, PostfixOp op, size_t input_size) {
+  RunOp(state, Op(op), input_size, PostfixPrecision(state.range(0)));
+}
+#define PRECISIONS DenseRange(0, 1)
+BENCHMARK_CAPTURE(BM_Precision, Pow, PostfixOp::Pow, 2)->PRECISIONS;
+BENCHMARK_CAPTURE(BM_Precision, Exp, PostfixOp::Exp, 1)->PRECISIONS;
+BENCHMARK_CAPTURE(BM_Precision, Ln, PostfixOp::Ln, 1)->PRECISIONS;
+BENCHMARK_CAPTURE(BM_Precision, Sin, PostfixOp::Sin, 1)->PRECISIONS;
+BENCHMARK_CAPTURE(BM_Precision, Cos, PostfixOp::Cos, 1)->PRECISIONS;
+BENCHMARK_CAPTURE(BM_Precision, Tan, PostfixOp::Tan, 1)->PRECISIONS;
+BENCHMARK_CAPTURE(BM_Precision, Asin, PostfixOp::Asin, 1)->PRECISIONS;
+BENCHMARK_CAPTURE(BM_Precision, Acos, PostfixOp::Acos, 1)->PRECISIONS;
+BENCHMARK_CAPTURE(BM_Precision, Atan2, PostfixOp::Atan2, 2)->PRECISIONS;
+
+// The same ops on a batch stack, where the fast cores vectorize across lanes;
+// items are lane evaluations.
+void BM_PrecisionBatch(benchmark::State& state, PostfixOp op, size_t input_size) {
+  PostfixProgram program;
+  if (program.Verify(Op(op), input_size) != EvalStatus::Ok) {
+    state.SkipWithError("verify failed");
+    return;
+  }
+  auto precision = PostfixPrecision(state.range(0));
+  std::vector<float> inputs(input_size * kBatchLanes);
+  for (size_t i = 0; i < inputs.size(); ++i) inputs[i] = Input(i);
+  std::vector<float> data(16 * kBatchLanes);
+  PostfixBatchStack stack{
+    .stack_data     = data.data(),
+    .stack_size     = 0,
+    .stack_capacity = 16,
+  };
+  for (auto _ : state) {
+    std::copy(inputs.begin(), inputs.end(), data.begin());
+    stack.stack_size = input_size;
+    EvalStatus status = stack.Eval(program, precision);
+    benchmark::DoNotOptimize(status);
+    benchmark::DoNotOptimize(data[0]);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kBatchLanes);
+}
+BENCHMARK_CAPTURE(BM_PrecisionBatch, Pow, PostfixOp::Pow, 2)->PRECISIONS;
+BENCHMARK_CAPTURE(BM_PrecisionBatch, Exp, PostfixOp::Exp, 1)->PRECISIONS;
+BENCHMARK_CAPTURE(BM_PrecisionBatch, Ln, PostfixOp::Ln, 1)->PRECISIONS;
+BENCHMARK_CAPTURE(BM_PrecisionBatch, Sin, PostfixOp::Sin, 1)->PRECISIONS;
+BENCHMARK_CAPTURE(BM_PrecisionBatch, Cos, PostfixOp::Cos, 1)->PRECISIONS;
+BENCHMARK_CAPTURE(BM_PrecisionBatch, Tan, PostfixOp::Tan, 1)->PRECISIONS;
+BENCHMARK_CAPTURE(BM_PrecisionBatch, Asin, PostfixOp::Asin, 1)->PRECISIONS;
+BENCHMARK_CAPTURE(BM_PrecisionBatch, Acos, PostfixOp::Acos, 1)->PRECISIONS;
+BENCHMARK_CAPTURE(BM_PrecisionBatch, Atan2, PostfixOp::Atan2, 2)->PRECISIONS;
+#undef PRECISIONS
+
+// Vector ops take the size in the upper bits of their last int literal; the
+// inputs are already on the stack, so no literals are pushed.
+void BM_Vector(benchmark::State& state, PostfixOp op, uint8_t shift, size_t vectors, size_t scalars) {
+  uint8_t size = state.range(0);
+  RunOp(state, Op(op, {uint8_t(size << shift)}), vectors * size + scalars);
+}
+#define VECTOR_SIZES DenseRange(1, 4)->Arg(8)->Arg(16)
+BENCHMARK_CAPTURE(BM_Vector, PolyVec, PostfixOp::PolyVec, 1, 1, 1)->VECTOR_SIZES;
+BENCHMARK_CAPTURE(BM_Vector, AddVec, PostfixOp::AddVec, 1, 2, 0)->VECTOR_SIZES;
+BENCHMARK_CAPTURE(BM_Vector, SubVec, PostfixOp::SubVec, 1, 2, 0)->VECTOR_SIZES;
+BENCHMARK_CAPTURE(BM_Vector, MulVec, PostfixOp::MulVec, 1, 2, 0)->VECTOR_SIZES;
+BENCHMARK_CAPTURE(BM_Vector, MulAddVec, PostfixOp::MulAddVec, 2, 3, 0)->VECTOR_SIZES;
+BENCHMARK_CAPTURE(BM_Vector, ScaleVec, PostfixOp::ScaleVec, 1, 1, 1)->VECTOR_SIZES;
+BENCHMARK_CAPTURE(BM_Vector, NegVec, PostfixOp::NegVec, 1, 1, 0)->VECTOR_SIZES;
+BENCHMARK_CAPTURE(BM_Vector, NormVec, PostfixOp::NormVec, 1, 1, 0)->VECTOR_SIZES;
+BENCHMARK_CAPTURE(BM_Vector, Lerp, PostfixOp::Lerp, 2, 2, 1)->VECTOR_SIZES;
+#undef VECTOR_SIZES
+
+// Square n x n matrices.
+void BM_Transpose(benchmark::State& state) {
+  uint8_t n = state.range(0);
+  RunOp(state, Op(PostfixOp::Transpose, {n, uint8_t(n << 1)}), n * n);
+}
+BENCHMARK(BM_Transpose)->DenseRange(2, 8);
+
+void BM_PolyMat(benchmark::State& state) {
+  uint8_t n = state.range(0);
+  RunOp(state, Op(PostfixOp::PolyMat, {n, uint8_t(n << 1)}), n * n + 1);
+}
+BENCHMARK(BM_PolyMat)->DenseRange(2, 8);
+
+// Cubic and quintic segments with 3 to 6 output columns, the common motion
+// path shapes.
+void BM_PolyMatShape(benchmark::State& state) {
+  uint8_t rows = state.range(0);
+  uint8_t cols = state.range(1);
+  RunOp(state, Op(PostfixOp::PolyMat, {rows, uint8_t(cols << 1)}), rows * cols + 1);
+}
+BENCHMARK(BM_PolyMatShape)->ArgsProduct({{4, 6}, {3, 4, 6}});
+
+void BM_MulMat(benchmark::State& state) {
+  uint8_t n = state.range(0);
+  RunOp(state, Op(PostfixOp::MulMat, {n, n, uint8_t(n << 1)}), 2 * n * n);
+}
+BENCHMARK(BM_MulMat)->DenseRange(2, 8);
+
+// A rows x 2 table pushed as literals, looked up at a time inside the table.
+// Rows are limited to 255 by the uint8 row count.
+void BM_Lut(benchmark::State& state) {
+  uint8_t rows = state.range(0);
+  PostfixWriter writer = Op(PostfixOp::Lut, {rows, 2 << 1 | 1});
+  for (uint8_t i = 0; i < rows; ++i) {
+    writer.add_f(float(i) / rows);
+    writer.add_f(Input(i));
+  }
+  RunOp(state, writer, 1);
+}
+BENCHMARK(BM_Lut)->RangeMultiplier(2)->Range(2, 128)->Arg(255);
+
+}
+}
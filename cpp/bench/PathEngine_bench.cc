@@ -0,0 +1,78 @@
+#include <WickedWinchProtocol/PathEngine.h>
+#include <WickedWinchProtocol/Path.h>
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace wickedwinch::protocol {
+namespace {
+
+constexpr uint32_t kSegmentDuration = 1000;
+
+// Winch-like targets run a cubic and a 3D lerp; every fourth target is a
+// heavier pendulum-like segment with trigonometry, so costs are uneven.
+std::vector<uint8_t> MakeTargetPath(size_t target) {
+  PathWriter writer;
+  writer.set_target(target);
+  for (size_t s = 0; s < 16; ++s) {
+    PathSegmentWriter* segment = writer.add_segments();
+    segment->start_time = s * kSegmentDuration;
+    PostfixWriter& expr = segment->expr;
+    if (target % 4 == 3) {
+      for (int k = 0; k < 8; ++k) {
+        expr.add_op(PostfixOp::Dup);
+        expr.add_i(0);
+        expr.add_op(PostfixOp::Sin);
+        expr.add_op(PostfixOp::Cos);
+        expr.add_op(PostfixOp::Add);
+      }
+    } else {
+      expr.add_op(PostfixOp::PolyVec);
+      expr.add_i(4 << 1 | 1);
+      for (float c : {0.0f, 0.5f, 0.25f, -0.125f}) expr.add_f(c + 0.01f * s);
+      expr.add_op(PostfixOp::Lerp);
+      expr.add_i(3 << 2 | 2);
+      for (float v : {0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f}) expr.add_f(v);
+    }
+  }
+  return writer.Write();
+}
+
+// One tick over range(1) targets with range(0) workers; items are target
+// evaluations. latency_us is the mean Eval latency the engine reports.
+void BM_PathEngineTick(benchmark::State& state) {
+  size_t workers = state.range(0);
+  size_t targets = state.range(1);
+  std::vector<std::vector<uint8_t>> buffers;
+  PathEngine engine(workers);
+  for (size_t i = 0; i < targets; ++i) {
+    buffers.push_back(MakeTargetPath(i));
+    PathReader reader;
+    if (!reader.Read(buffers.back())) {
+      state.SkipWithError("read failed");
+      return;
+    }
+    engine.AddTarget(reader);
+  }
+
+  uint32_t t = 0;
+  double latency = 0;
+  for (auto _ : state) {
+    PathEngineStats stats = engine.Eval(t);
+    if (stats.failed != 0) {
+      state.SkipWithError("eval failed");
+      return;
+    }
+    latency += stats.latency.count();
+    t = (t + 1) % (16 * kSegmentDuration);
+  }
+  state.SetItemsProcessed(state.iterations() * targets);
+  state.counters["latency_us"] = latency * 1e-3 / state.iterations();
+}
+BENCHMARK(BM_PathEngineTick)
+    ->ArgsProduct({{1, 2, 4, 8, 16, 32, 64}, {64, 512}})
+    ->UseRealTime();
+
+}
+}
@@ -0,0 +1,393 @@
+#include <WickedWinchProtocol/Path.h>
+#include <WickedWinchProtocol/PathBuilder.h>
+#include <WickedWinchProtocol/PathEditor.h>
+#include <WickedWinchProtocol/PathIndex.h>
+#include <WickedWinchProtocol/PathProgram.h>
+#include <WickedWinchProtocol/PathSlot.h>
+#include <WickedWinchProtocol/Postfix.h>
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace wickedwinch::protocol {
+namespace {
+
+constexpr uint32_t kSegmentDuration = 1000;
+
+// A path of back-to-back segments, each a cubic in segment time followed by
+// a 2D lerp, similar to what a host sends for a smooth move.
+template <typename Expr>
+void AddSegmentExpr(Expr& expr, size_t s) {
+  expr.add_op(PostfixOp::PolyVec);
+  expr.add_i(4 << 1 | 1);
+  for (float c : {0.0f, 0.5f, 0.25f, -0.125f}) expr.add_f(c + 0.01f * s);
+  expr.add_op(PostfixOp::Lerp);
+  expr.add_i(2 << 2 | 2);
+  for (float v : {0.0f, 1.0f, 2.0f, 3.0f}) expr.add_f(v);
+}
+
+std::vector<uint8_t> MakePath(size_t segments) {
+  PathWriter writer;
+  writer.set_target(1);
+  for (size_t s = 0; s < segments; ++s) {
+    PathSegmentWriter* segment = writer.add_segments();
+    segment->start_time = s * kSegmentDuration;
+    AddSegmentExpr(segment->expr, s);
+  }
+  return writer.Write();
+}
+
+// Sample times visiting every segment in a scattered order, so the segment
+// search does not benefit from repeatedly hitting one segment.
+std::vector<uint32_t> SampleTimes(size_t segments) {
+  std::vector<uint32_t> times(1024);
+  uint32_t end = segments * kSegmentDuration;
+  for (size_t i = 0; i < times.size(); ++i) {
+    times[i] = (i * 7919 * 13) % end;
+  }
+  return times;
+}
+
+// Sample times stepping forward 1 ms at a time through the whole path, as
+// playback at 1 kHz does.
+std::vector<uint32_t> PlaybackTimes(size_t segments) {
+  std::vector<uint32_t> times(segments * kSegmentDuration);
+  for (size_t i = 0; i < times.size(); ++i) times[i] = i;
+  return times;
+}
+
+void BM_PathSegmentAt(benchmark::State& state) {
+  size_t segments = state.range(0);
+  std::vector<uint8_t> buffer = MakePath(segments);
+  PathReader reader;
+  if (!reader.Read(buffer)) {
+    state.SkipWithError("read failed");
+    return;
+  }
+  std::vector<uint32_t> times = SampleTimes(segments);
+
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(reader.SegmentAt(times[i]));
+    i = (i + 1) % times.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PathSegmentAt)->RangeMultiplier(4)->Range(1, 64)->Arg(128)->Arg(255)->Arg(1024)->Arg(4096)->Arg(16384)->Arg(100000);
+
+// Scattered seeks, as when scrubbing a timeline, answered by a PathIndex.
+void BM_PathSegmentAtIndexed(benchmark::State& state) {
+  size_t segments = state.range(0);
+  std::vector<uint8_t> buffer = MakePath(segments);
+  PathReader reader;
+  if (!reader.Read(buffer)) {
+    state.SkipWithError("read failed");
+    return;
+  }
+  PathIndex index;
+  index.Build(reader);
+  std::vector<uint32_t> times = SampleTimes(segments);
+
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(index.SegmentAt(times[i]));
+    i = (i + 1) % times.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PathSegmentAtIndexed)->RangeMultiplier(4)->Range(1, 64)->Arg(255)->Arg(1024)->Arg(4096)->Arg(16384)->Arg(100000);
+
+// Building and serializing a path from scratch, as a host does for every
+// path it sends.
+void BM_PathWriterBuild(benchmark::State& state) {
+  size_t segments = state.range(0);
+  for (auto _ : state) {
+    PathWriter writer;
+    for (size_t s = 0; s < segments; ++s) {
+      PathSegmentWriter* segment = writer.add_segments();
+      segment->start_time = s * kSegmentDuration;
+      AddSegmentExpr(segment->expr, s);
+    }
+    std::vector<uint8_t> buffer = writer.Write();
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  state.SetItemsProcessed(state.iterations() * segments);
+}
+BENCHMARK(BM_PathWriterBuild)->Arg(1)->Arg(16)->Arg(200);
+
+void BM_PathBuilderBuild(benchmark::State& state) {
+  size_t segments = state.range(0);
+  PathBuilder builder;
+  std::vector<uint8_t> buffer;
+  for (auto _ : state) {
+    builder.reset();
+    for (size_t s = 0; s < segments; ++s) {
+      builder.BeginSegment(s * kSegmentDuration);
+      AddSegmentExpr(builder, s);
+    }
+    builder.Write(buffer);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  state.SetItemsProcessed(state.iterations() * segments);
+}
+BENCHMARK(BM_PathBuilderBuild)->Arg(1)->Arg(16)->Arg(200);
+
+// A rolling window of segments: every step adds one segment at the end and
+// drops the one that expired, either by rebuilding the whole path or by
+// editing it in place.
+void BM_PathRollingRebuild(benchmark::State& state) {
+  size_t segments = state.range(0);
+  PathBuilder builder;
+  std::vector<uint8_t> buffer;
+  size_t first = 0;
+  for (auto _ : state) {
+    ++first;
+    builder.reset();
+    for (size_t s = first; s < first + segments; ++s) {
+      builder.BeginSegment(s * kSegmentDuration);
+      AddSegmentExpr(builder, s);
+    }
+    builder.Write(buffer);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PathRollingRebuild)->Arg(16)->Arg(200);
+
+// Appends and trims one segment per step, reading the path back every
+// range(1) steps.
+void BM_PathRollingEdit(benchmark::State& state) {
+  size_t segments = state.range(0);
+  size_t read_every = state.range(1);
+  PathEditor editor;
+  PostfixWriter expr;
+  for (size_t s = 0; s < segments; ++s) {
+    expr.clear();
+    AddSegmentExpr(expr, s);
+    editor.Append(s * kSegmentDuration, expr);
+  }
+  size_t next = segments;
+  for (auto _ : state) {
+    expr.clear();
+    AddSegmentExpr(expr, next);
+    editor.Append(next * kSegmentDuration, expr);
+    editor.Trim((next - segments + 1) * kSegmentDuration);
+    if (next % read_every == 0) benchmark::DoNotOptimize(editor.data().data());
+    ++next;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PathRollingEdit)
+    ->Args({16, 1})->Args({200, 1})->Args({1000, 1})
+    ->Args({200, 64})->Args({1000, 64});
+
+// Playback order, with and without a cursor.
+void BM_PathSegmentAtPlayback(benchmark::State& state, bool use_cursor) {
+  size_t segments = state.range(0);
+  std::vector<uint8_t> buffer = MakePath(segments);
+  PathReader reader;
+  if (!reader.Read(buffer)) {
+    state.SkipWithError("read failed");
+    return;
+  }
+  std::vector<uint32_t> times = PlaybackTimes(segments);
+
+  PathCursor cursor;
+  size_t i = 0;
+  for (auto _ : state) {
+    if (use_cursor) {
+      benchmark::DoNotOptimize(reader.SegmentAt(times[i], cursor));
+    } else {
+      benchmark::DoNotOptimize(reader.SegmentAt(times[i]));
+    }
+    if (++i == times.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_PathSegmentAtPlayback, Search, false)->RangeMultiplier(4)->Range(1, 64)->Arg(255);
+BENCHMARK_CAPTURE(BM_PathSegmentAtPlayback, Cursor, true)->RangeMultiplier(4)->Range(1, 64)->Arg(255);
+
+void BM_PathEval(benchmark::State& state) {
+  size_t segments = state.range(0);
+  std::vector<uint8_t> buffer = MakePath(segments);
+  PathReader reader;
+  if (!reader.Read(buffer)) {
+    state.SkipWithError("read failed");
+    return;
+  }
+  std::vector<uint32_t> times = SampleTimes(segments);
+
+  float data[16];
+  PostfixStack stack{
+    .stack_data     = data,
+    .stack_size     = 0,
+    .stack_capacity = std::size(data),
+  };
+  size_t i = 0;
+  for (auto _ : state) {
+    EvalStatus status = reader.Eval(times[i], stack);
+    if (status != EvalStatus::Ok) {
+      state.SkipWithError("eval failed");
+      return;
+    }
+    benchmark::DoNotOptimize(data[0]);
+    i = (i + 1) % times.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PathEval)->RangeMultiplier(4)->Range(1, 64)->Arg(128)->Arg(255)->Arg(100000);
+
+void BM_PathEvalLoaded(benchmark::State& state) {
+  size_t segments = state.range(0);
+  std::vector<uint8_t> buffer = MakePath(segments);
+  PathReader reader;
+  if (!reader.Read(buffer)) {
+    state.SkipWithError("read failed");
+    return;
+  }
+  PathProgram program;
+  program.Load(reader);
+  std::vector<uint32_t> times = SampleTimes(segments);
+
+  float data[16];
+  PostfixStack stack{
+    .stack_data     = data,
+    .stack_size     = 0,
+    .stack_capacity = std::size(data),
+  };
+  size_t i = 0;
+  for (auto _ : state) {
+    EvalStatus status = program.Eval(times[i], stack);
+    if (status != EvalStatus::Ok) {
+      state.SkipWithError("eval failed");
+      return;
+    }
+    benchmark::DoNotOptimize(data[0]);
+    i = (i + 1) % times.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PathEvalLoaded)->RangeMultiplier(4)->Range(1, 64)->Arg(128)->Arg(255)->Arg(100000);
+
+// As BM_PathEvalLoaded, reading the path through a PathSlot guard.
+void BM_PathSlotEval(benchmark::State& state) {
+  size_t segments = state.range(0);
+  PathSlot slot(1);
+  if (!slot.Publish(MakePath(segments))) {
+    state.SkipWithError("publish failed");
+    return;
+  }
+  std::vector<uint32_t> times = SampleTimes(segments);
+
+  float data[16];
+  PostfixStack stack{
+    .stack_data     = data,
+    .stack_size     = 0,
+    .stack_capacity = std::size(data),
+  };
+  size_t i = 0;
+  for (auto _ : state) {
+    PathSlot::Guard path = slot.Read(0);
+    EvalStatus status = path->Eval(times[i], stack);
+    if (status != EvalStatus::Ok) {
+      state.SkipWithError("eval failed");
+      return;
+    }
+    benchmark::DoNotOptimize(data[0]);
+    i = (i + 1) % times.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PathSlotEval)->RangeMultiplier(4)->Range(1, 64)->Arg(255);
+
+// Validating, loading and publishing an upload, as the I/O thread does.
+void BM_PathSlotPublish(benchmark::State& state) {
+  size_t segments = state.range(0);
+  std::vector<uint8_t> buffer = MakePath(segments);
+  PathSlot slot(4);
+  for (auto _ : state) {
+    if (!slot.Publish(buffer)) {
+      state.SkipWithError("publish failed");
+      return;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PathSlotPublish)->Arg(1)->Arg(16)->Arg(255);
+
+// Renders 1 s of 1 kHz frames of the 2D output, the way an output loop
+// does: one Eval per tick, or one sampler Fill. Items are frames.
+constexpr size_t kFrames = 1000;
+
+void BM_PathTicks(benchmark::State& state) {
+  size_t segments = state.range(0);
+  std::vector<uint8_t> buffer = MakePath(segments);
+  PathReader reader;
+  if (!reader.Read(buffer)) {
+    state.SkipWithError("read failed");
+    return;
+  }
+  PathProgram program;
+  program.Load(reader);
+
+  float data[16];
+  PostfixStack stack{
+    .stack_data     = data,
+    .stack_size     = 0,
+    .stack_capacity = std::size(data),
+  };
+  std::vector<float> out(kFrames * 2);
+  uint32_t end = segments * kSegmentDuration;
+  uint32_t start = 0;
+  for (auto _ : state) {
+    PathCursor cursor;
+    for (size_t i = 0; i < kFrames; ++i) {
+      if (program.Eval((start + i) % end, cursor, stack) != EvalStatus::Ok) {
+        state.SkipWithError("eval failed");
+        return;
+      }
+      std::copy(data, data + 2, &out[i * 2]);
+    }
+    benchmark::DoNotOptimize(out.data());
+    start = (start + kFrames) % end;
+  }
+  state.SetItemsProcessed(state.iterations() * kFrames);
+}
+BENCHMARK(BM_PathTicks)->Arg(1)->Arg(4)->Arg(64);
+
+void BM_PathSampler(benchmark::State& state) {
+  size_t segments = state.range(0);
+  std::vector<uint8_t> buffer = MakePath(segments);
+  PathReader reader;
+  if (!reader.Read(buffer)) {
+    state.SkipWithError("read failed");
+    return;
+  }
+  PathProgram program;
+  program.Load(reader);
+
+  std::vector<float> data(16 * kBatchLanes);
+  PostfixBatchStack stack{
+    .stack_data     = data.data(),
+    .stack_size     = 0,
+    .stack_capacity = 16,
+  };
+  std::vector<float> out(kFrames * 2);
+  uint32_t end = segments * kSegmentDuration;
+  uint32_t start = 0;
+  for (auto _ : state) {
+    PathSampler sampler(program, start, 1, 2);
+    if (sampler.Fill(out, stack) != EvalStatus::Ok) {
+      state.SkipWithError("fill failed");
+      return;
+    }
+    benchmark::DoNotOptimize(out.data());
+    start = (start + kFrames) % end;
+  }
+  state.SetItemsProcessed(state.iterations() * kFrames);
+}
+BENCHMARK(BM_PathSampler)->Arg(1)->Arg(4)->Arg(64);
+
+}
+}
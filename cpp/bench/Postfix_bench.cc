@@ -0,0 +1,198 @@
+#include <WickedWinchProtocol/Postfix.h>
+#include <WickedWinchProtocol/PostfixBatch.h>
+#include <WickedWinchProtocol/PostfixProgram.h>
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace wickedwinch::protocol {
+namespace {
+
+struct BenchStack : PostfixStack {
+  std::vector<float> buffer;
+
+  explicit BenchStack(size_t capacity) : buffer(capacity) {
+    stack_data = buffer.data();
+    stack_size = 0;
+    stack_capacity = buffer.size();
+  }
+};
+
+// A stream that alternates between vector, matrix and scalar ops, which is the
+// worst case for a single shared dispatch branch.
+PostfixWriter MixedExpr() {
+  PostfixWriter writer;
+  for (int block = 0; block < 4; ++block) {
+    writer.add_op(PostfixOp::Dup);
+    writer.add_i(0);
+    writer.add_op(PostfixOp::PolyMat);
+    writer.add_i(4);
+    writer.add_i(3 << 1 | 1);
+    for (int i = 0; i < 12; ++i) writer.add_f(0.1f * i);
+    writer.add_op(PostfixOp::Lerp);
+    writer.add_i(1 << 2 | 2);
+    writer.add_f(-1);
+    writer.add_f(1);
+    writer.add_op(PostfixOp::Add);
+    writer.add_op(PostfixOp::Add);
+    writer.add_op(PostfixOp::Lut);
+    writer.add_i(3);
+    writer.add_i(2 << 1 | 1);
+    for (float f : {0.0f, 0.0f, 1.0f, 0.5f, 2.0f, 0.25f}) writer.add_f(f);
+    writer.add_op(PostfixOp::Mul);
+    writer.add_op(PostfixOp::Sin);
+    writer.add_op(PostfixOp::Abs);
+  }
+  return writer;
+}
+
+// Cheap scalar ops only, so dispatch dominates.
+PostfixWriter ScalarExpr() {
+  PostfixWriter writer;
+  for (int block = 0; block < 8; ++block) {
+    writer.Push({1.5f});
+    writer.add_op(PostfixOp::Mul);
+    writer.add_op(PostfixOp::Neg);
+    writer.Push({0.25f});
+    writer.add_op(PostfixOp::Add);
+    writer.add_op(PostfixOp::Abs);
+  }
+  return writer;
+}
+
+enum class Mode {
+  Checked,
+  Verified,
+  Fused,
+};
+
+void RunExpr(benchmark::State& state, const PostfixWriter& writer, Mode mode) {
+  auto buffer = writer.Write();
+  PostfixReader reader;
+  reader.Read(buffer);
+  PostfixProgram program;
+  if (program.Verify(reader, 1) != EvalStatus::Ok) {
+    state.SkipWithError("verify failed");
+    return;
+  }
+  if (mode == Mode::Fused) {
+    PostfixFusionStats stats = program.Fuse();
+    state.counters["instrs"] = double(stats.output_instrs);
+  }
+  bool verified = mode != Mode::Checked;
+
+  BenchStack stack(64);
+  float t = 0;
+  for (auto _ : state) {
+    stack.clear();
+    stack.push(t);
+    EvalStatus status = verified ? stack.Eval(program) : stack.Eval(reader);
+    benchmark::DoNotOptimize(status);
+    benchmark::DoNotOptimize(stack.stack_data[0]);
+    t += 1e-3f;
+  }
+  state.SetItemsProcessed(state.iterations() * reader.op_size());
+}
+
+// Evaluates kBatchLanes samples per iteration; items are samples.
+void RunExprBatch(benchmark::State& state, const PostfixWriter& writer) {
+  PostfixProgram program;
+  if (program.Verify(writer, 1) != EvalStatus::Ok) {
+    state.SkipWithError("verify failed");
+    return;
+  }
+  program.Fuse();
+
+  std::vector<float> buffer(64 * kBatchLanes);
+  PostfixBatchStack stack{
+    .stack_data     = buffer.data(),
+    .stack_size     = 0,
+    .stack_capacity = 64,
+  };
+  float t = 0;
+  for (auto _ : state) {
+    stack.clear();
+    float* st = stack.slot(stack.stack_size++);
+    for (size_t l = 0; l < kBatchLanes; ++l) st[l] = t + 1e-3f * l;
+    EvalStatus status = stack.Eval(program);
+    benchmark::DoNotOptimize(status);
+    benchmark::DoNotOptimize(stack.stack_data[0]);
+    t += 1e-2f;
+  }
+  state.SetItemsProcessed(state.iterations() * kBatchLanes);
+}
+
+void RunExprSamples(benchmark::State& state, const PostfixWriter& writer) {
+  PostfixProgram program;
+  if (program.Verify(writer, 1) != EvalStatus::Ok) {
+    state.SkipWithError("verify failed");
+    return;
+  }
+  program.Fuse();
+
+  BenchStack stack(64);
+  float t = 0;
+  for (auto _ : state) {
+    stack.clear();
+    stack.push(t);
+    EvalStatus status = stack.Eval(program);
+    benchmark::DoNotOptimize(status);
+    benchmark::DoNotOptimize(stack.stack_data[0]);
+    t += 1e-3f;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_EvalMixed(benchmark::State& state) {
+  RunExpr(state, MixedExpr(), Mode::Checked);
+}
+BENCHMARK(BM_EvalMixed);
+
+void BM_EvalMixedVerified(benchmark::State& state) {
+  RunExpr(state, MixedExpr(), Mode::Verified);
+}
+BENCHMARK(BM_EvalMixedVerified);
+
+void BM_EvalMixedFused(benchmark::State& state) {
+  RunExpr(state, MixedExpr(), Mode::Fused);
+}
+BENCHMARK(BM_EvalMixedFused);
+
+void BM_EvalScalar(benchmark::State& state) {
+  RunExpr(state, ScalarExpr(), Mode::Checked);
+}
+BENCHMARK(BM_EvalScalar);
+
+void BM_EvalScalarVerified(benchmark::State& state) {
+  RunExpr(state, ScalarExpr(), Mode::Verified);
+}
+BENCHMARK(BM_EvalScalarVerified);
+
+void BM_EvalScalarFused(benchmark::State& state) {
+  RunExpr(state, ScalarExpr(), Mode::Fused);
+}
+BENCHMARK(BM_EvalScalarFused);
+
+void BM_SamplesMixed(benchmark::State& state) {
+  RunExprSamples(state, MixedExpr());
+}
+BENCHMARK(BM_SamplesMixed);
+
+void BM_SamplesMixedBatch(benchmark::State& state) {
+  RunExprBatch(state, MixedExpr());
+}
+BENCHMARK(BM_SamplesMixedBatch);
+
+void BM_SamplesScalar(benchmark::State& state) {
+  RunExprSamples(state, ScalarExpr());
+}
+BENCHMARK(BM_SamplesScalar);
+
+void BM_SamplesScalarBatch(benchmark::State& state) {
+  RunExprBatch(state, ScalarExpr());
+}
+BENCHMARK(BM_SamplesScalarBatch);
+
+}
+}
@@ -0,0 +1,61 @@
+#include <WickedWinchProtocol/Postfix.h>
+#include <WickedWinchProtocol/Simd.h>
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace wickedwinch::protocol {
+namespace {
+
+// Vector ops at each SimdLevel the CPU supports. The first argument is the
+// vector size, the second the SimdLevel.
+void RunVectorOp(benchmark::State& state, PostfixOp op, uint8_t shift, size_t vectors, size_t scalars) {
+  uint8_t size = state.range(0);
+  SimdLevel level = SimdLevel(state.range(1));
+  if (level > SupportedSimdLevel()) {
+    state.SkipWithError("not supported");
+    return;
+  }
+  SetSimdLevel(level);
+
+  PostfixWriter writer;
+  writer.add_op(op);
+  writer.add_i(uint8_t(size << shift));
+  auto buffer = writer.Write();
+  PostfixReader reader;
+  reader.Read(buffer);
+
+  size_t input_size = vectors * size + scalars;
+  std::vector<float> inputs(input_size);
+  for (size_t i = 0; i < input_size; ++i) inputs[i] = 0.5f + 0.01f * i;
+  std::vector<float> data(2 * input_size);
+  PostfixStack stack{
+    .stack_data     = data.data(),
+    .stack_size     = 0,
+    .stack_capacity = data.size(),
+  };
+  for (auto _ : state) {
+    std::copy(inputs.begin(), inputs.end(), data.begin());
+    stack.stack_size = input_size;
+    benchmark::DoNotOptimize(stack.Eval(reader));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel(level == SimdLevel::Avx2 ? "avx2" : level == SimdLevel::Sse ? "sse" : "scalar");
+  SetSimdLevel(SupportedSimdLevel());
+}
+
+#define SIMD_ARGS ArgsProduct({{4, 16, 63}, {0, 1, 2}})
+BENCHMARK_CAPTURE(RunVectorOp, AddVec, PostfixOp::AddVec, 1, 2, 0)->SIMD_ARGS;
+BENCHMARK_CAPTURE(RunVectorOp, SubVec, PostfixOp::SubVec, 1, 2, 0)->SIMD_ARGS;
+BENCHMARK_CAPTURE(RunVectorOp, MulVec, PostfixOp::MulVec, 1, 2, 0)->SIMD_ARGS;
+BENCHMARK_CAPTURE(RunVectorOp, MulAddVec, PostfixOp::MulAddVec, 2, 3, 0)->SIMD_ARGS;
+BENCHMARK_CAPTURE(RunVectorOp, ScaleVec, PostfixOp::ScaleVec, 1, 1, 1)->SIMD_ARGS;
+BENCHMARK_CAPTURE(RunVectorOp, NegVec, PostfixOp::NegVec, 1, 1, 0)->SIMD_ARGS;
+BENCHMARK_CAPTURE(RunVectorOp, NormVec, PostfixOp::NormVec, 1, 1, 0)->SIMD_ARGS;
+BENCHMARK_CAPTURE(RunVectorOp, Lerp, PostfixOp::Lerp, 2, 2, 1)->SIMD_ARGS;
+#undef SIMD_ARGS
+
+}
+}
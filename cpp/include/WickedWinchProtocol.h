@@ -2,4 +2,18 @@
 
 #include <WickedWinchProtocol/EvalStatus.h>
 #include <WickedWinchProtocol/Postfix.h>
+#include <WickedWinchProtocol/PostfixProgram.h>
+#include <WickedWinchProtocol/PostfixBatch.h>
+#include <WickedWinchProtocol/PostfixOptimize.h>
 #include <WickedWinchProtocol/Path.h>
+#include <WickedWinchProtocol/PathIndex.h>
+#include <WickedWinchProtocol/PathProgram.h>
+#include <WickedWinchProtocol/PathEngine.h>
+#include <WickedWinchProtocol/PathSlot.h>
+#include <WickedWinchProtocol/PathBuilder.h>
+#include <WickedWinchProtocol/PathEditor.h>
+#include <WickedWinchProtocol/Message.h>
+#include <WickedWinchProtocol/MessageFramer.h>
+#include <WickedWinchProtocol/MessageBatch.h>
+#include <WickedWinchProtocol/MessageDispatch.h>
+#include <WickedWinchProtocol/Simd.h>
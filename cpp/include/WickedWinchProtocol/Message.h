@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Path.h"
+#include "PathBuilder.h"
+
+#include <WickedMessage.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace wickedwinch::protocol {
+
+// The size of a message type's payload, or of the fixed part before its
+// trailing array. Fields are packed as the Go encoder writes them, so
+// WickedWinchStatus is 9 bytes rather than sizeof's 12. Returns 0 for types
+// without a payload and for unknown types.
+size_t MessagePayloadMinSize(WickedMessageType type);
+
+// A bounds-checked view of one message at the start of a buffer. Read checks
+// the header, that the payload fits in the buffer, and that the payload of a
+// known type holds its fixed part and every trailing array it declares, so
+// the accessors need no further checks. Messages of unknown types are
+// accepted with an opaque payload.
+//
+// Fixed payloads are returned by value, as their fields may be unaligned in
+// the buffer and may be shorter than the C struct; trailing arrays and path
+// data are views into the buffer. Each accessor returns an empty value if the
+// message's type does not carry it. The reader must not outlive the buffer.
+class MessageReader {
+public:
+  bool Read(std::span<const uint8_t> buffer) { return Read(buffer.data(), buffer.size()); }
+  bool Read(const uint8_t* data, size_t size);
+
+  const WickedMessageHeader& header() const { return header_; }
+  uint8_t target_id() const { return header_.target_id; }
+  WickedMessageType payload_type() const { return WickedMessageType(header_.payload_type); }
+  uint16_t payload_size() const { return header_.payload_size; }
+  std::span<const uint8_t> payload() const { return {payload_, header_.payload_size}; }
+  // The size of the whole message, which is where the next one starts.
+  size_t data_size() const { return sizeof(WickedMessageHeader) + header_.payload_size; }
+
+  WickedPingRequest ping_request() const;
+  WickedPingResponse ping_response() const;
+  WickedBmpStatus bmp_status() const;
+  WickedWinchStatus winch_status() const;
+  // Get or set winch config.
+  WickedWinchConfig winch_config() const;
+  // Get winch or DMX targets.
+  std::span<const uint8_t> targets() const;
+  // Get or set DMX config.
+  uint8_t dmx_channel_offset() const;
+  std::span<const uint8_t> dmx_channel_map() const;
+  // Set winch path.
+  uint8_t winch_mode() const;
+  // Set winch or DMX path: the serialized path. PathReader reads headers in
+  // place and needs them aligned, which a message after an odd-sized payload
+  // or from a MessageFramer is not, so copy the path out before reading it.
+  std::span<const uint8_t> path_data() const;
+  // Copies path_data() into path, whose storage is aligned for PathReader.
+  // Reusing path across messages avoids reallocating it.
+  void CopyPathData(std::vector<uint8_t>& path) const {
+    std::span<const uint8_t> data = path_data();
+    path.assign(data.begin(), data.end());
+  }
+
+private:
+  // A copy, as messages after an odd-sized payload start unaligned.
+  WickedMessageHeader header_ = {};
+  const uint8_t* payload_ = nullptr;
+};
+
+// Appends messages to a buffer it owns. clear() keeps the buffer's capacity,
+// so a writer reused for every outgoing batch stops allocating once warm.
+// Each Write appends one complete message, or nothing if the payload type
+// does not match the arguments or a size does not fit its field.
+class MessageWriter {
+public:
+  std::span<const uint8_t> data() const { return buffer_; }
+  void clear() { buffer_.clear(); }
+
+  // A message without payload, such as a get request.
+  bool Write(uint8_t target_id, WickedMessageType type);
+  bool Write(uint8_t target_id, const WickedPingRequest& payload);
+  bool Write(uint8_t target_id, const WickedPingResponse& payload);
+  bool Write(uint8_t target_id, const WickedBmpStatus& payload);
+  bool Write(uint8_t target_id, const WickedWinchStatus& payload);
+  // type is GetWinchConfigResponse or SetWinchConfig.
+  bool Write(uint8_t target_id, WickedMessageType type, const WickedWinchConfig& payload);
+  // type is GetWinchTargetsResponse or GetDmxTargetsResponse.
+  bool WriteTargets(uint8_t target_id, WickedMessageType type, std::span<const uint8_t> targets);
+  // type is GetDmxConfigResponse or SetDmxConfig.
+  bool WriteDmxConfig(
+      uint8_t target_id, WickedMessageType type,
+      uint8_t channel_offset, std::span<const uint8_t> channel_map);
+
+  bool WriteWinchPath(uint8_t target_id, uint8_t mode, std::span<const uint8_t> path);
+  bool WriteDmxPath(uint8_t target_id, std::span<const uint8_t> path);
+  // Serializes the path straight into the message.
+  bool WriteWinchPath(uint8_t target_id, uint8_t mode, const PathBuilder& path);
+  bool WriteDmxPath(uint8_t target_id, const PathBuilder& path);
+
+private:
+  // Appends a header and room for payload_size bytes, returning the payload,
+  // or nullptr if payload_size does not fit the header.
+  uint8_t* Append(uint8_t target_id, WickedMessageType type, size_t payload_size);
+  // Appends a path message whose 4-byte path header is written by the
+  // caller, with path_size bytes of path data after it.
+  uint8_t* AppendPath(uint8_t target_id, WickedMessageType type, size_t path_size);
+
+  std::vector<uint8_t> buffer_;
+};
+
+}
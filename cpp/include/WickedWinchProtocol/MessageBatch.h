@@ -0,0 +1,73 @@
+#pragma once
+
+#include <WickedMessage.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace wickedwinch::protocol {
+
+// Lays out many messages, typically one path per target for a cue change,
+// for a single writev.
+//
+// Headers and small payloads are copied into a buffer the batch owns, and
+// consecutive copied bytes share one iovec. Payloads of at least
+// kReferenceSize bytes, such as serialized paths, are referenced instead of
+// copied, and must stay alive and unchanged until the batch is flushed or
+// cleared. clear() keeps the allocated capacity.
+class MessageBatch {
+public:
+  // Smaller payloads are cheaper to copy than to give their own iovec.
+  static constexpr size_t kReferenceSize = 128;
+
+  // Adds a message with the given payload. Fails if the payload does not fit
+  // a message.
+  bool Add(uint8_t target_id, WickedMessageType type, std::span<const uint8_t> payload);
+  bool AddWinchPath(uint8_t target_id, uint8_t mode, std::span<const uint8_t> path);
+  bool AddDmxPath(uint8_t target_id, std::span<const uint8_t> path);
+
+  size_t message_size() const { return message_size_; }
+  // The number of bytes in all messages.
+  size_t data_size() const { return data_size_; }
+
+  // The batch as iovecs, valid until the batch next changes.
+  std::span<const iovec> iovecs();
+
+  // Copies the batch into buffer, replacing its contents.
+  void Gather(std::vector<uint8_t>& buffer) const;
+
+  // Writes the whole batch to fd, in one writev unless the kernel takes it
+  // partially or the batch needs more than IOV_MAX iovecs. Retries on EINTR;
+  // fails on any other error, after which an unknown prefix has been written.
+  // If writes is not null, sets it to the number of writev calls made.
+  bool Flush(int fd, size_t* writes = nullptr);
+
+  void clear();
+
+private:
+  // A run of bytes: data_ bytes from offset if data is null, else
+  // referenced.
+  struct Part {
+    const uint8_t* data;
+    size_t offset;
+    size_t size;
+  };
+
+  // Appends a message header and the first header_size bytes of its
+  // payload, which the caller writes to the returned pointer.
+  uint8_t* AddHeader(uint8_t target_id, WickedMessageType type, size_t payload_size, size_t header_size);
+  void AddBytes(std::span<const uint8_t> data);
+  bool AddPath(uint8_t target_id, WickedMessageType type, uint8_t mode, std::span<const uint8_t> path);
+
+  std::vector<uint8_t> data_;
+  std::vector<Part> parts_;
+  std::vector<iovec> iovecs_;
+  size_t message_size_ = 0;
+  size_t data_size_ = 0;
+};
+
+}
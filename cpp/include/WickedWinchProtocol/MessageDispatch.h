@@ -0,0 +1,215 @@
+#pragma once
+
+#include <WickedMessage.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace wickedwinch::protocol {
+
+// Payloads as a handler receives them. Fixed payloads are the C structs,
+// copied out of the buffer; trailing arrays are views into it.
+struct MessageNoPayload {};
+
+struct MessageDmxConfig {
+  uint8_t channel_offset;
+  std::span<const uint8_t> channel_map;
+};
+
+// path_data may be unaligned; copy it before PathReader::Read, as
+// MessageReader::path_data() explains.
+struct MessageWinchPath {
+  uint8_t mode;
+  std::span<const uint8_t> path_data;
+};
+
+// The payload of each message type, as sizes the Go encoder writes and a
+// Decode into the handler's payload type. kMinSize is the fixed part;
+// size() is the whole payload the fixed part declares, which Decode needs
+// within the message. Types without a payload, and unknown types, accept
+// and ignore any payload.
+template <WickedMessageType Type>
+struct MessageTraits {
+  using Payload = MessageNoPayload;
+  static constexpr size_t kMinSize = 0;
+  static size_t size(const uint8_t*) { return 0; }
+  static Payload Decode(const uint8_t*) { return {}; }
+};
+
+// A struct of which the first Size bytes are sent, without trailing padding.
+template <typename T, size_t Size = sizeof(T)>
+struct FixedMessageTraits {
+  using Payload = T;
+  static constexpr size_t kMinSize = Size;
+  static size_t size(const uint8_t*) { return Size; }
+  static Payload Decode(const uint8_t* payload) {
+    T value = {};
+    std::memcpy(&value, payload, Size);
+    return value;
+  }
+};
+
+struct TargetListTraits {
+  using Payload = std::span<const uint8_t>;
+  static constexpr size_t kMinSize = sizeof(WickedTargetList);
+  static size_t size(const uint8_t* payload) {
+    return sizeof(WickedTargetList) + payload[offsetof(WickedTargetList, targets_size)];
+  }
+  static Payload Decode(const uint8_t* payload) {
+    return {payload + sizeof(WickedTargetList), payload[offsetof(WickedTargetList, targets_size)]};
+  }
+};
+
+struct DmxConfigTraits {
+  using Payload = MessageDmxConfig;
+  static constexpr size_t kMinSize = sizeof(WickedDmxConfig);
+  static size_t size(const uint8_t* payload) {
+    return sizeof(WickedDmxConfig) + payload[offsetof(WickedDmxConfig, channel_size)];
+  }
+  static Payload Decode(const uint8_t* payload) {
+    return {
+        payload[offsetof(WickedDmxConfig, channel_offset)],
+        {payload + sizeof(WickedDmxConfig), payload[offsetof(WickedDmxConfig, channel_size)]}};
+  }
+};
+
+// WickedWinchPath and WickedDmxPath share their layout but for the mode.
+struct PathTraits {
+  static_assert(sizeof(WickedWinchPath) == sizeof(WickedDmxPath));
+  static_assert(offsetof(WickedWinchPath, path_size) == offsetof(WickedDmxPath, path_size));
+  static constexpr size_t kMinSize = sizeof(WickedWinchPath);
+  static uint16_t path_size(const uint8_t* payload) {
+    uint16_t size;
+    std::memcpy(&size, payload + offsetof(WickedWinchPath, path_size), sizeof(size));
+    return size;
+  }
+  static size_t size(const uint8_t* payload) { return sizeof(WickedWinchPath) + path_size(payload); }
+  static std::span<const uint8_t> path_data(const uint8_t* payload) {
+    return {payload + sizeof(WickedWinchPath), path_size(payload)};
+  }
+};
+
+struct WinchPathTraits : PathTraits {
+  using Payload = MessageWinchPath;
+  static Payload Decode(const uint8_t* payload) {
+    return {payload[offsetof(WickedWinchPath, mode)], path_data(payload)};
+  }
+};
+
+struct DmxPathTraits : PathTraits {
+  using Payload = std::span<const uint8_t>;
+  static Payload Decode(const uint8_t* payload) { return path_data(payload); }
+};
+
+template <> struct MessageTraits<WickedMessageType_PingRequest> : FixedMessageTraits<WickedPingRequest> {};
+template <> struct MessageTraits<WickedMessageType_PingResponse> : FixedMessageTraits<WickedPingResponse> {};
+template <> struct MessageTraits<WickedMessageType_NotifyBmpStatus> : FixedMessageTraits<WickedBmpStatus> {};
+template <> struct MessageTraits<WickedMessageType_NotifyWinchStatus>
+    : FixedMessageTraits<WickedWinchStatus, offsetof(WickedWinchStatus, flags) + sizeof(WickedWinchStatus::flags)> {};
+template <> struct MessageTraits<WickedMessageType_GetWinchTargetsResponse> : TargetListTraits {};
+template <> struct MessageTraits<WickedMessageType_GetWinchConfigResponse> : FixedMessageTraits<WickedWinchConfig> {};
+template <> struct MessageTraits<WickedMessageType_SetWinchConfig> : FixedMessageTraits<WickedWinchConfig> {};
+template <> struct MessageTraits<WickedMessageType_SetWinchPath> : WinchPathTraits {};
+template <> struct MessageTraits<WickedMessageType_GetDmxTargetsResponse> : TargetListTraits {};
+template <> struct MessageTraits<WickedMessageType_GetDmxConfigResponse> : DmxConfigTraits {};
+template <> struct MessageTraits<WickedMessageType_SetDmxConfig> : DmxConfigTraits {};
+template <> struct MessageTraits<WickedMessageType_SetDmxPath> : DmxPathTraits {};
+
+// The number of known message types, which are numbered densely from 0.
+constexpr size_t kMessageTypeSize = WickedMessageType_SetDmxPath + 1;
+
+// Selects a handler overload by message type. Unlike std::integral_constant
+// it does not convert to WickedMessageType, so it never picks the fallback.
+template <WickedMessageType Type>
+struct MessageTag {
+  static constexpr WickedMessageType value = Type;
+};
+
+namespace internal {
+
+using MessageCheck = bool (*)(const uint8_t* payload, size_t size);
+
+template <WickedMessageType Type>
+bool CheckMessage(const uint8_t* payload, size_t size) {
+  using Traits = MessageTraits<Type>;
+  return size >= Traits::kMinSize && size >= Traits::size(payload);
+}
+
+template <size_t... Types>
+constexpr std::array<MessageCheck, sizeof...(Types)> MakeCheckTable(std::index_sequence<Types...>) {
+  return {&CheckMessage<WickedMessageType(Types)>...};
+}
+
+inline constexpr auto kMessageChecks = MakeCheckTable(std::make_index_sequence<kMessageTypeSize>());
+
+template <typename Handler>
+using MessageHandlerFn = bool (*)(Handler& handler, uint8_t target_id, const uint8_t* payload, size_t size);
+
+// Checks and handles one type, so that dispatch makes one indirect call.
+template <typename Handler, WickedMessageType Type>
+bool HandleMessage(Handler& handler, uint8_t target_id, const uint8_t* payload, size_t size) {
+  using Traits = MessageTraits<Type>;
+  if (!CheckMessage<Type>(payload, size)) return false;
+  if constexpr (std::is_invocable_v<Handler&, MessageTag<Type>, uint8_t, typename Traits::Payload>) {
+    handler(MessageTag<Type>(), target_id, Traits::Decode(payload));
+  } else if constexpr (std::is_invocable_v<Handler&, WickedMessageType, uint8_t, std::span<const uint8_t>>) {
+    handler(Type, target_id, std::span<const uint8_t>(payload, size));
+  }
+  return true;
+}
+
+template <typename Handler, size_t... Types>
+constexpr std::array<MessageHandlerFn<Handler>, sizeof...(Types)> MakeHandlerTable(std::index_sequence<Types...>) {
+  return {&HandleMessage<Handler, WickedMessageType(Types)>...};
+}
+
+template <typename Handler>
+inline constexpr auto kMessageHandlers = MakeHandlerTable<Handler>(std::make_index_sequence<kMessageTypeSize>());
+
+}
+
+// Checks that a payload of the given type holds its fixed part and the
+// trailing array that declares, as MessageReader::Read does.
+inline bool CheckMessagePayload(WickedMessageType type, std::span<const uint8_t> payload) {
+  if (size_t(type) >= kMessageTypeSize) return true;
+  return internal::kMessageChecks[type](payload.data(), payload.size());
+}
+
+// Checks the message at the start of data and calls the handler for its
+// type through a table indexed by payload type, with the payload decoded:
+//
+//   handler(MessageTag<Type>(), target_id, MessageTraits<Type>::Payload)
+//
+// A handler is usually an overload set, one per type it handles. Messages of
+// types without an overload, including unknown types, go to
+//
+//   handler(WickedMessageType type, uint8_t target_id, std::span<const uint8_t> payload)
+//
+// if the handler has it, and are skipped otherwise.
+//
+// Returns the size of the message, or 0 if it is truncated or its payload
+// is too short for its type, in which case the handler is not called.
+template <typename Handler>
+size_t DispatchMessage(std::span<const uint8_t> data, Handler& handler) {
+  if (data.size() < sizeof(WickedMessageHeader)) return 0;
+  WickedMessageHeader header;
+  std::memcpy(&header, data.data(), sizeof(header));
+  size_t message_size = sizeof(header) + header.payload_size;
+  if (data.size() < message_size) return 0;
+
+  const uint8_t* payload = data.data() + sizeof(header);
+  if (header.payload_type < kMessageTypeSize) {
+    auto handle = internal::kMessageHandlers<Handler>[header.payload_type];
+    if (!handle(handler, header.target_id, payload, header.payload_size)) return 0;
+  } else if constexpr (std::is_invocable_v<Handler&, WickedMessageType, uint8_t, std::span<const uint8_t>>) {
+    handler(WickedMessageType(header.payload_type), header.target_id, std::span<const uint8_t>(payload, header.payload_size));
+  }
+  return message_size;
+}
+
+}
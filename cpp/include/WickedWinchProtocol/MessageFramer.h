@@ -0,0 +1,93 @@
+#pragma once
+
+#include <WickedMessage.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+namespace wickedwinch::protocol {
+
+// Reassembles messages from a byte stream that splits and coalesces them
+// arbitrarily, such as a serial link or a socket.
+//
+// Received bytes go into a fixed ring, either copied in by Push or read
+// straight into write_span() and committed. Next returns each complete
+// message as one contiguous span inside the ring. A message that wraps
+// around the end of the ring has only its wrapped part copied, into a tail
+// area past the end, so no byte is copied more than once however the stream
+// was split, and a large path payload arriving in small chunks costs no more
+// than one arriving whole.
+//
+// A span returned by Next stays valid until the next call that adds bytes
+// or clears the framer. Messages are framed by their header alone; use
+// MessageReader to check the payload.
+class MessageFramer {
+public:
+  // The largest message a header can describe.
+  static constexpr size_t kMaxMessageSize = sizeof(WickedMessageHeader) + UINT16_MAX;
+
+  // The ring holds capacity bytes, rounded up to a power of two of at least
+  // kMaxMessageSize, so any message fits once the previous ones are taken.
+  explicit MessageFramer(size_t capacity = 0);
+
+  size_t capacity() const { return mask_ + 1; }
+  // Bytes received and not yet returned by Next.
+  size_t size() const { return write_ - read_; }
+
+  // Copies as much of data as fits and returns the number of bytes taken.
+  size_t Push(std::span<const uint8_t> data) {
+    size_t begin = write_ & mask_;
+    if (data.size() <= capacity() - size() && begin + data.size() <= capacity()) {
+      std::memcpy(buffer_.data() + begin, data.data(), data.size());
+      write_ += data.size();
+      return data.size();
+    }
+    return PushWrapped(data);
+  }
+
+  // Contiguous free space to receive into, then Commit the bytes written.
+  // The span may be shorter than the free space when it wraps; after a
+  // commit, the next call returns the rest.
+  std::span<uint8_t> write_span();
+  void Commit(size_t size) { write_ += size; }
+
+  // The next complete message, or an empty span if none has fully arrived.
+  std::span<const uint8_t> Next() {
+    // Inline for the common case of a message that does not wrap.
+    size_t begin = read_ & mask_;
+    if (size() >= sizeof(WickedMessageHeader) && begin + sizeof(WickedMessageHeader) <= capacity()) {
+      WickedMessageHeader header;
+      std::memcpy(&header, buffer_.data() + begin, sizeof(header));
+      size_t message_size = sizeof(header) + header.payload_size;
+      if (size() < message_size) return {};
+      if (begin + message_size <= capacity()) {
+        read_ += message_size;
+        return {buffer_.data() + begin, message_size};
+      }
+    }
+    return NextWrapped();
+  }
+
+  void clear() { read_ = write_ = 0; }
+
+private:
+  // Push for data that may wrap or not fit.
+  size_t PushWrapped(std::span<const uint8_t> data);
+  // Next for a message that may wrap, or may not have arrived.
+  std::span<const uint8_t> NextWrapped();
+  // Copies size bytes starting at stream position pos out of the ring.
+  void Copy(size_t pos, uint8_t* data, size_t size) const;
+
+  // The ring, followed by kMaxMessageSize - 1 bytes where wrapped messages
+  // are made contiguous.
+  std::vector<uint8_t> buffer_;
+  size_t mask_;
+  // Stream positions, taken modulo the capacity to index the ring.
+  size_t read_ = 0;
+  size_t write_ = 0;
+};
+
+}
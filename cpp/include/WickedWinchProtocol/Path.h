@@ -2,6 +2,7 @@
 
 #include "EvalStatus.h"
 #include "Postfix.h"
+#include "PostfixBatch.h"
 
 #include <span>
 #include <vector>
@@ -14,6 +15,9 @@ struct PathHeader {
   uint8_t padding;
 
   static constexpr uint8_t Overflow = 1 << 0;
+  // The path uses the large format: a PathLargeHeader and
+  // PathLargeSegmentHeaders follow, and segment_size is unused.
+  static constexpr uint8_t Large = 1 << 1;
 };
 
 struct PathSegmentHeader {
@@ -22,6 +26,30 @@ struct PathSegmentHeader {
   uint16_t size;
 };
 
+// The large format lifts the small format's limits of 65535 segments and
+// 64 KiB by widening the segment count, offsets and sizes to 32 bits.
+// Expressions are unchanged.
+//
+// It is for paths built and played on the same side, such as by a host or a
+// simulator. The wire protocol cannot yet carry one: SetWinchPath and
+// SetDmxPath have a 16-bit path_size inside a 16-bit payload_size, so a path
+// sent to a device must still fit the small format, or be split into
+// several uploads. PathEditor, which extends long shows in place, also writes
+// only the small format.
+struct PathLargeHeader {
+  uint32_t segment_size;
+  uint8_t version;
+  uint8_t padding[3];
+
+  static constexpr uint8_t kVersion = 1;
+};
+
+struct PathLargeSegmentHeader {
+  uint32_t start_time;
+  uint32_t offset;
+  uint32_t size;
+};
+
 struct PathSegmentReader {
   uint32_t start_time;
   PostfixReader expr;
@@ -32,40 +60,101 @@ struct PathSegmentWriter {
   PostfixWriter expr;
 };
 
+// Remembers the segment found by the last PathReader lookup and the span of
+// times it covers, so that playback, which nearly always asks for a time just
+// after the previous one, finds its segment in constant time. Lookups that
+// leave the cached segment move to the next one if it covers the time, and
+// otherwise fall back to a binary search.
+//
+// A cursor may be reused across readers; it resets itself when it sees a
+// different read, even of a new path into the same buffer.
+struct PathCursor {
+  // The PathReader::generation() the cached segment belongs to.
+  uint64_t generation = 0;
+  uint32_t segment = 0xffffffff;  // PathReader::kNoSegment
+  // The cached segment covers times t with begin <= t - base < end, where
+  // base is the first segment's start time for Overflow paths and 0
+  // otherwise. end may be 2^32 for the last segment.
+  uint32_t begin = 0;
+  uint64_t end = 0;
+};
+
+class PathIndex;
+
 class PathReader {
 public:
   bool Read(std::span<const uint8_t> buffer) { return Read(buffer.data(), buffer.size()); }
   bool Read(const uint8_t* data, size_t size);
 
-  static constexpr uint8_t kNoSegment = 255;
-  uint8_t SegmentAt(uint32_t) const;
-  EvalStatus Eval(uint32_t t, PostfixStack& stack) const;
+  static constexpr uint32_t kNoSegment = 0xffffffff;
+  uint32_t SegmentAt(uint32_t) const;
+  uint32_t SegmentAt(uint32_t t, PathCursor& cursor) const;
+  // As above, answering lookups the cursor misses from index, which must
+  // have been built from this path.
+  uint32_t SegmentAt(uint32_t t, PathCursor& cursor, const PathIndex& index) const;
+  EvalStatus Eval(
+      uint32_t t, PostfixStack& stack,
+      PostfixPrecision precision = PostfixPrecision::Exact) const;
+  EvalStatus Eval(
+      uint32_t t, PathCursor& cursor, PostfixStack& stack,
+      PostfixPrecision precision = PostfixPrecision::Exact) const;
+
+  // Evaluates the path at every time in times, kBatchLanes samples at a time,
+  // and writes the first width values of each result stack to
+  // out[i * width, (i + 1) * width). Stops at the first sample that fails.
+  EvalStatus EvalBatch(
+      std::span<const uint32_t> times, size_t width, std::span<float> out,
+      PostfixBatchStack& stack,
+      PostfixPrecision precision = PostfixPrecision::Exact) const;
+
+  // Distinct for every Read, and shared by copies of the reader.
+  uint64_t generation() const { return generation_; }
 
   uint8_t flags() const { return header()->flags; }
-
-  const PathSegmentHeader* segment_header_data() const {
-    return reinterpret_cast<const PathSegmentHeader*>(buffer_ + segment_header_offset());
+  bool large() const { return flags() & PathHeader::Large; }
+  // The time segment start times are compared relative to: the first start
+  // time for Overflow paths, and 0 otherwise. PathCursor spans are relative
+  // to it.
+  uint32_t base_time() const;
+
+  uint32_t segment_header_size() const { return segment_size_; }
+  // Segment i's header, widened to the large format for small paths.
+  PathLargeSegmentHeader segment_header(uint32_t i) const {
+    if (large()) return reinterpret_cast<const PathLargeSegmentHeader*>(segment_headers_)[i];
+    const PathSegmentHeader& segment = reinterpret_cast<const PathSegmentHeader*>(segment_headers_)[i];
+    return {.start_time = segment.start_time, .offset = segment.offset, .size = segment.size};
+  }
+  // start_time leads both header formats, so it is read without a branch.
+  uint32_t start_time(uint32_t i) const {
+    return *reinterpret_cast<const uint32_t*>(segment_headers_ + i * segment_header_stride_);
   }
-  uint8_t segment_header_size() const { return header()->segment_size; }
-  const PathSegmentHeader& segment_header(uint8_t i) const { return segment_header_data()[i]; };
 
-  std::span<const uint8_t> segment_data(uint8_t i) const {
+  std::span<const uint8_t> segment_data(uint32_t i) const {
     if (i == kNoSegment) return {};
-    const PathSegmentHeader& segment = segment_header(i);
+    PathLargeSegmentHeader segment = segment_header(i);
     return {buffer_ + segment.offset, segment.size};
   }
 
 private:
 	const PathHeader* header() const { return reinterpret_cast<const PathHeader*>(buffer_); }
 
-  constexpr size_t segment_header_offset() const { return sizeof(PathHeader); }
+  // Points the cursor at segment i, or at the span before the first segment
+  // for kNoSegment.
+  void Seek(PathCursor& cursor, uint32_t i, uint32_t base) const;
+  uint32_t CursorSegmentAt(uint32_t t, PathCursor& cursor, const PathIndex* index) const;
 
 	const uint8_t* buffer_ = nullptr;
+  uint64_t generation_ = 0;
+  const uint8_t* segment_headers_ = nullptr;
+  uint32_t segment_size_ = 0;
+  uint32_t segment_header_stride_ = sizeof(PathSegmentHeader);
 };
 
 class PathWriter {
 public:
-  uint16_t data_size() const;
+  // The size of the wire buffer: the small format if the path fits it, and
+  // the large format otherwise.
+  size_t data_size() const;
 	bool Write(uint8_t* data, size_t size) const;
   std::vector<uint8_t> Write() const {
     std::vector<uint8_t> buffer(data_size());
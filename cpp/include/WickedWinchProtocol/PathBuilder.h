@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Postfix.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+namespace wickedwinch::protocol {
+
+// Builds the same wire buffer as PathWriter without a container per segment.
+// The ops, ints and floats of every segment are appended to three shared
+// arenas, and each segment only records where its streams begin. reset()
+// keeps the arenas' capacity, so a host that rebuilds paths every tick stops
+// allocating once the largest path has been built.
+//
+// Ops, ints and floats added before the first BeginSegment are undefined.
+class PathBuilder {
+public:
+  // Starts a segment; the ops, ints and floats added until the next
+  // BeginSegment belong to it.
+  void BeginSegment(uint32_t start_time) {
+    segments_.push_back({start_time, uint32_t(op_.size()), uint32_t(i_.size()), uint32_t(f_.size())});
+  }
+
+  void add_op(PostfixOp op) { op_.push_back(op); }
+  void add_i(uint8_t i) { i_.push_back(i); }
+  void add_f(float f) { f_.push_back(f); }
+
+  void Push(std::initializer_list<float> values) {
+    add_op(PostfixOp::Push);
+    add_i(values.size());
+    for (float value : values) add_f(value);
+  }
+
+  void Pop(uint8_t n) {
+    add_op(PostfixOp::Pop);
+    add_i(n);
+  }
+
+  size_t segment_size() const { return segments_.size(); }
+
+  // The size of the wire buffer, in the small format if the path fits it and
+  // in the large format otherwise, as PathWriter chooses.
+  size_t data_size() const;
+
+  // Writes the path to data, setting PathHeader::Overflow if a start time
+  // decreases. Fails if size is too small, or if a segment has more ops, ints
+  // or floats than a PostfixHeader can describe.
+  bool Write(uint8_t* data, size_t size) const;
+  // Resizes buffer to data_size() and writes into it, reusing its capacity.
+  bool Write(std::vector<uint8_t>& buffer) const {
+    buffer.resize(data_size());
+    return Write(buffer.data(), buffer.size());
+  }
+  std::vector<uint8_t> Write() const {
+    std::vector<uint8_t> buffer;
+    Write(buffer);
+    return buffer;
+  }
+
+  // Removes all segments, keeping the allocated capacity.
+  void reset() {
+    segments_.clear();
+    op_.clear();
+    i_.clear();
+    f_.clear();
+  }
+
+private:
+  struct Segment {
+    uint32_t start_time;
+    uint32_t op_begin;
+    uint32_t i_begin;
+    uint32_t f_begin;
+  };
+
+  size_t op_end(size_t s) const { return s + 1 < segments_.size() ? segments_[s + 1].op_begin : op_.size(); }
+  size_t i_end(size_t s) const { return s + 1 < segments_.size() ? segments_[s + 1].i_begin : i_.size(); }
+  size_t f_end(size_t s) const { return s + 1 < segments_.size() ? segments_[s + 1].f_begin : f_.size(); }
+
+  // The PostfixWriter::data_size of segment s.
+  size_t expr_size(size_t s) const;
+  // The size of all expressions, each padded to 4 bytes.
+  size_t expr_data_size() const;
+
+  std::vector<Segment> segments_;
+  std::vector<PostfixOp> op_;
+  std::vector<uint8_t> i_;
+  std::vector<float> f_;
+};
+
+}
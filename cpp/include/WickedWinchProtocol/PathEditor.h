@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Path.h"
+#include "Postfix.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace wickedwinch::protocol {
+
+// Appends segments to and trims expired segments from a serialized path in
+// place, so a device can extend a long running path from small "append"
+// updates instead of receiving the whole path again.
+//
+// Segment headers carry the offset of their expression, so the data need not
+// follow the headers directly. The editor keeps spare header slots between
+// the headers and the data and appends expressions at the end of the buffer.
+// Trim binary-searches the cut and advances past the expired headers, leaving
+// them and their expressions dead until they outweigh the live ones. Each
+// append and trim therefore costs O(segment) amortized, plus O(log segments)
+// for the search; the header slots double when full.
+//
+// Dead headers still sit in front of the live ones, so data() moves the live
+// headers down first if segments were trimmed since the last call. That costs
+// O(live segments), as reading the path back does anyway. The buffer is then a
+// valid small-format path for PathReader, but larger than the compact form
+// PathWriter produces. Loading or appending a large-format path converts its
+// segments to the small format, and fails if they do not fit.
+//
+// Editing invalidates PathCursors, PathPrograms and readers' views of the
+// buffer.
+class PathEditor {
+public:
+  PathEditor() { Clear(); }
+
+  // Replaces the edited path with a copy of path. Fails, leaving the editor
+  // empty, if path is not a valid path.
+  bool Load(std::span<const uint8_t> path);
+  void Clear();
+
+  // Appends one segment whose expression is a serialized postfix expression.
+  // Sets PathHeader::Overflow if start_time is less than the last segment's.
+  // Fails if the expression is invalid or the path is full.
+  bool Append(uint32_t start_time, std::span<const uint8_t> expr);
+  bool Append(uint32_t start_time, const PostfixWriter& expr);
+  // Appends all segments of a serialized path, or none if it is invalid or
+  // they do not fit.
+  bool Append(std::span<const uint8_t> path);
+
+  // Removes the segments before the one PathReader::SegmentAt(t) selects,
+  // which playback from t onwards can no longer reach. Returns the number of
+  // segments removed.
+  size_t Trim(uint32_t t);
+
+  std::span<const uint8_t> data() {
+    if (head_ != 0) CompactHeaders();
+    return buffer_;
+  }
+  uint16_t segment_size() const { return header()->segment_size; }
+  const PathSegmentHeader& segment_header(uint16_t i) const { return segment_header_data()[head_ + i]; }
+
+private:
+  PathHeader* header() { return reinterpret_cast<PathHeader*>(buffer_.data()); }
+  const PathHeader* header() const { return reinterpret_cast<const PathHeader*>(buffer_.data()); }
+  PathSegmentHeader* segment_header_data() {
+    return reinterpret_cast<PathSegmentHeader*>(buffer_.data() + sizeof(PathHeader));
+  }
+  const PathSegmentHeader* segment_header_data() const {
+    return reinterpret_cast<const PathSegmentHeader*>(buffer_.data() + sizeof(PathHeader));
+  }
+
+  size_t header_end() const { return sizeof(PathHeader) + header_capacity_ * sizeof(PathSegmentHeader); }
+
+  // The buffer size with capacity header slots, the live data and size more
+  // bytes, once dead headers and data are dropped.
+  size_t LayoutSize(size_t capacity, size_t size) const {
+    return sizeof(PathHeader) + capacity * sizeof(PathSegmentHeader) + (buffer_.size() - live_begin_) + size;
+  }
+  // Whether segments more segments with size bytes of padded expressions fit,
+  // after growing the header slots and dropping dead headers and data.
+  bool Fits(size_t segments, size_t size) const;
+  // Makes room for one more segment with a size byte expression and returns
+  // the offset to write it at, or 0 if it does not fit.
+  size_t Reserve(size_t size);
+  // Adds the header of the segment Reserve made room for.
+  void Commit(uint32_t start_time, size_t offset, size_t size);
+  // Moves the live headers to the first slot, dropping dead headers.
+  void CompactHeaders();
+  // Moves the live data to start at begin, dropping dead headers and data.
+  void Relocate(size_t begin);
+
+  std::vector<uint8_t> buffer_;
+  uint16_t header_capacity_;
+  // Live headers fill slots [head_, head_ + segment_size()).
+  uint16_t head_;
+  // Live expression data spans [live_begin_, buffer_.size()).
+  size_t live_begin_;
+  // The number of adjacent segments whose start time decreases. The path
+  // needs PathHeader::Overflow while it is non-zero.
+  size_t decreases_;
+};
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "EvalStatus.h"
+#include "Path.h"
+#include "PathProgram.h"
+#include "PathSlot.h"
+#include "Postfix.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace wickedwinch::protocol {
+
+struct PathEngineStats {
+  // Wall time of the whole Eval call, from dispatch to the last target.
+  std::chrono::nanoseconds latency{0};
+  // Targets whose evaluation did not return Ok.
+  size_t failed = 0;
+};
+
+// Evaluates many target paths at the same time in one call, as a device does
+// every tick for its winches and DMX targets.
+//
+// Targets are split into one contiguous range per worker. A worker that
+// finishes its range steals remaining targets from the others, so uneven
+// segment costs balance out. The calling thread is worker 0; the rest are
+// pool threads that sleep between ticks.
+//
+// Each target owns its stack and a PathCursor, so successive ticks find their
+// segments in constant time. Registered paths refer to their buffers, which
+// must outlive the engine or the next SetPath.
+class PathEngine {
+public:
+  // workers counts the calling thread; 0 and 1 both evaluate inline.
+  explicit PathEngine(size_t workers = 1);
+  ~PathEngine();
+
+  PathEngine(const PathEngine&) = delete;
+  PathEngine& operator=(const PathEngine&) = delete;
+
+  size_t workers() const { return threads_.size() + 1; }
+
+  // Registers a path and returns its target index. stack_capacity 0 sizes the
+  // stack to the largest proven bound of the path's segments.
+  size_t AddTarget(const PathReader& reader, size_t stack_capacity = 0);
+  // Registers a target whose path is read from slot on every tick, so another
+  // thread can publish new paths during playback. The slot must have at
+  // least workers() readers; worker w reads as reader w.
+  size_t AddTarget(PathSlot& slot, size_t stack_capacity);
+  // Replaces a target's path, keeping its stack if it is large enough.
+  void SetPath(size_t target, const PathReader& reader, size_t stack_capacity = 0);
+  size_t size() const { return targets_.size(); }
+
+  // Evaluates every target at t. Must not be called concurrently, or while
+  // targets are being added.
+  PathEngineStats Eval(uint32_t t, PostfixPrecision precision = PostfixPrecision::Exact);
+
+  // The status and result stack of a target's last evaluation.
+  EvalStatus status(size_t target) const { return targets_[target]->status; }
+  std::span<const float> result(size_t target) const {
+    const PostfixStack& stack = targets_[target]->stack;
+    return {stack.stack_data, stack.stack_size};
+  }
+
+private:
+  struct Target {
+    PathProgram path;
+    PathSlot* slot = nullptr;
+    // The slot path version the cursor was last used with.
+    uint64_t version = 0;
+    PathCursor cursor;
+    std::vector<float> stack_data;
+    PostfixStack stack{};
+    EvalStatus status = EvalStatus::UndefinedOperation;
+  };
+
+  // A worker's share of the targets for the current tick. Thieves claim from
+  // the same counter as the owner, one target at a time.
+  struct alignas(64) Range {
+    std::atomic<size_t> next{0};
+    size_t end = 0;
+  };
+
+  void Load(Target& target, const PathReader& reader, size_t stack_capacity);
+  void ResizeStack(Target& target, size_t stack_capacity);
+  void Eval(Target& target, size_t worker);
+  void Work(size_t worker);
+  void Run(size_t worker);
+
+  std::vector<std::unique_ptr<Target>> targets_;
+  std::unique_ptr<Range[]> ranges_;
+  std::vector<std::thread> threads_;
+
+  // Parameters of the current tick, published by bumping generation_.
+  uint32_t time_ = 0;
+  PostfixPrecision precision_ = PostfixPrecision::Exact;
+  std::atomic<size_t> failed_{0};
+
+  std::atomic<uint32_t> generation_{0};
+  std::atomic<size_t> pending_{0};
+  bool stop_ = false;
+};
+
+}
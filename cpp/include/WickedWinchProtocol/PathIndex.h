@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Path.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace wickedwinch::protocol {
+
+// A time-bucket table over a path's segment start times, so that a random
+// seek reads two adjacent bucket entries and a run of start times that is
+// usually one long, instead of log2(n) scattered segment headers.
+//
+// Start times are stored relative to PathReader::base_time(), which keeps
+// the Overflow ordering, and the span they cover is split into a power of
+// two number of equal buckets, at least one per segment. Each bucket records
+// how many segments start before it; a lookup searches only the segments
+// that start inside its bucket.
+//
+// The index is built from a path once and answers lookups exactly as
+// PathReader::SegmentAt does. A path whose start times are out of order gets
+// no table, and lookups fall back to the reader's search. The index refers
+// to the path buffer and must not outlive it.
+class PathIndex {
+public:
+  void Build(const PathReader& reader);
+
+  const PathReader& reader() const { return reader_; }
+  // Whether lookups use the table rather than the reader's search.
+  bool indexed() const { return !keys_.empty(); }
+
+  uint32_t SegmentAt(uint32_t t) const;
+
+private:
+  PathReader reader_;
+  uint32_t base_ = 0;
+  // Start times relative to base_.
+  std::vector<uint32_t> keys_;
+  // buckets_[b] is the number of keys below keys_[0] + (b << shift_). The
+  // last two entries are the key count, so that times past the final
+  // bucket find every segment.
+  std::vector<uint32_t> buckets_;
+  uint32_t shift_ = 0;
+};
+
+}
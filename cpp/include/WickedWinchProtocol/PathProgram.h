@@ -0,0 +1,95 @@
+#pragma once
+
+#include "EvalStatus.h"
+#include "Path.h"
+#include "PathIndex.h"
+#include "Postfix.h"
+#include "PostfixBatch.h"
+#include "PostfixProgram.h"
+
+#include <span>
+#include <vector>
+
+namespace wickedwinch::protocol {
+
+// A path whose segments have been parsed and verified once, so evaluation
+// goes straight to running the segment's PostfixProgram instead of re-reading
+// its expression on every call.
+//
+// Evaluation results and statuses match PathReader's. A segment that fails
+// verification, or a stack too small for a segment's proven bounds, is run
+// through the checked evaluator so that it reports the same error. Segment
+// lookups use a PathIndex built at load time.
+//
+// The program refers to the path buffer and must not outlive it.
+class PathProgram {
+public:
+  struct Segment {
+    uint32_t start_time;
+    PostfixReader expr;
+    PostfixProgram program;
+    // The result of verifying program against a one-value input stack.
+    EvalStatus status;
+  };
+
+  // Loads every segment of a path that was successfully read.
+  void Load(const PathReader& reader);
+
+  const PathReader& reader() const { return reader_; }
+  std::span<const Segment> segments() const { return segments_; }
+
+  const PathIndex& index() const { return index_; }
+
+  uint32_t SegmentAt(uint32_t t) const { return index_.SegmentAt(t); }
+  uint32_t SegmentAt(uint32_t t, PathCursor& cursor) const { return reader_.SegmentAt(t, cursor, index_); }
+
+  EvalStatus Eval(
+      uint32_t t, PostfixStack& stack,
+      PostfixPrecision precision = PostfixPrecision::Exact) const;
+  EvalStatus Eval(
+      uint32_t t, PathCursor& cursor, PostfixStack& stack,
+      PostfixPrecision precision = PostfixPrecision::Exact) const;
+
+  // As PathReader::EvalBatch, without verifying a program per segment.
+  EvalStatus EvalBatch(
+      std::span<const uint32_t> times, size_t width, std::span<float> out,
+      PostfixBatchStack& stack,
+      PostfixPrecision precision = PostfixPrecision::Exact) const;
+
+private:
+  PathReader reader_;
+  PathIndex index_;
+  std::vector<Segment> segments_;
+};
+
+// Samples a loaded path at a fixed period, writing width values per frame.
+// Each Fill continues where the previous one stopped. Frames are evaluated
+// kBatchLanes at a time; the number of frames left in the current segment is
+// computed from its end time, so samples need no segment lookup of their own.
+//
+// The sampler refers to the path, which must outlive it.
+class PathSampler {
+public:
+  // period is in path time units (ms), and may be 0 to hold one time.
+  PathSampler(const PathProgram& path, uint32_t start_time, uint32_t period, size_t width)
+      : path_(path), time_(start_time), period_(period), width_(width) {}
+
+  // Fills out.size() / width frames. On failure, time() is the time of the
+  // first frame that was not written.
+  EvalStatus Fill(
+      std::span<float> out, PostfixBatchStack& stack,
+      PostfixPrecision precision = PostfixPrecision::Exact);
+
+  // The time of the next frame.
+  uint32_t time() const { return time_; }
+  void Seek(uint32_t t) { time_ = t; }
+
+private:
+  const PathProgram& path_;
+  PathCursor cursor_;
+  uint32_t time_;
+  uint32_t period_;
+  size_t width_;
+};
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Path.h"
+#include "PathProgram.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace wickedwinch::protocol {
+
+// Holds a target's active path so that an I/O thread can replace it while
+// evaluation threads keep reading, without either side blocking the other.
+//
+// Readers are identified by a fixed index below the reader count given at
+// construction, typically their worker index. Read is wait-free: it announces
+// the current epoch in the reader's own slot and loads the path pointer, with
+// no retry loop. Publish swaps in a new loaded path and retires the old one
+// under the epoch it was replaced in; a retired path is freed once every
+// reader is idle or has announced a later epoch.
+//
+// Publish and Reclaim may be called from any thread; they serialize on a
+// mutex that readers never take.
+class PathSlot {
+public:
+  struct Path {
+    std::vector<uint8_t> buffer;
+    PathProgram program;
+    // Distinct for every published path, even one allocated where a freed
+    // one was; PathCursors must be reset when it changes.
+    uint64_t version;
+  };
+
+  // Keeps a path alive until destroyed. A reader may hold one guard at a time.
+  class Guard {
+  public:
+    Guard(Guard&& other) : slot_(other.slot_), path_(other.path_) { other.slot_ = nullptr; }
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+    ~Guard() {
+      if (slot_ != nullptr) slot_->store(kIdle, std::memory_order_release);
+    }
+
+    // Null if nothing has been published.
+    const PathProgram* get() const { return path_ ? &path_->program : nullptr; }
+    const PathProgram* operator->() const { return get(); }
+    explicit operator bool() const { return path_ != nullptr; }
+    uint64_t version() const { return path_ ? path_->version : 0; }
+
+  private:
+    friend class PathSlot;
+    Guard(std::atomic<uint64_t>* slot, const Path* path) : slot_(slot), path_(path) {}
+
+    std::atomic<uint64_t>* slot_;
+    const Path* path_;
+  };
+
+  explicit PathSlot(size_t readers);
+  ~PathSlot();
+
+  PathSlot(const PathSlot&) = delete;
+  PathSlot& operator=(const PathSlot&) = delete;
+
+  size_t readers() const { return reader_size_; }
+
+  Guard Read(size_t reader) const {
+    std::atomic<uint64_t>& slot = readers_[reader].epoch;
+    slot.store(epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    return Guard(&slot, current_.load(std::memory_order_seq_cst));
+  }
+
+  // Validates and loads buffer, makes it the active path, and reclaims what
+  // it can. Returns false and keeps the active path if buffer is not a valid
+  // path.
+  bool Publish(std::vector<uint8_t> buffer);
+
+  // Frees retired paths that no reader can still hold. Returns the number
+  // still retired.
+  size_t Reclaim();
+
+private:
+  static constexpr uint64_t kIdle = 0;
+
+  struct alignas(64) Reader {
+    std::atomic<uint64_t> epoch{kIdle};
+  };
+
+  // Whether a reader may still hold a path retired in epoch.
+  bool InUse(uint64_t epoch) const;
+
+  struct Retired {
+    std::unique_ptr<Path> path;
+    uint64_t epoch;
+  };
+
+  std::unique_ptr<Reader[]> readers_;
+  size_t reader_size_;
+
+  std::atomic<const Path*> current_{nullptr};
+  std::atomic<uint64_t> epoch_{1};
+
+  std::mutex writer_mutex_;
+  std::unique_ptr<Path> owned_;
+  std::vector<Retired> retired_;
+};
+
+}
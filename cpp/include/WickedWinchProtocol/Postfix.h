@@ -54,6 +54,34 @@ enum class PostfixOp : uint8_t {
   PolyMat   = 36,
   Lerp      = 37,
   Lut       = 38,
+
+  // Superinstructions produced by PostfixProgram::Fuse. These are not part of
+  // the wire format and are rejected when evaluating serialized expressions;
+  // they must be renumbered if the wire op set grows.
+  AddConst  = 39,
+  SubConst  = 40,
+  MulConst  = 41,
+  DivConst  = 42,
+  Square    = 43,
+  Axpy      = 44,
+};
+
+// How Sin, Cos, Tan, Asin, Acos, Atan2, Exp, Ln and Pow are evaluated.
+enum class PostfixPrecision : uint8_t {
+  // The std:: functions.
+  Exact = 0,
+  // Branch-free polynomial approximations. PostfixBatchStack runs them as
+  // vector loops across its lanes, where they beat the per-lane libm calls;
+  // the scalar interpreter gets the same results but little speedup, since
+  // glibc's float functions already cost only a few ns each.
+  //  - Exp, Ln, Asin, Acos, Atan2: relative error below 1e-5.
+  //  - Pow with a positive base: relative error below 1e-5 times
+  //    max(1, |b ln a|), for results in the normal range.
+  //  - Sin, Cos, Tan: for |x| < 8192, absolute error below 1e-6 for Sin and
+  //    Cos, and relative error below 1e-5 for Tan away from its poles.
+  // Other inputs (non-finite, subnormal, negative bases, larger angles) use
+  // the std:: functions, so edge cases behave as in Exact.
+  Fast = 1,
 };
 
 struct PostfixHeader {
@@ -62,8 +90,18 @@ struct PostfixHeader {
 	uint16_t f_size;
 };
 
+// A decoded op with its int operands unpacked (implicit push flags removed)
+// and its literal pushes resolved to a range of the expression's float pool.
+struct PostfixInstr {
+  PostfixOp op;
+  uint8_t arg[3];
+  uint16_t f_offset;
+  uint16_t f_size;
+};
+
 static_assert(sizeof(PostfixOp) == 1);
 static_assert(sizeof(PostfixHeader) == 4);
+static_assert(sizeof(PostfixInstr) == 8);
 static_assert(sizeof(float) == 4);
 
 struct PostfixEvalContext {
@@ -76,19 +114,120 @@ struct PostfixEvalContext {
   uint16_t f_size;
   size_t stack_size;
   size_t stack_capacity;
+  float* scratch_data;
+  size_t scratch_capacity;
+  PostfixPrecision precision;
   std::vector<float> temp;
 
-  EvalStatus push(float v);
-  EvalStatus pushv(std::span<const float> v);
-  EvalStatus pushf(size_t n);
-  EvalStatus allocv(size_t n, std::span<float>& v);
-  EvalStatus pop(float& v);
-  EvalStatus popv(size_t n, std::span<float>& v);
-  EvalStatus peek(float& v);
-  EvalStatus peekv(size_t n, std::span<float>& v);
-  EvalStatus geti(uint8_t& n);
-  EvalStatus implicitPushArg(uint8_t& arg, uint8_t multiple, uint8_t instances);
+  // The stack and literal accessors below are bounds checked unless kChecked
+  // is false, in which case the caller must have proven them in range (see
+  // PostfixProgram).
+
+  template <bool kChecked = true>
+  EvalStatus push(float v) {
+    if (kChecked && stack_size + 1 > stack_capacity) return EvalStatus::StackOverflow;
+    stack_data[stack_size++] = v;
+    return EvalStatus::Ok;
+  }
+
+  template <bool kChecked = true>
+  EvalStatus pushv(std::span<const float> v) {
+    if (kChecked && stack_size + v.size() > stack_capacity) return EvalStatus::StackOverflow;
+    memmove(&stack_data[stack_size], v.data(), v.size() * sizeof(float));
+    stack_size += v.size();
+    return EvalStatus::Ok;
+  }
+
+  template <bool kChecked = true>
+  EvalStatus pushf(size_t n) {
+    if (kChecked && n > f_size) return EvalStatus::FloatLiteralsUnderflow;
+    if (EvalStatus status = pushv<kChecked>(std::span<const float>(f_head, n));
+        status != EvalStatus::Ok) {
+      return status;
+    }
+    f_size -= n;
+    f_head += n;
+    return EvalStatus::Ok;
+  }
+
+  template <bool kChecked = true>
+  EvalStatus allocv(size_t n, std::span<float>& v) {
+    if (kChecked && stack_size + n > stack_capacity) return EvalStatus::StackOverflow;
+    v = std::span<float>(&stack_data[stack_size], n);
+    stack_size += n;
+    return EvalStatus::Ok;
+  }
+
+  template <bool kChecked = true>
+  EvalStatus pop(float& v) {
+    if (kChecked && stack_size < 1) return EvalStatus::StackUnderflow;
+    v = stack_data[--stack_size];
+    return EvalStatus::Ok;
+  }
+
+  template <bool kChecked = true>
+  EvalStatus popv(size_t n, std::span<float>& v) {
+    if (kChecked && stack_size < n) return EvalStatus::StackUnderflow;
+    stack_size -= n;
+    v = std::span<float>(&stack_data[stack_size], n);
+    return EvalStatus::Ok;
+  }
+
+  template <bool kChecked = true>
+  EvalStatus peek(float& v) {
+    if (kChecked && stack_size < 1) return EvalStatus::StackUnderflow;
+    v = stack_data[stack_size-1];
+    return EvalStatus::Ok;
+  }
+
+  template <bool kChecked = true>
+  EvalStatus peekv(size_t n, std::span<float>& v) {
+    if (kChecked && stack_size < n) return EvalStatus::StackUnderflow;
+    v = std::span<float>(&stack_data[stack_size - n], n);
+    return EvalStatus::Ok;
+  }
+
+  template <bool kChecked = true>
+  EvalStatus geti(uint8_t& n) {
+    if (kChecked && i_size < 1) return EvalStatus::IntLiteralsUnderflow;
+    n = i_head[0];
+    --i_size;
+    ++i_head;
+    return EvalStatus::Ok;
+  }
+
+  template <bool kChecked = true>
+  EvalStatus implicitPushArg(uint8_t& arg, uint8_t multiple, uint8_t instances) {
+    uint8_t mask = uint8_t(1 << instances) - 1;
+    uint8_t push_count = arg & mask;
+    arg >>= instances;
+    if (push_count == 0) return EvalStatus::Ok;
+    uint16_t size = uint16_t(push_count * multiple * arg);
+    return pushf<kChecked>(size);
+  }
+
+  // Returns n floats of scratch space that do not overlap the stack or the
+  // offset values just above its top. Stack headroom is used when there is
+  // enough, then the caller's scratch arena; only when neither fits does this
+  // allocate. Verified programs always have the headroom.
+  template <bool kChecked = true>
+  std::span<float> scratch(size_t offset, size_t n) {
+    if (!kChecked || stack_size + offset + n <= stack_capacity) {
+      return std::span<float>(&stack_data[stack_size + offset], n);
+    }
+    if (n <= scratch_capacity) return std::span<float>(scratch_data, n);
+    temp.resize(n);
+    return temp;
+  }
+
   EvalStatus Eval();
+
+  // Evaluates decoded instructions without any bounds checks. Only valid for
+  // instructions produced by PostfixProgram::Verify against the current stack.
+  EvalStatus EvalUnchecked(std::span<const PostfixInstr> instrs, const float* f_data);
+
+  template <typename Cursor>
+  EvalStatus Run(Cursor& cursor);
 };
 
 class PostfixReader {
@@ -190,10 +329,16 @@ private:
 	std::vector<float> f_;
 };
 
+class PostfixProgram;
+
 struct PostfixStack {
   float* stack_data;
   size_t stack_size;
   size_t stack_capacity;
+  // Optional space for Transpose and MulMat when the stack has too little
+  // headroom for their temporaries.
+  float* scratch_data = nullptr;
+  size_t scratch_capacity = 0;
 
   void clear() { stack_size = 0; }
 
@@ -203,19 +348,28 @@ struct PostfixStack {
     return true;
   }
 
+  // Evaluates a verified program. The stack is checked once against the
+  // program's proven bounds instead of on every op.
+  EvalStatus Eval(
+      const PostfixProgram& program,
+      PostfixPrecision precision = PostfixPrecision::Exact);
+
   template <typename Expr>
-  EvalStatus Eval(const Expr& expr) {
+  EvalStatus Eval(const Expr& expr, PostfixPrecision precision = PostfixPrecision::Exact) {
     PostfixEvalContext context{
-      .op_head        = expr.op_data(),
-      .i_head         = expr.i_data(),
-      .f_head         = expr.f_data(),
-      .stack_data     = stack_data,
-      .op_size        = expr.op_size(),
-      .i_size         = expr.i_size(),
-      .f_size         = expr.f_size(),
-      .stack_size     = stack_size,
-      .stack_capacity = stack_capacity,
-      .temp           = {},
+      .op_head          = expr.op_data(),
+      .i_head           = expr.i_data(),
+      .f_head           = expr.f_data(),
+      .stack_data       = stack_data,
+      .op_size          = expr.op_size(),
+      .i_size           = expr.i_size(),
+      .f_size           = expr.f_size(),
+      .stack_size       = stack_size,
+      .stack_capacity   = stack_capacity,
+      .scratch_data     = scratch_data,
+      .scratch_capacity = scratch_capacity,
+      .precision        = precision,
+      .temp             = {},
     };
     EvalStatus status = context.Eval();
     stack_size = context.stack_size;
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "EvalStatus.h"
+#include "PostfixProgram.h"
+
+#include <cstddef>
+
+namespace wickedwinch::protocol {
+
+// The number of independent evaluations a PostfixBatchStack runs at once.
+// Eight floats fill an AVX2 register or two NEON registers.
+static constexpr size_t kBatchLanes = 8;
+
+// A structure-of-arrays stack holding kBatchLanes independent stacks of the
+// same shape. Slot s of lane l is at stack_data[s * kBatchLanes + l], so every
+// op works on whole slots and its per-lane loop vectorizes.
+//
+// stack_size and stack_capacity count slots, not floats.
+struct PostfixBatchStack {
+  float* stack_data;
+  size_t stack_size;
+  size_t stack_capacity;
+
+  void clear() { stack_size = 0; }
+
+  float* slot(size_t i) { return stack_data + i * kBatchLanes; }
+  const float* slot(size_t i) const { return stack_data + i * kBatchLanes; }
+
+  // Evaluates a verified program on all lanes. As with PostfixStack, the
+  // stack is checked once against the program's proven bounds.
+  EvalStatus Eval(
+      const PostfixProgram& program,
+      PostfixPrecision precision = PostfixPrecision::Exact);
+};
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "EvalStatus.h"
+#include "Postfix.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace wickedwinch::protocol {
+
+struct PostfixOptimizeStats {
+  // Op counts before and after optimization.
+  size_t input_ops = 0;
+  size_t output_ops = 0;
+  // Ops whose operands were all literals, evaluated at optimization time.
+  size_t folded_ops = 0;
+  // Literal values popped before any op used them.
+  size_t dropped_values = 0;
+};
+
+// Rewrites an expression into an equivalent one that does no work depending
+// only on literals. Values derived purely from literals are tracked on an
+// abstract stack and folded by running the evaluator once; pushes that are
+// popped unused and no-op stack ops are removed; the remaining literals are
+// pushed implicitly by the op that consumes them when its encoding allows.
+//
+// The expression must verify for input_size values, and the result gives
+// the same stack for every input stack of that size. If the rewrite would not
+// be smaller or does not fit the wire format, out is a copy of the input.
+template <typename Expr>
+EvalStatus OptimizePostfix(
+    const Expr& expr, size_t input_size, PostfixWriter& out,
+    PostfixOptimizeStats* stats = nullptr) {
+  return OptimizePostfix(
+      expr.op_data(), expr.op_size(),
+      expr.i_data(), expr.i_size(),
+      expr.f_data(), expr.f_size(),
+      input_size, out, stats);
+}
+
+EvalStatus OptimizePostfix(
+    const PostfixOp* op_data, uint8_t op_size,
+    const uint8_t* i_data, uint8_t i_size,
+    const float* f_data, uint16_t f_size,
+    size_t input_size, PostfixWriter& out,
+    PostfixOptimizeStats* stats = nullptr);
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "EvalStatus.h"
+#include "Postfix.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace wickedwinch::protocol {
+
+struct PostfixFusionStats {
+  // Instruction counts before and after fusion.
+  size_t input_instrs = 0;
+  size_t output_instrs = 0;
+  // Pushes merged into an adjacent Push or into the next op's literal push.
+  size_t merged_pushes = 0;
+  // Push of one literal followed by Add, Sub, Mul or Div.
+  size_t const_ops = 0;
+  // Dup 0 followed by Mul.
+  size_t squares = 0;
+  // ScaleVec followed by AddVec of the same size.
+  size_t axpys = 0;
+};
+
+// A postfix expression whose stack and literal usage has been proven in range
+// for a given input stack size. Verification abstractly interprets the op, int
+// and float streams once and decodes them into fixed-width PostfixInstrs;
+// evaluation then runs the instructions without per-op bounds checks or
+// stream cursors.
+//
+// The program refers to the expression's float pool and must not outlive it.
+class PostfixProgram {
+public:
+  template <typename Expr>
+  EvalStatus Verify(const Expr& expr, size_t input_size) {
+    return Verify(
+        expr.op_data(), expr.op_size(),
+        expr.i_data(), expr.i_size(),
+        expr.f_data(), expr.f_size(),
+        input_size);
+  }
+
+  // Returns the status the checked evaluator would report on an unbounded
+  // stack holding input_size values, or Ok if the program is safe to run.
+  EvalStatus Verify(
+      const PostfixOp* op_data, uint8_t op_size,
+      const uint8_t* i_data, uint8_t i_size,
+      const float* f_data, uint16_t f_size,
+      size_t input_size);
+
+  bool verified() const { return verified_; }
+
+  // Rewrites recurring op sequences of a verified program into
+  // superinstructions, reducing dispatch count and stack traffic. The proven
+  // stack bounds remain valid.
+  PostfixFusionStats Fuse();
+
+  std::span<const PostfixInstr> instrs() const { return instrs_; }
+  const float* f_data() const { return f_data_; }
+
+  // The number of stack values the program was verified against.
+  size_t input_size() const { return input_size_; }
+  // The largest stack size reached while evaluating from input_size values,
+  // including the temporaries Transpose and MulMat keep above the top.
+  size_t max_stack_size() const { return max_stack_size_; }
+  // The stack size after evaluating from input_size values.
+  size_t output_size() const { return output_size_; }
+
+private:
+  std::vector<PostfixInstr> instrs_;
+  const float* f_data_ = nullptr;
+  bool verified_ = false;
+  size_t input_size_ = 0;
+  size_t max_stack_size_ = 0;
+  size_t output_size_ = 0;
+};
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+namespace wickedwinch::protocol {
+
+// Instruction sets the vector op kernels can use.
+enum class SimdLevel : uint8_t {
+  Scalar = 0,
+  Sse    = 1,
+  Avx2   = 2,
+};
+
+// The widest level both this build and the running CPU support. Evaluation
+// uses it unless SetSimdLevel selects another.
+SimdLevel SupportedSimdLevel();
+
+SimdLevel ActiveSimdLevel();
+
+// Selects the kernels used by every evaluator, clamped to
+// SupportedSimdLevel(). Meant for benchmarks and tests; must not race with
+// evaluation.
+void SetSimdLevel(SimdLevel level);
+
+}
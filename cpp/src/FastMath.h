@@ -0,0 +1,241 @@
+#pragma once
+
+// Polynomial approximations used by PostfixPrecision::Fast.
+//
+// Each function is a struct with three parts: InRange, the inputs its range
+// reduction handles; Core, a branch-free approximation that is only
+// meaningful in range but safe to run on any input; and Exact, the std::
+// function used everywhere else (non-finite, zero or subnormal arguments, and
+// very large angles), so special values match the exact mode. Keeping Core
+// branch-free lets the batch evaluator run it across all lanes as one vector
+// loop and patch the rare out-of-range lanes afterwards.
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace wickedwinch::protocol {
+
+inline constexpr float kFastPi = 3.14159265358979f;
+inline constexpr float kFastHalfPi = 1.57079632679490f;
+
+// Rounds to the nearest integer for |x| < 2^22 by adding and subtracting
+// 1.5 * 2^23, which leaves no fraction bits. Unlike std::nearbyint this
+// needs no library call or SSE4.1, so loops around it vectorize.
+inline float FastRound(float x) {
+  constexpr float kMagic = 12582912.0f;
+  return (x + kMagic) - kMagic;
+}
+
+// c ? a : b as a bitwise blend. GCC turns ternaries between a value and a
+// constant into branches, which stops the lane loops from vectorizing.
+inline float FastSelect(bool c, float a, float b) {
+  uint32_t mask = -uint32_t(c);
+  return std::bit_cast<float>(
+      (std::bit_cast<uint32_t>(a) & mask) | (std::bit_cast<uint32_t>(b) & ~mask));
+}
+
+template <typename Fn>
+float FastEval(float x) {
+  return Fn::InRange(x) ? Fn::Core(x) : Fn::Exact(x);
+}
+
+template <typename Fn>
+float FastEval(float a, float b) {
+  return Fn::InRange(a, b) ? Fn::Core(a, b) : Fn::Exact(a, b);
+}
+
+// e^x as 2^n e^r with |r| <= ln(2)/2 and a degree 6 Taylor polynomial.
+struct FastExp {
+  static bool InRange(float x) { return (x > -87.0f) & (x < 88.0f); }
+
+  static float Core(float x) {
+    // Out-of-range lanes are discarded; zeroing them keeps the float to int
+    // conversion below defined.
+    x = FastSelect(InRange(x), x, 0);
+    float n = FastRound(x * 1.44269504088896f);
+    // ln(2) split so that n * kLn2Hi is exact.
+    float r = (x - n * 0.693145751953125f) - n * 1.42860682030941723212e-6f;
+    float p = 1.0f + r * (1.0f + r * (0.5f + r * (1.0f / 6 + r * (1.0f / 24 + r * (1.0f / 120 + r * (1.0f / 720))))));
+    int32_t bits = (int32_t(n) + 127) << 23;
+    return p * std::bit_cast<float>(bits);
+  }
+
+  static float Exact(float x) { return std::exp(x); }
+};
+
+// ln(x) as e ln(2) + ln(m) with m in [sqrt(1/2), sqrt(2)), using
+// ln(m) = 2 atanh(s) for s = (m - 1) / (m + 1), |s| < 0.172.
+struct FastLn {
+  static bool InRange(float x) {
+    return (x >= std::numeric_limits<float>::min()) & (x <= std::numeric_limits<float>::max());
+  }
+
+  static float Core(float x) {
+    uint32_t bits = std::bit_cast<uint32_t>(x);
+    int32_t e = int32_t((bits >> 23) & 0xff) - 127;
+    float m = std::bit_cast<float>((bits & 0x007fffff) | 0x3f800000);
+    bool high = m > 1.41421356f;
+    m = FastSelect(high, m * 0.5f, m);
+    e += high;
+    float s = (m - 1) / (m + 1);
+    float s2 = s * s;
+    float p = 2 * s * (1.0f + s2 * (1.0f / 3 + s2 * (1.0f / 5 + s2 * (1.0f / 7 + s2 * (1.0f / 9)))));
+    return float(e) * 0.693147180559945f + p;
+  }
+
+  static float Exact(float x) { return std::log(x); }
+};
+
+// a^b as e^(b ln a) for positive a; other bases go to std::pow, which handles
+// integer exponents of negative bases and the zero and infinity cases.
+struct FastPow {
+  static bool InRange(float a, float b) {
+    return FastLn::InRange(a) & FastExp::InRange(b * FastLn::Core(a));
+  }
+
+  static float Core(float a, float b) { return FastExp::Core(b * FastLn::Core(a)); }
+
+  static float Exact(float a, float b) { return std::pow(a, b); }
+};
+
+// Shared range reduction for sin, cos and tan: r in [-pi/4, pi/4] with
+// x = r + k pi/2 using a three part split of pi/2, which stays accurate for
+// |x| < 8192. Taylor polynomials on [-pi/4, pi/4] have truncation error
+// below 4e-7 relative for sin and 3e-8 absolute for cos.
+struct FastTrig {
+  static bool InRange(float x) { return std::abs(x) < 8192.0f; }
+
+  // Returns the quadrant k mod 4.
+  static int32_t Reduce(float x, float& r) {
+    x = FastSelect(InRange(x), x, 0);
+    float k = FastRound(x * 0.636619772367581f);
+    r = x - k * 1.5703125f;
+    r -= k * 4.83751296997070312500e-04f;
+    r -= k * 7.54978995489188216e-08f;
+    return int32_t(k) & 3;
+  }
+
+  static float SinPoly(float r) {
+    float r2 = r * r;
+    return r + r * r2 * (-1.0f / 6 + r2 * (1.0f / 120 + r2 * (-1.0f / 5040 + r2 * (1.0f / 362880))));
+  }
+
+  static float CosPoly(float r) {
+    float r2 = r * r;
+    return 1.0f + r2 * (-0.5f + r2 * (1.0f / 24 + r2 * (-1.0f / 720 + r2 * (1.0f / 40320))));
+  }
+};
+
+struct FastSin : FastTrig {
+  static float Core(float x) {
+    float r;
+    int32_t k = Reduce(x, r);
+    float s = SinPoly(r);
+    float c = CosPoly(r);
+    float v = FastSelect(k & 1, c, s);
+    return FastSelect(k & 2, -v, v);
+  }
+
+  static float Exact(float x) { return std::sin(x); }
+};
+
+struct FastCos : FastTrig {
+  static float Core(float x) {
+    float r;
+    int32_t k = Reduce(x, r);
+    float s = SinPoly(r);
+    float c = CosPoly(r);
+    float v = FastSelect(k & 1, s, c);
+    return FastSelect((k + 1) & 2, -v, v);
+  }
+
+  static float Exact(float x) { return std::cos(x); }
+};
+
+struct FastTan : FastTrig {
+  static float Core(float x) {
+    float r;
+    int32_t k = Reduce(x, r);
+    float s = SinPoly(r);
+    float c = CosPoly(r);
+    bool odd = k & 1;
+    return FastSelect(odd, -c, s) / FastSelect(odd, s, c);
+  }
+
+  static float Exact(float x) { return std::tan(x); }
+};
+
+// asin on [-0.5, 0.5] is a Taylor polynomial whose next term is below 4e-6
+// relative; above that asin(a) = pi/2 - 2 asin(sqrt((1 - a) / 2)).
+struct FastAsinBase {
+  static bool InRange(float x) { return std::abs(x) <= 1; }
+
+  static float Poly(float x) {
+    float x2 = x * x;
+    return x + x * x2 * (1.0f / 6 + x2 * (3.0f / 40 + x2 * (5.0f / 112 + x2 * (35.0f / 1152 + x2 * (63.0f / 2816 + x2 * (231.0f / 13312))))));
+  }
+
+  // Returns Poly(a) for a <= 0.5, otherwise Poly(sqrt((1 - a) / 2)).
+  static float Reduced(float a, bool small) {
+    // Out-of-range lanes take sqrt(0) rather than a NaN.
+    float d = 1 - a;
+    return Poly(FastSelect(small, a, std::sqrt(FastSelect(d > 0, d, 0) * 0.5f)));
+  }
+};
+
+struct FastAsin : FastAsinBase {
+  static float Core(float x) {
+    float a = std::abs(x);
+    bool small = a <= 0.5f;
+    float p = Reduced(a, small);
+    return std::copysign(FastSelect(small, p, kFastHalfPi - 2 * p), x);
+  }
+
+  static float Exact(float x) { return std::asin(x); }
+};
+
+struct FastAcos : FastAsinBase {
+  static float Core(float x) {
+    float a = std::abs(x);
+    bool small = a <= 0.5f;
+    float p = Reduced(a, small);
+    // Near |x| = 1 acos is 2 p directly, which keeps its relative accuracy
+    // where pi/2 - asin(x) would cancel.
+    float large = FastSelect(x > 0, 2 * p, kFastPi - 2 * p);
+    return FastSelect(small, kFastHalfPi - std::copysign(p, x), large);
+  }
+
+  static float Exact(float x) { return std::acos(x); }
+};
+
+// atan2 reduces to atan(u) for u in [0, 1]: above tan(pi/8) it uses
+// atan(u) = pi/4 + atan((u-1)/(u+1)), leaving |v| <= 0.4143 for a Taylor
+// polynomial with error below 1e-7.
+struct FastAtan2 {
+  static bool InRange(float y, float x) {
+    float ay = std::abs(y);
+    float ax = std::abs(x);
+    return std::isfinite(ax) & std::isfinite(ay) & ((ax != 0) | (ay != 0));
+  }
+
+  static float Core(float y, float x) {
+    float ay = std::abs(y);
+    float ax = std::abs(x);
+    bool swap = ay > ax;
+    float u = FastSelect(swap, ax, ay) / FastSelect(swap, ay, ax);
+    bool high = u > 0.414213562f;
+    u = FastSelect(high, (u - 1) / (u + 1), u);
+    float u2 = u * u;
+    float p = u + u * u2 * (-1.0f / 3 + u2 * (1.0f / 5 + u2 * (-1.0f / 7 + u2 * (1.0f / 9 + u2 * (-1.0f / 11 + u2 * (1.0f / 13 + u2 * (-1.0f / 15 + u2 * (1.0f / 17))))))));
+    float r = FastSelect(high, 0.785398163397448f + p, p);
+    r = FastSelect(swap, kFastHalfPi - r, r);
+    r = FastSelect(std::signbit(x), kFastPi - r, r);
+    return std::copysign(r, y);
+  }
+
+  static float Exact(float y, float x) { return std::atan2(y, x); }
+};
+
+}
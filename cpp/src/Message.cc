@@ -0,0 +1,218 @@
+#include <WickedWinchProtocol/Message.h>
+
+#include <WickedWinchProtocol/MessageDispatch.h>
+
+#include <array>
+#include <cstring>
+#include <limits>
+
+namespace wickedwinch::protocol {
+
+namespace {
+
+constexpr size_t kWinchStatusSize = MessageTraits<WickedMessageType_NotifyWinchStatus>::kMinSize;
+constexpr size_t kPathHeaderSize = PathTraits::kMinSize;
+
+constexpr size_t kMaxPayloadSize = std::numeric_limits<uint16_t>::max();
+
+template <size_t... Types>
+constexpr std::array<size_t, sizeof...(Types)> MakeMinSizeTable(std::index_sequence<Types...>) {
+  return {MessageTraits<WickedMessageType(Types)>::kMinSize...};
+}
+
+constexpr auto kMinSizes = MakeMinSizeTable(std::make_index_sequence<kMessageTypeSize>());
+
+}
+
+size_t MessagePayloadMinSize(WickedMessageType type) {
+  return size_t(type) < kMessageTypeSize ? kMinSizes[type] : 0;
+}
+
+bool MessageReader::Read(const uint8_t* data, size_t size) {
+  if (size < sizeof(WickedMessageHeader)) return false;
+  WickedMessageHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  if (size - sizeof(WickedMessageHeader) < header.payload_size) return false;
+
+  const uint8_t* payload = data + sizeof(WickedMessageHeader);
+  if (!CheckMessagePayload(WickedMessageType(header.payload_type), {payload, header.payload_size})) return false;
+
+  header_ = header;
+  payload_ = payload;
+  return true;
+}
+
+WickedPingRequest MessageReader::ping_request() const {
+  if (payload_type() != WickedMessageType_PingRequest) return {};
+  return MessageTraits<WickedMessageType_PingRequest>::Decode(payload_);
+}
+
+WickedPingResponse MessageReader::ping_response() const {
+  if (payload_type() != WickedMessageType_PingResponse) return {};
+  return MessageTraits<WickedMessageType_PingResponse>::Decode(payload_);
+}
+
+WickedBmpStatus MessageReader::bmp_status() const {
+  if (payload_type() != WickedMessageType_NotifyBmpStatus) return {};
+  return MessageTraits<WickedMessageType_NotifyBmpStatus>::Decode(payload_);
+}
+
+WickedWinchStatus MessageReader::winch_status() const {
+  if (payload_type() != WickedMessageType_NotifyWinchStatus) return {};
+  return MessageTraits<WickedMessageType_NotifyWinchStatus>::Decode(payload_);
+}
+
+WickedWinchConfig MessageReader::winch_config() const {
+  WickedMessageType type = payload_type();
+  if (type != WickedMessageType_GetWinchConfigResponse && type != WickedMessageType_SetWinchConfig) return {};
+  return FixedMessageTraits<WickedWinchConfig>::Decode(payload_);
+}
+
+std::span<const uint8_t> MessageReader::targets() const {
+  WickedMessageType type = payload_type();
+  if (type != WickedMessageType_GetWinchTargetsResponse && type != WickedMessageType_GetDmxTargetsResponse) return {};
+  return TargetListTraits::Decode(payload_);
+}
+
+uint8_t MessageReader::dmx_channel_offset() const {
+  WickedMessageType type = payload_type();
+  if (type != WickedMessageType_GetDmxConfigResponse && type != WickedMessageType_SetDmxConfig) return 0;
+  return DmxConfigTraits::Decode(payload_).channel_offset;
+}
+
+std::span<const uint8_t> MessageReader::dmx_channel_map() const {
+  WickedMessageType type = payload_type();
+  if (type != WickedMessageType_GetDmxConfigResponse && type != WickedMessageType_SetDmxConfig) return {};
+  return DmxConfigTraits::Decode(payload_).channel_map;
+}
+
+uint8_t MessageReader::winch_mode() const {
+  if (payload_type() != WickedMessageType_SetWinchPath) return 0;
+  return WinchPathTraits::Decode(payload_).mode;
+}
+
+std::span<const uint8_t> MessageReader::path_data() const {
+  WickedMessageType type = payload_type();
+  if (type != WickedMessageType_SetWinchPath && type != WickedMessageType_SetDmxPath) return {};
+  return PathTraits::path_data(payload_);
+}
+
+uint8_t* MessageWriter::Append(uint8_t target_id, WickedMessageType type, size_t payload_size) {
+  if (payload_size > kMaxPayloadSize) return nullptr;
+  WickedMessageHeader header = {target_id, uint8_t(type), uint16_t(payload_size)};
+  size_t offset = buffer_.size();
+  buffer_.resize(offset + sizeof(header) + payload_size);
+  uint8_t* data = buffer_.data() + offset;
+  std::memcpy(data, &header, sizeof(header));
+  return data + sizeof(header);
+}
+
+uint8_t* MessageWriter::AppendPath(uint8_t target_id, WickedMessageType type, size_t path_size) {
+  uint8_t* payload = Append(target_id, type, kPathHeaderSize + path_size);
+  if (!payload) return nullptr;
+  // Both path payloads keep path_size at the same offset after two bytes of
+  // mode or padding.
+  uint16_t size = path_size;
+  std::memset(payload, 0, offsetof(WickedWinchPath, path_size));
+  std::memcpy(payload + offsetof(WickedWinchPath, path_size), &size, sizeof(size));
+  return payload;
+}
+
+bool MessageWriter::Write(uint8_t target_id, WickedMessageType type) {
+  if (MessagePayloadMinSize(type) != 0) return false;
+  return Append(target_id, type, 0);
+}
+
+bool MessageWriter::Write(uint8_t target_id, const WickedPingRequest& payload) {
+  uint8_t* data = Append(target_id, WickedMessageType_PingRequest, sizeof(payload));
+  std::memcpy(data, &payload, sizeof(payload));
+  return true;
+}
+
+bool MessageWriter::Write(uint8_t target_id, const WickedPingResponse& payload) {
+  uint8_t* data = Append(target_id, WickedMessageType_PingResponse, sizeof(payload));
+  std::memcpy(data, &payload, sizeof(payload));
+  return true;
+}
+
+bool MessageWriter::Write(uint8_t target_id, const WickedBmpStatus& payload) {
+  uint8_t* data = Append(target_id, WickedMessageType_NotifyBmpStatus, sizeof(payload));
+  std::memcpy(data, &payload, sizeof(payload));
+  return true;
+}
+
+bool MessageWriter::Write(uint8_t target_id, const WickedWinchStatus& payload) {
+  uint8_t* data = Append(target_id, WickedMessageType_NotifyWinchStatus, kWinchStatusSize);
+  std::memcpy(data, &payload, kWinchStatusSize);
+  return true;
+}
+
+bool MessageWriter::Write(uint8_t target_id, WickedMessageType type, const WickedWinchConfig& payload) {
+  if (type != WickedMessageType_GetWinchConfigResponse && type != WickedMessageType_SetWinchConfig) return false;
+  uint8_t* data = Append(target_id, type, sizeof(payload));
+  std::memcpy(data, &payload, sizeof(payload));
+  return true;
+}
+
+bool MessageWriter::WriteTargets(uint8_t target_id, WickedMessageType type, std::span<const uint8_t> targets) {
+  if (type != WickedMessageType_GetWinchTargetsResponse && type != WickedMessageType_GetDmxTargetsResponse) return false;
+  if (targets.size() > std::numeric_limits<uint8_t>::max()) return false;
+  uint8_t* data = Append(target_id, type, sizeof(WickedTargetList) + targets.size());
+  data[offsetof(WickedTargetList, targets_size)] = targets.size();
+  std::memcpy(data + sizeof(WickedTargetList), targets.data(), targets.size());
+  return true;
+}
+
+bool MessageWriter::WriteDmxConfig(
+    uint8_t target_id, WickedMessageType type,
+    uint8_t channel_offset, std::span<const uint8_t> channel_map) {
+  if (type != WickedMessageType_GetDmxConfigResponse && type != WickedMessageType_SetDmxConfig) return false;
+  if (channel_map.size() > std::numeric_limits<uint8_t>::max()) return false;
+  uint8_t* data = Append(target_id, type, sizeof(WickedDmxConfig) + channel_map.size());
+  data[offsetof(WickedDmxConfig, channel_offset)] = channel_offset;
+  data[offsetof(WickedDmxConfig, channel_size)] = channel_map.size();
+  std::memcpy(data + sizeof(WickedDmxConfig), channel_map.data(), channel_map.size());
+  return true;
+}
+
+bool MessageWriter::WriteWinchPath(uint8_t target_id, uint8_t mode, std::span<const uint8_t> path) {
+  uint8_t* data = AppendPath(target_id, WickedMessageType_SetWinchPath, path.size());
+  if (!data) return false;
+  data[offsetof(WickedWinchPath, mode)] = mode;
+  std::memcpy(data + kPathHeaderSize, path.data(), path.size());
+  return true;
+}
+
+bool MessageWriter::WriteDmxPath(uint8_t target_id, std::span<const uint8_t> path) {
+  uint8_t* data = AppendPath(target_id, WickedMessageType_SetDmxPath, path.size());
+  if (!data) return false;
+  std::memcpy(data + kPathHeaderSize, path.data(), path.size());
+  return true;
+}
+
+bool MessageWriter::WriteWinchPath(uint8_t target_id, uint8_t mode, const PathBuilder& path) {
+  size_t offset = buffer_.size();
+  size_t path_size = path.data_size();
+  uint8_t* data = AppendPath(target_id, WickedMessageType_SetWinchPath, path_size);
+  if (!data) return false;
+  data[offsetof(WickedWinchPath, mode)] = mode;
+  if (!path.Write(data + kPathHeaderSize, path_size)) {
+    buffer_.resize(offset);
+    return false;
+  }
+  return true;
+}
+
+bool MessageWriter::WriteDmxPath(uint8_t target_id, const PathBuilder& path) {
+  size_t offset = buffer_.size();
+  size_t path_size = path.data_size();
+  uint8_t* data = AppendPath(target_id, WickedMessageType_SetDmxPath, path_size);
+  if (!data) return false;
+  if (!path.Write(data + kPathHeaderSize, path_size)) {
+    buffer_.resize(offset);
+    return false;
+  }
+  return true;
+}
+
+}
@@ -0,0 +1,137 @@
+#include <WickedWinchProtocol/MessageBatch.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <limits>
+
+#include <unistd.h>
+
+namespace wickedwinch::protocol {
+
+namespace {
+
+constexpr size_t kMaxPayloadSize = std::numeric_limits<uint16_t>::max();
+constexpr size_t kPathHeaderSize = sizeof(WickedWinchPath);
+
+#ifdef IOV_MAX
+constexpr size_t kMaxIovecs = IOV_MAX;
+#else
+constexpr size_t kMaxIovecs = 1024;
+#endif
+
+}
+
+uint8_t* MessageBatch::AddHeader(uint8_t target_id, WickedMessageType type, size_t payload_size, size_t header_size) {
+  WickedMessageHeader header = {target_id, uint8_t(type), uint16_t(payload_size)};
+  size_t offset = data_.size();
+  size_t size = sizeof(header) + header_size;
+  data_.resize(offset + size);
+  std::memcpy(data_.data() + offset, &header, sizeof(header));
+
+  if (!parts_.empty() && parts_.back().data == nullptr) {
+    parts_.back().size += size;
+  } else {
+    parts_.push_back({nullptr, offset, size});
+  }
+  ++message_size_;
+  data_size_ += size;
+  return data_.data() + offset + sizeof(header);
+}
+
+void MessageBatch::AddBytes(std::span<const uint8_t> data) {
+  if (data.empty()) return;
+  if (data.size() >= kReferenceSize) {
+    parts_.push_back({data.data(), 0, data.size()});
+  } else {
+    // Copied bytes follow the header just added, so they extend its part.
+    data_.insert(data_.end(), data.begin(), data.end());
+    parts_.back().size += data.size();
+  }
+  data_size_ += data.size();
+}
+
+bool MessageBatch::Add(uint8_t target_id, WickedMessageType type, std::span<const uint8_t> payload) {
+  if (payload.size() > kMaxPayloadSize) return false;
+  AddHeader(target_id, type, payload.size(), 0);
+  AddBytes(payload);
+  return true;
+}
+
+bool MessageBatch::AddPath(uint8_t target_id, WickedMessageType type, uint8_t mode, std::span<const uint8_t> path) {
+  if (path.size() > kMaxPayloadSize - kPathHeaderSize) return false;
+  static_assert(offsetof(WickedWinchPath, path_size) == offsetof(WickedDmxPath, path_size));
+  uint8_t* header = AddHeader(target_id, type, kPathHeaderSize + path.size(), kPathHeaderSize);
+  uint16_t path_size = path.size();
+  std::memset(header, 0, kPathHeaderSize);
+  header[offsetof(WickedWinchPath, mode)] = mode;
+  std::memcpy(header + offsetof(WickedWinchPath, path_size), &path_size, sizeof(path_size));
+  AddBytes(path);
+  return true;
+}
+
+bool MessageBatch::AddWinchPath(uint8_t target_id, uint8_t mode, std::span<const uint8_t> path) {
+  return AddPath(target_id, WickedMessageType_SetWinchPath, mode, path);
+}
+
+bool MessageBatch::AddDmxPath(uint8_t target_id, std::span<const uint8_t> path) {
+  return AddPath(target_id, WickedMessageType_SetDmxPath, 0, path);
+}
+
+std::span<const iovec> MessageBatch::iovecs() {
+  // Built on demand, as data_ may move while messages are added.
+  iovecs_.resize(parts_.size());
+  for (size_t i = 0; i < parts_.size(); ++i) {
+    const Part& part = parts_[i];
+    const uint8_t* data = part.data ? part.data : data_.data() + part.offset;
+    iovecs_[i] = {const_cast<uint8_t*>(data), part.size};
+  }
+  return iovecs_;
+}
+
+void MessageBatch::Gather(std::vector<uint8_t>& buffer) const {
+  buffer.resize(data_size_);
+  uint8_t* out = buffer.data();
+  for (const Part& part : parts_) {
+    const uint8_t* data = part.data ? part.data : data_.data() + part.offset;
+    std::memcpy(out, data, part.size);
+    out += part.size;
+  }
+}
+
+bool MessageBatch::Flush(int fd, size_t* writes) {
+  if (writes) *writes = 0;
+  iovecs();
+  iovec* next = iovecs_.data();
+  iovec* end = next + iovecs_.size();
+  while (next != end) {
+    ssize_t written = writev(fd, next, std::min<size_t>(end - next, kMaxIovecs));
+    if (writes) ++*writes;
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    // Skip the iovecs written and trim a partly written one.
+    size_t remaining = written;
+    while (next != end && remaining >= next->iov_len) {
+      remaining -= next->iov_len;
+      ++next;
+    }
+    if (remaining > 0) {
+      next->iov_base = static_cast<uint8_t*>(next->iov_base) + remaining;
+      next->iov_len -= remaining;
+    }
+  }
+  return true;
+}
+
+void MessageBatch::clear() {
+  data_.clear();
+  parts_.clear();
+  iovecs_.clear();
+  message_size_ = 0;
+  data_size_ = 0;
+}
+
+}
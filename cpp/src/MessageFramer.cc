@@ -0,0 +1,56 @@
+#include <WickedWinchProtocol/MessageFramer.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace wickedwinch::protocol {
+
+MessageFramer::MessageFramer(size_t capacity) {
+  capacity = std::bit_ceil(std::max(capacity, kMaxMessageSize));
+  buffer_.resize(capacity + kMaxMessageSize - 1);
+  mask_ = capacity - 1;
+}
+
+void MessageFramer::Copy(size_t pos, uint8_t* data, size_t size) const {
+  size_t begin = pos & mask_;
+  size_t first = std::min(size, capacity() - begin);
+  std::memcpy(data, buffer_.data() + begin, first);
+  std::memcpy(data + first, buffer_.data(), size - first);
+}
+
+size_t MessageFramer::PushWrapped(std::span<const uint8_t> data) {
+  size_t size = std::min(data.size(), capacity() - this->size());
+  size_t begin = write_ & mask_;
+  size_t first = std::min(size, capacity() - begin);
+  std::memcpy(buffer_.data() + begin, data.data(), first);
+  std::memcpy(buffer_.data(), data.data() + first, size - first);
+  write_ += size;
+  return size;
+}
+
+std::span<uint8_t> MessageFramer::write_span() {
+  size_t begin = write_ & mask_;
+  return {buffer_.data() + begin, std::min(capacity() - size(), capacity() - begin)};
+}
+
+std::span<const uint8_t> MessageFramer::NextWrapped() {
+  size_t available = size();
+  if (available < sizeof(WickedMessageHeader)) return {};
+  WickedMessageHeader header;
+  Copy(read_, reinterpret_cast<uint8_t*>(&header), sizeof(header));
+  size_t message_size = sizeof(header) + header.payload_size;
+  if (available < message_size) return {};
+
+  size_t begin = read_ & mask_;
+  read_ += message_size;
+  size_t end = begin + message_size;
+  if (end > capacity()) {
+    // Make the message contiguous by copying the part at the start of the
+    // ring past its end.
+    std::memcpy(buffer_.data() + capacity(), buffer_.data(), end - capacity());
+  }
+  return {buffer_.data() + begin, message_size};
+}
+
+}
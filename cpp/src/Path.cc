@@ -1,39 +1,111 @@
 #include <WickedWinchProtocol/Path.h>
 
+#include <WickedWinchProtocol/PathIndex.h>
+#include <WickedWinchProtocol/PostfixProgram.h>
+
+#include "PathLayout.h"
+
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstddef>
 
 namespace wickedwinch::protocol {
 
-uint8_t PathReader::SegmentAt(uint32_t t) const {
-  if (buffer_ == nullptr) return kNoSegment;
+static_assert(offsetof(PathSegmentHeader, start_time) == 0);
+static_assert(offsetof(PathLargeSegmentHeader, start_time) == 0);
+
+namespace {
+
+// Numbers reads so that cursors never mistake a new path read into a reused
+// buffer for the one they cached.
+std::atomic<uint64_t> next_generation{1};
+
+// The number of segments whose start time is at or before t, comparing
+// relative to base. The halving loop compiles to conditional moves, so
+// scattered lookups do not pay for mispredicted branches.
+template <typename Header>
+uint32_t UpperBound(const uint8_t* headers, uint32_t size, uint32_t base, uint32_t t) {
+  if (size == 0) return 0;
+  auto* begin = reinterpret_cast<const Header*>(headers);
+  const Header* first = begin;
+  uint32_t key = t - base;
+  while (size > 1) {
+    uint32_t half = size / 2;
+    first = first[half].start_time - base <= key ? first + half : first;
+    size -= half;
+  }
+  return uint32_t(first - begin) + (first->start_time - base <= key);
+}
 
-  const PathSegmentHeader* begin = segment_header_data();
-  const PathSegmentHeader* end = begin + segment_header_size();
+}
 
-  uint32_t begin_time = 0;
-  if (header()->flags & PathHeader::Overflow) {
-    begin_time = begin->start_time;
+uint32_t PathReader::base_time() const {
+  if (header()->flags & PathHeader::Overflow && segment_header_size() > 0) {
+    return start_time(0);
   }
-  struct StartTimeLess {
-    uint32_t begin_time;
+  return 0;
+}
+
+uint32_t PathReader::SegmentAt(uint32_t t) const {
+  if (buffer_ == nullptr) return kNoSegment;
+
+  uint32_t base = base_time();
+  uint32_t n = large()
+      ? UpperBound<PathLargeSegmentHeader>(segment_headers_, segment_size_, base, t)
+      : UpperBound<PathSegmentHeader>(segment_headers_, segment_size_, base, t);
+  return n == 0 ? kNoSegment : n - 1;
+}
+
+void PathReader::Seek(PathCursor& cursor, uint32_t i, uint32_t base) const {
+  uint32_t size = segment_header_size();
+  uint32_t next = i == kNoSegment ? 0 : i + 1;
+  cursor.generation = generation_;
+  cursor.segment = i;
+  cursor.begin = i == kNoSegment ? 0 : start_time(i) - base;
+  cursor.end = next < size ? start_time(next) - base : uint64_t(1) << 32;
+}
+
+uint32_t PathReader::SegmentAt(uint32_t t, PathCursor& cursor) const {
+  return CursorSegmentAt(t, cursor, nullptr);
+}
+
+uint32_t PathReader::SegmentAt(uint32_t t, PathCursor& cursor, const PathIndex& index) const {
+  return CursorSegmentAt(t, cursor, &index);
+}
+
+uint32_t PathReader::CursorSegmentAt(uint32_t t, PathCursor& cursor, const PathIndex* index) const {
+  if (buffer_ == nullptr) return kNoSegment;
 
-    bool operator()(uint32_t t, const PathSegmentHeader& segment) const {
-      return t - begin_time < segment.start_time - begin_time;
+  uint32_t base = base_time();
+  uint32_t key = t - base;
+  // A cursor from the same read never holds a segment past the end, but a
+  // stale one must not index the headers.
+  uint32_t size = segment_header_size();
+  if (cursor.generation == generation_ && (cursor.segment < size || cursor.segment == kNoSegment)) {
+    if (key >= cursor.begin && key < cursor.end) return cursor.segment;
+    // Crossing into the next segment is the common case during playback.
+    uint32_t next = cursor.segment == kNoSegment ? 0 : cursor.segment + 1;
+    if (key >= cursor.end && next < size) {
+      Seek(cursor, next, base);
+      if (key < cursor.end) return next;
     }
-  };
-  const PathSegmentHeader* segment =
-      std::upper_bound(begin, end, t, StartTimeLess{.begin_time = begin_time});
-  if (segment == begin) return kNoSegment;
-  --segment;
-  return uint8_t(segment - begin);
+  }
+  Seek(cursor, index ? index->SegmentAt(t) : SegmentAt(t), base);
+  return cursor.segment;
+}
+
+EvalStatus PathReader::Eval(uint32_t t, PostfixStack& stack, PostfixPrecision precision) const {
+  PathCursor cursor;
+  return Eval(t, cursor, stack, precision);
 }
 
-EvalStatus PathReader::Eval(uint32_t t, PostfixStack& stack) const {
-  uint8_t i = SegmentAt(t);
+EvalStatus PathReader::Eval(
+    uint32_t t, PathCursor& cursor, PostfixStack& stack, PostfixPrecision precision) const {
+  uint32_t i = SegmentAt(t, cursor);
   if (i == kNoSegment) return EvalStatus::UndefinedOperation;
 
-  const PathSegmentHeader& segment = segment_header(i);
+  PathLargeSegmentHeader segment = segment_header(i);
   PathSegmentReader reader;
   reader.start_time = segment.start_time;
   if (!reader.expr.Read(buffer_ + segment.offset, segment.size)) {
@@ -43,55 +115,115 @@ EvalStatus PathReader::Eval(uint32_t t, PostfixStack& stack) const {
   float st = float(t - segment.start_time) * 1e-3f;
   stack.clear();
   stack.push(st);
-  return stack.Eval(reader.expr);
+  return stack.Eval(reader.expr, precision);
+}
+
+EvalStatus PathReader::EvalBatch(
+    std::span<const uint32_t> times, size_t width, std::span<float> out,
+    PostfixBatchStack& stack, PostfixPrecision precision) const {
+  if (out.size() < times.size() * width) return EvalStatus::IllegalOperation;
+
+  PostfixProgram program;
+  uint32_t program_segment = kNoSegment;
+  PathCursor cursor;
+  for (size_t i = 0; i < times.size();) {
+    uint32_t s = SegmentAt(times[i], cursor);
+    if (s == kNoSegment) return EvalStatus::UndefinedOperation;
+
+    PathLargeSegmentHeader segment = segment_header(s);
+    if (s != program_segment) {
+      PostfixReader reader;
+      if (!reader.Read(buffer_ + segment.offset, segment.size)) {
+        return EvalStatus::IllegalOperation;
+      }
+      if (EvalStatus status = program.Verify(reader, 1); status != EvalStatus::Ok) {
+        return status;
+      }
+      if (program.output_size() < width) return EvalStatus::StackUnderflow;
+      program_segment = s;
+    }
+
+    size_t n = 1;
+    while (n < kBatchLanes && i + n < times.size() && SegmentAt(times[i + n], cursor) == s) ++n;
+
+    if (stack.stack_capacity < 1) return EvalStatus::StackOverflow;
+    stack.clear();
+    float* st = stack.slot(stack.stack_size++);
+    for (size_t l = 0; l < kBatchLanes; ++l) {
+      st[l] = float(times[i + std::min(l, n - 1)] - segment.start_time) * 1e-3f;
+    }
+    if (EvalStatus status = stack.Eval(program, precision); status != EvalStatus::Ok) return status;
+
+    for (size_t l = 0; l < n; ++l) {
+      float* frame = &out[(i + l) * width];
+      for (size_t k = 0; k < width; ++k) {
+        frame[k] = stack.slot(k)[l];
+      }
+    }
+    i += n;
+  }
+  return EvalStatus::Ok;
 }
 
 bool PathReader::Read(const uint8_t* data, size_t size) {
   buffer_ = data;
+  generation_ = next_generation.fetch_add(1, std::memory_order_relaxed);
+  segment_size_ = 0;
   if (size < sizeof(PathHeader)) return false;
-  if (size < segment_header_offset() + segment_header_size() * sizeof(PathSegmentHeader)) {
-    return false;
+
+  size_t headers_offset = sizeof(PathHeader);
+  uint32_t segment_size = header()->segment_size;
+  segment_header_stride_ = sizeof(PathSegmentHeader);
+  if (large()) {
+    if (size < sizeof(PathHeader) + sizeof(PathLargeHeader)) return false;
+    auto* large = reinterpret_cast<const PathLargeHeader*>(data + sizeof(PathHeader));
+    if (large->version != PathLargeHeader::kVersion) return false;
+    headers_offset += sizeof(PathLargeHeader);
+    segment_size = large->segment_size;
+    segment_header_stride_ = sizeof(PathLargeSegmentHeader);
   }
+  if ((size - headers_offset) / segment_header_stride_ < segment_size) return false;
+  segment_headers_ = data + headers_offset;
+  segment_size_ = segment_size;
 
   PostfixReader expr;
-  for (uint8_t i = 0; i < segment_header_size(); ++i) {
-    const PathSegmentHeader& segment = segment_header(i);
-    if (size < segment.offset + segment.size) return false;
+  for (uint32_t i = 0; i < segment_size_; ++i) {
+    PathLargeSegmentHeader segment = segment_header(i);
+    if (size < size_t(segment.offset) + segment.size) return false;
     if (!expr.Read(buffer_ + segment.offset, segment.size)) return false;
   }
   return true;
 }
 
-uint16_t PathWriter::data_size() const {
-  size_t size = sizeof(PathHeader) + segments_.size() * sizeof(PathSegmentHeader);
+size_t PathWriter::data_size() const {
+  size_t size = 0;
   for (const PathSegmentWriter& segment : segments_) {
     size += (segment.expr.data_size() + 3) & ~3;
   }
-  return uint16_t(size);
+  return PathLayout(segments_.size(), size).data_size();
 }
 
 bool PathWriter::Write(uint8_t* data, size_t size) const {
-  const size_t headers_size = sizeof(PathHeader) + segments_.size() * sizeof(PathSegmentHeader);
-  if (size < headers_size) return false;
+  size_t expr_size = 0;
+  for (const PathSegmentWriter& segment : segments_) {
+    expr_size += (segment.expr.data_size() + 3) & ~3;
+  }
+  PathLayout layout(segments_.size(), expr_size);
+  if (!layout.valid() || size < layout.data_size()) return false;
 
+  layout.WriteHeader(data);
   auto* header = reinterpret_cast<PathHeader*>(data);
-  header->segment_size = uint8_t(segments_.size());
-  header->flags = 0;
-
-  auto* segment_header = reinterpret_cast<PathSegmentHeader*>(data + sizeof(PathHeader));
-  uint16_t offset = uint16_t(headers_size);
-  for (const PathSegmentWriter& segment : segments_) {
-    if (offset > headers_size && segment.start_time < (segment_header-1)->start_time) {
+  size_t offset = layout.headers_size();
+  for (size_t i = 0; i < segments_.size(); ++i) {
+    const PathSegmentWriter& segment = segments_[i];
+    if (i > 0 && segment.start_time < segments_[i - 1].start_time) {
       header->flags |= PathHeader::Overflow;
     }
-    segment_header->start_time = segment.start_time;
-    segment_header->offset = offset;
-    segment_header->size = segment.expr.data_size();
+    layout.WriteSegment(data, i, segment.start_time, offset, segment.expr.data_size());
     if (!segment.expr.Write(data + offset, size - offset)) return false;
-    offset += uint16_t((segment_header->size + 3) & ~3);
-    ++segment_header;
+    offset += (segment.expr.data_size() + 3) & ~3;
   }
   return true;
 }
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,77 @@
+#include <WickedWinchProtocol/PathBuilder.h>
+
+#include <WickedWinchProtocol/Path.h>
+
+#include "PathLayout.h"
+
+#include <cstring>
+#include <limits>
+
+namespace wickedwinch::protocol {
+
+namespace {
+
+constexpr size_t Align4(size_t size) { return (size + 3) & ~size_t(3); }
+
+}
+
+size_t PathBuilder::expr_size(size_t s) const {
+  const Segment& segment = segments_[s];
+  size_t f_offset = Align4(sizeof(PostfixHeader) + (op_end(s) - segment.op_begin) + (i_end(s) - segment.i_begin));
+  return f_offset + (f_end(s) - segment.f_begin) * sizeof(float);
+}
+
+size_t PathBuilder::expr_data_size() const {
+  size_t size = 0;
+  for (size_t s = 0; s < segments_.size(); ++s) size += Align4(expr_size(s));
+  return size;
+}
+
+size_t PathBuilder::data_size() const {
+  return PathLayout(segments_.size(), expr_data_size()).data_size();
+}
+
+bool PathBuilder::Write(uint8_t* data, size_t size) const {
+  PathLayout layout(segments_.size(), expr_data_size());
+  if (!layout.valid() || size < layout.data_size()) return false;
+
+  layout.WriteHeader(data);
+  auto* header = reinterpret_cast<PathHeader*>(data);
+  size_t offset = layout.headers_size();
+  for (size_t s = 0; s < segments_.size(); ++s) {
+    const Segment& segment = segments_[s];
+    size_t op_size = op_end(s) - segment.op_begin;
+    size_t i_size = i_end(s) - segment.i_begin;
+    size_t f_size = f_end(s) - segment.f_begin;
+    if (op_size > std::numeric_limits<uint8_t>::max() ||
+        i_size > std::numeric_limits<uint8_t>::max() ||
+        f_size > std::numeric_limits<uint16_t>::max()) {
+      return false;
+    }
+
+    if (s > 0 && segment.start_time < segments_[s - 1].start_time) {
+      header->flags |= PathHeader::Overflow;
+    }
+    size_t expr_size = this->expr_size(s);
+    layout.WriteSegment(data, s, segment.start_time, offset, expr_size);
+
+    uint8_t* expr = data + offset;
+    auto* expr_header = reinterpret_cast<PostfixHeader*>(expr);
+    expr_header->op_size = uint8_t(op_size);
+    expr_header->i_size = uint8_t(i_size);
+    expr_header->f_size = uint16_t(f_size);
+
+    // Padding is zeroed so the output matches PathWriter byte for byte.
+    size_t i_offset = sizeof(PostfixHeader) + op_size;
+    size_t f_offset = Align4(i_offset + i_size);
+    memcpy(expr + sizeof(PostfixHeader), op_.data() + segment.op_begin, op_size);
+    memcpy(expr + i_offset, i_.data() + segment.i_begin, i_size);
+    memset(expr + i_offset + i_size, 0, f_offset - i_offset - i_size);
+    memcpy(expr + f_offset, f_.data() + segment.f_begin, f_size * sizeof(float));
+
+    offset += Align4(expr_size);
+  }
+  return true;
+}
+
+}
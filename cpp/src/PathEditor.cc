@@ -0,0 +1,185 @@
+#include <WickedWinchProtocol/PathEditor.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+namespace wickedwinch::protocol {
+
+namespace {
+
+constexpr size_t kMinHeaderCapacity = 8;
+// The editor writes the small format, whose counts, offsets and sizes are
+// 16 bits. Trim advances past expired headers rather than shifting the live
+// ones, so its cost does not grow with the segment count up to this limit.
+constexpr size_t kMaxSegments = std::numeric_limits<uint16_t>::max();
+constexpr size_t kMaxSize = std::numeric_limits<uint16_t>::max();
+
+constexpr size_t Align4(size_t size) { return (size + 3) & ~size_t(3); }
+
+// The header slot count that holds n segments, doubling from current.
+size_t HeaderCapacity(size_t current, size_t n) {
+  size_t capacity = std::max(current, kMinHeaderCapacity);
+  while (capacity < n) capacity *= 2;
+  return std::min(capacity, kMaxSegments);
+}
+
+}
+
+void PathEditor::Clear() {
+  buffer_.assign(sizeof(PathHeader), 0);
+  header_capacity_ = 0;
+  head_ = 0;
+  live_begin_ = sizeof(PathHeader);
+  decreases_ = 0;
+}
+
+bool PathEditor::Load(std::span<const uint8_t> path) {
+  Clear();
+  return Append(path);
+}
+
+bool PathEditor::Fits(size_t segments, size_t size) const {
+  size_t n = segment_size() + segments;
+  if (n > kMaxSegments) return false;
+  return LayoutSize(HeaderCapacity(header_capacity_, n), size) <= kMaxSize;
+}
+
+void PathEditor::CompactHeaders() {
+  PathSegmentHeader* segments = segment_header_data();
+  uint32_t n = segment_size();
+  memmove(segments, segments + head_, n * sizeof(PathSegmentHeader));
+  memset(segments + n, 0, head_ * sizeof(PathSegmentHeader));
+  head_ = 0;
+}
+
+void PathEditor::Relocate(size_t begin) {
+  if (head_ != 0) CompactHeaders();
+  size_t live = buffer_.size() - live_begin_;
+  if (begin > live_begin_) {
+    buffer_.resize(begin + live);
+    memmove(buffer_.data() + begin, buffer_.data() + live_begin_, live);
+  } else {
+    memmove(buffer_.data() + begin, buffer_.data() + live_begin_, live);
+    buffer_.resize(begin + live);
+  }
+  // Clear the spare header slots, which may hold stale data.
+  size_t used = sizeof(PathHeader) + segment_size() * sizeof(PathSegmentHeader);
+  memset(buffer_.data() + used, 0, begin - used);
+
+  PathSegmentHeader* segments = segment_header_data();
+  for (uint32_t i = 0; i < segment_size(); ++i) {
+    segments[i].offset = uint16_t(segments[i].offset - live_begin_ + begin);
+  }
+  live_begin_ = begin;
+}
+
+size_t PathEditor::Reserve(size_t size) {
+  size_t padded = Align4(size);
+  if (!Fits(1, padded)) return 0;
+
+  uint32_t n = segment_size();
+  if (head_ + n == header_capacity_) {
+    // Compacting moves the live headers, which the trims that killed at
+    // least as many paid for. Otherwise the slots double, which the appends
+    // since they last did pay for, unless that no longer fits.
+    size_t capacity = HeaderCapacity(header_capacity_, header_capacity_ + 1);
+    bool grow = head_ == 0 ||
+        (head_ < n && capacity > header_capacity_ && LayoutSize(capacity, padded) <= kMaxSize);
+    if (grow) {
+      header_capacity_ = uint16_t(capacity);
+      Relocate(header_end());
+    } else {
+      CompactHeaders();
+    }
+  }
+  if (buffer_.size() + padded > kMaxSize) Relocate(header_end());
+  size_t offset = buffer_.size();
+  buffer_.resize(offset + padded);
+  return offset;
+}
+
+void PathEditor::Commit(uint32_t start_time, size_t offset, size_t size) {
+  uint32_t n = segment_size();
+  PathSegmentHeader* segments = segment_header_data() + head_;
+  segments[n] = {.start_time = start_time, .offset = uint16_t(offset), .size = uint16_t(size)};
+  if (n > 0 && start_time < segments[n - 1].start_time) {
+    ++decreases_;
+    header()->flags |= PathHeader::Overflow;
+  }
+  header()->segment_size = n + 1;
+}
+
+bool PathEditor::Append(uint32_t start_time, std::span<const uint8_t> expr) {
+  PostfixReader reader;
+  if (!reader.Read(expr)) return false;
+  size_t offset = Reserve(expr.size());
+  if (offset == 0) return false;
+  memcpy(buffer_.data() + offset, expr.data(), expr.size());
+  Commit(start_time, offset, expr.size());
+  return true;
+}
+
+bool PathEditor::Append(uint32_t start_time, const PostfixWriter& expr) {
+  size_t size = expr.data_size();
+  size_t offset = Reserve(size);
+  if (offset == 0) return false;
+  expr.Write(buffer_.data() + offset, size);
+  Commit(start_time, offset, size);
+  return true;
+}
+
+bool PathEditor::Append(std::span<const uint8_t> path) {
+  PathReader reader;
+  if (!reader.Read(path)) return false;
+
+  size_t size = 0;
+  for (uint32_t i = 0; i < reader.segment_header_size(); ++i) {
+    size += Align4(reader.segment_header(i).size);
+  }
+  if (!Fits(reader.segment_header_size(), size)) return false;
+
+  for (uint32_t i = 0; i < reader.segment_header_size(); ++i) {
+    bool appended = Append(reader.start_time(i), reader.segment_data(i));
+    assert(appended);
+    (void)appended;
+  }
+  return true;
+}
+
+size_t PathEditor::Trim(uint32_t t) {
+  uint32_t n = segment_size();
+  if (n == 0) return 0;
+
+  // Same ordering as PathReader::SegmentAt: segment k is the last whose start
+  // time is at or before t. Trims usually cut a few segments, so gallop from
+  // the front and binary-search the bracket, in O(log k).
+  PathSegmentHeader* segments = segment_header_data() + head_;
+  uint32_t base = header()->flags & PathHeader::Overflow ? segments[0].start_time : 0;
+  uint32_t key = t - base;
+  auto started = [&](const PathSegmentHeader& segment) { return segment.start_time - base <= key; };
+  uint32_t low = 1;
+  uint32_t high = 1;
+  while (high < n && started(segments[high])) {
+    low = high + 1;
+    high *= 2;
+  }
+  const PathSegmentHeader* end = std::partition_point(segments + low, segments + std::min(high, n), started);
+  uint32_t k = uint32_t(end - segments) - 1;
+  if (k == 0) return 0;
+
+  for (uint32_t i = 1; i <= k; ++i) {
+    if (segments[i].start_time < segments[i - 1].start_time) --decreases_;
+  }
+  head_ += k;
+  header()->segment_size = n - k;
+  if (decreases_ == 0) header()->flags &= ~PathHeader::Overflow;
+
+  live_begin_ = segments[k].offset;
+  size_t dead = live_begin_ - header_end();
+  if (dead > buffer_.size() - live_begin_) Relocate(header_end());
+  return k;
+}
+
+}
@@ -0,0 +1,147 @@
+#include <WickedWinchProtocol/PathEngine.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace wickedwinch::protocol {
+
+PathEngine::PathEngine(size_t workers) {
+  workers = std::max<size_t>(workers, 1);
+  ranges_ = std::make_unique<Range[]>(workers);
+  threads_.reserve(workers - 1);
+  for (size_t w = 1; w < workers; ++w) {
+    threads_.emplace_back([this, w] { Run(w); });
+  }
+}
+
+PathEngine::~PathEngine() {
+  stop_ = true;
+  generation_.fetch_add(1);
+  generation_.notify_all();
+  for (std::thread& thread : threads_) thread.join();
+}
+
+void PathEngine::Load(Target& target, const PathReader& reader, size_t stack_capacity) {
+  target.path.Load(reader);
+  target.cursor = {};
+  if (stack_capacity == 0) {
+    stack_capacity = 1;
+    for (const PathProgram::Segment& segment : target.path.segments()) {
+      if (segment.status == EvalStatus::Ok) {
+        stack_capacity = std::max(stack_capacity, segment.program.max_stack_size());
+      }
+    }
+  }
+  target.slot = nullptr;
+  ResizeStack(target, stack_capacity);
+}
+
+void PathEngine::ResizeStack(Target& target, size_t stack_capacity) {
+  if (target.stack_data.size() < stack_capacity) target.stack_data.resize(stack_capacity);
+  target.stack = PostfixStack{
+    .stack_data     = target.stack_data.data(),
+    .stack_size     = 0,
+    .stack_capacity = target.stack_data.size(),
+  };
+  target.status = EvalStatus::UndefinedOperation;
+}
+
+size_t PathEngine::AddTarget(const PathReader& reader, size_t stack_capacity) {
+  auto& target = targets_.emplace_back(std::make_unique<Target>());
+  Load(*target, reader, stack_capacity);
+  return targets_.size() - 1;
+}
+
+size_t PathEngine::AddTarget(PathSlot& slot, size_t stack_capacity) {
+  assert(slot.readers() >= workers());
+  auto& target = targets_.emplace_back(std::make_unique<Target>());
+  target->slot = &slot;
+  ResizeStack(*target, stack_capacity);
+  return targets_.size() - 1;
+}
+
+void PathEngine::SetPath(size_t target, const PathReader& reader, size_t stack_capacity) {
+  Load(*targets_[target], reader, stack_capacity);
+}
+
+PathEngineStats PathEngine::Eval(uint32_t t, PostfixPrecision precision) {
+  auto start = std::chrono::steady_clock::now();
+
+  const size_t n = workers();
+  for (size_t w = 0; w < n; ++w) {
+    ranges_[w].next.store(targets_.size() * w / n, std::memory_order_relaxed);
+    ranges_[w].end = targets_.size() * (w + 1) / n;
+  }
+  time_ = t;
+  precision_ = precision;
+  failed_.store(0, std::memory_order_relaxed);
+
+  if (n > 1) {
+    pending_.store(n - 1, std::memory_order_relaxed);
+    generation_.fetch_add(1, std::memory_order_release);
+    generation_.notify_all();
+  }
+  Work(0);
+  if (n > 1) {
+    // Spin briefly; at device tick rates the pool usually finishes within
+    // the caller's own share.
+    for (int spin = 0; spin < 1024 && pending_.load(std::memory_order_acquire) != 0; ++spin) {
+      std::this_thread::yield();
+    }
+    for (size_t left; (left = pending_.load(std::memory_order_acquire)) != 0;) {
+      pending_.wait(left, std::memory_order_acquire);
+    }
+  }
+
+  return PathEngineStats{
+    .latency = std::chrono::steady_clock::now() - start,
+    .failed  = failed_.load(std::memory_order_relaxed),
+  };
+}
+
+void PathEngine::Work(size_t worker) {
+  const size_t n = workers();
+  size_t failed = 0;
+  // Own range first, then steal from the others in order.
+  for (size_t k = 0; k < n; ++k) {
+    Range& range = ranges_[(worker + k) % n];
+    for (size_t i; (i = range.next.fetch_add(1, std::memory_order_relaxed)) < range.end;) {
+      Target& target = *targets_[i];
+      Eval(target, worker);
+      failed += target.status != EvalStatus::Ok;
+    }
+  }
+  if (failed) failed_.fetch_add(failed, std::memory_order_relaxed);
+}
+
+void PathEngine::Eval(Target& target, size_t worker) {
+  if (target.slot == nullptr) {
+    target.status = target.path.Eval(time_, target.cursor, target.stack, precision_);
+    return;
+  }
+
+  PathSlot::Guard path = target.slot->Read(worker);
+  if (!path) {
+    target.stack.clear();
+    target.status = EvalStatus::UndefinedOperation;
+    return;
+  }
+  if (path.version() != target.version) {
+    target.cursor = {};
+    target.version = path.version();
+  }
+  target.status = path->Eval(time_, target.cursor, target.stack, precision_);
+}
+
+void PathEngine::Run(size_t worker) {
+  uint32_t seen = 0;
+  for (;;) {
+    generation_.wait(seen, std::memory_order_acquire);
+    seen = generation_.load(std::memory_order_acquire);
+    if (stop_) return;
+    Work(worker);
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) pending_.notify_one();
+  }
+}
+
+}
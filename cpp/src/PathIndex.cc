@@ -0,0 +1,72 @@
+#include <WickedWinchProtocol/PathIndex.h>
+
+#include <algorithm>
+#include <bit>
+
+namespace wickedwinch::protocol {
+
+namespace {
+
+// The number of keys at or below key, as a branch-free halving loop.
+uint32_t UpperBound(const uint32_t* keys, uint32_t size, uint32_t key) {
+  if (size == 0) return 0;
+  const uint32_t* first = keys;
+  while (size > 1) {
+    uint32_t half = size / 2;
+    first = first[half] <= key ? first + half : first;
+    size -= half;
+  }
+  return uint32_t(first - keys) + (*first <= key);
+}
+
+}
+
+void PathIndex::Build(const PathReader& reader) {
+  reader_ = reader;
+  keys_.clear();
+  buckets_.clear();
+  shift_ = 0;
+
+  uint32_t n = reader.segment_header_size();
+  if (n == 0) return;
+  base_ = reader.base_time();
+  keys_.resize(n);
+  for (uint32_t i = 0; i < n; ++i) {
+    keys_[i] = reader.start_time(i) - base_;
+    if (i > 0 && keys_[i] < keys_[i - 1]) {
+      keys_.clear();
+      return;
+    }
+  }
+
+  // At least one bucket per segment, each as narrow as the span allows.
+  uint32_t first = keys_.front();
+  int bucket_bits = int(std::bit_width(n - 1));
+  shift_ = std::max(0, int(std::bit_width(keys_.back() - first)) - bucket_bits);
+  size_t bucket_size = size_t(1) << bucket_bits;
+
+  buckets_.resize(bucket_size + 2);
+  uint32_t count = 0;
+  for (size_t b = 0; b < bucket_size; ++b) {
+    uint64_t bound = first + (uint64_t(b) << shift_);
+    while (count < n && keys_[count] < bound) ++count;
+    buckets_[b] = count;
+  }
+  buckets_[bucket_size] = n;
+  buckets_[bucket_size + 1] = n;
+}
+
+uint32_t PathIndex::SegmentAt(uint32_t t) const {
+  if (keys_.empty()) return reader_.SegmentAt(t);
+
+  uint32_t key = t - base_;
+  uint32_t first = keys_.front();
+  if (key < first) return PathReader::kNoSegment;
+  // Times past the last bucket land in the extra entry holding the count.
+  size_t b = std::min<size_t>((key - first) >> shift_, buckets_.size() - 2);
+  uint32_t begin = buckets_[b];
+  uint32_t end = buckets_[b + 1];
+  return begin + UpperBound(keys_.data() + begin, end - begin, key) - 1;
+}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <WickedWinchProtocol/Path.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace wickedwinch::protocol {
+
+// The headers PathWriter and PathBuilder write: the small format when the
+// path fits it, so existing paths serialize unchanged, and the large format
+// otherwise.
+class PathLayout {
+public:
+  // expr_size is the total size of the segments' expressions, each padded to
+  // 4 bytes.
+  PathLayout(size_t segment_size, size_t expr_size)
+      : segment_size_(segment_size), expr_size_(expr_size) {
+    large_ = segment_size > std::numeric_limits<uint16_t>::max() ||
+             small_headers_size() + expr_size > std::numeric_limits<uint16_t>::max();
+  }
+
+  bool large() const { return large_; }
+
+  size_t headers_size() const {
+    if (!large_) return small_headers_size();
+    return sizeof(PathHeader) + sizeof(PathLargeHeader) + segment_size_ * sizeof(PathLargeSegmentHeader);
+  }
+
+  size_t data_size() const { return headers_size() + expr_size_; }
+
+  // Whether the path fits even the large format.
+  bool valid() const { return data_size() <= std::numeric_limits<uint32_t>::max(); }
+
+  // Writes the path headers with no flags other than PathHeader::Large.
+  void WriteHeader(uint8_t* data) const {
+    auto* header = reinterpret_cast<PathHeader*>(data);
+    header->segment_size = large_ ? 0 : uint16_t(segment_size_);
+    header->flags = large_ ? PathHeader::Large : 0;
+    header->padding = 0;
+    if (large_) {
+      auto* large = reinterpret_cast<PathLargeHeader*>(data + sizeof(PathHeader));
+      *large = {.segment_size = uint32_t(segment_size_), .version = PathLargeHeader::kVersion, .padding = {}};
+    }
+  }
+
+  void WriteSegment(uint8_t* data, size_t i, uint32_t start_time, size_t offset, size_t size) const {
+    if (large_) {
+      auto* segments = reinterpret_cast<PathLargeSegmentHeader*>(data + sizeof(PathHeader) + sizeof(PathLargeHeader));
+      segments[i] = {.start_time = start_time, .offset = uint32_t(offset), .size = uint32_t(size)};
+    } else {
+      auto* segments = reinterpret_cast<PathSegmentHeader*>(data + sizeof(PathHeader));
+      segments[i] = {.start_time = start_time, .offset = uint16_t(offset), .size = uint16_t(size)};
+    }
+  }
+
+private:
+  size_t small_headers_size() const { return sizeof(PathHeader) + segment_size_ * sizeof(PathSegmentHeader); }
+
+  size_t segment_size_;
+  size_t expr_size_;
+  bool large_;
+};
+
+}
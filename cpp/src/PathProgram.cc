@@ -0,0 +1,125 @@
+#include <WickedWinchProtocol/PathProgram.h>
+
+#include <algorithm>
+
+namespace wickedwinch::protocol {
+namespace {
+
+// Evaluates n <= kBatchLanes samples of one segment at the given times and
+// writes the first width values of each to out, one frame after another.
+// Unused lanes repeat the last time.
+EvalStatus EvalLanes(
+    const PathProgram::Segment& segment, const uint32_t* times, size_t n,
+    size_t width, float* out, PostfixBatchStack& stack, PostfixPrecision precision) {
+  if (stack.stack_capacity < 1) return EvalStatus::StackOverflow;
+  stack.clear();
+  float* st = stack.slot(stack.stack_size++);
+  for (size_t l = 0; l < kBatchLanes; ++l) {
+    st[l] = float(times[std::min(l, n - 1)] - segment.start_time) * 1e-3f;
+  }
+  if (EvalStatus status = stack.Eval(segment.program, precision); status != EvalStatus::Ok) {
+    return status;
+  }
+
+  for (size_t l = 0; l < n; ++l) {
+    float* frame = out + l * width;
+    for (size_t k = 0; k < width; ++k) {
+      frame[k] = stack.slot(k)[l];
+    }
+  }
+  return EvalStatus::Ok;
+}
+
+}
+
+void PathProgram::Load(const PathReader& reader) {
+  reader_ = reader;
+  index_.Build(reader);
+  segments_.clear();
+  segments_.resize(reader.segment_header_size());
+  for (uint32_t i = 0; i < segments_.size(); ++i) {
+    Segment& segment = segments_[i];
+    segment.start_time = reader.start_time(i);
+    segment.expr.Read(reader.segment_data(i));
+    segment.status = segment.program.Verify(segment.expr, 1);
+    if (segment.status == EvalStatus::Ok) segment.program.Fuse();
+  }
+}
+
+EvalStatus PathProgram::Eval(uint32_t t, PostfixStack& stack, PostfixPrecision precision) const {
+  PathCursor cursor;
+  return Eval(t, cursor, stack, precision);
+}
+
+EvalStatus PathProgram::Eval(
+    uint32_t t, PathCursor& cursor, PostfixStack& stack, PostfixPrecision precision) const {
+  uint32_t i = SegmentAt(t, cursor);
+  if (i == PathReader::kNoSegment) return EvalStatus::UndefinedOperation;
+
+  const Segment& segment = segments_[i];
+  float st = float(t - segment.start_time) * 1e-3f;
+  stack.clear();
+  stack.push(st);
+  if (segment.status == EvalStatus::Ok && stack.stack_capacity >= segment.program.max_stack_size()) {
+    return stack.Eval(segment.program, precision);
+  }
+  return stack.Eval(segment.expr, precision);
+}
+
+EvalStatus PathProgram::EvalBatch(
+    std::span<const uint32_t> times, size_t width, std::span<float> out,
+    PostfixBatchStack& stack, PostfixPrecision precision) const {
+  if (out.size() < times.size() * width) return EvalStatus::IllegalOperation;
+
+  PathCursor cursor;
+  for (size_t i = 0; i < times.size();) {
+    uint32_t s = SegmentAt(times[i], cursor);
+    if (s == PathReader::kNoSegment) return EvalStatus::UndefinedOperation;
+
+    const Segment& segment = segments_[s];
+    if (segment.status != EvalStatus::Ok) return segment.status;
+    if (segment.program.output_size() < width) return EvalStatus::StackUnderflow;
+
+    size_t n = 1;
+    while (n < kBatchLanes && i + n < times.size() && SegmentAt(times[i + n], cursor) == s) ++n;
+
+    EvalStatus status = EvalLanes(segment, &times[i], n, width, &out[i * width], stack, precision);
+    if (status != EvalStatus::Ok) return status;
+    i += n;
+  }
+  return EvalStatus::Ok;
+}
+
+EvalStatus PathSampler::Fill(
+    std::span<float> out, PostfixBatchStack& stack, PostfixPrecision precision) {
+  if (width_ == 0) return EvalStatus::Ok;
+  const size_t frames = out.size() / width_;
+  const uint32_t base = path_.reader().base_time();
+
+  uint32_t times[kBatchLanes];
+  for (size_t i = 0; i < frames;) {
+    uint32_t s = path_.SegmentAt(time_, cursor_);
+    if (s == PathReader::kNoSegment) return EvalStatus::UndefinedOperation;
+
+    const PathProgram::Segment& segment = path_.segments()[s];
+    if (segment.status != EvalStatus::Ok) return segment.status;
+    if (segment.program.output_size() < width_) return EvalStatus::StackUnderflow;
+
+    // Frames left before the segment ends, rounded up.
+    uint64_t left = cursor_.end - uint32_t(time_ - base);
+    size_t run = frames - i;
+    if (period_ != 0) run = std::min<uint64_t>(run, (left + period_ - 1) / period_);
+
+    for (size_t end = i + run; i < end;) {
+      size_t n = std::min(end - i, kBatchLanes);
+      for (size_t l = 0; l < n; ++l) times[l] = time_ + uint32_t(l) * period_;
+      EvalStatus status = EvalLanes(segment, times, n, width_, &out[i * width_], stack, precision);
+      if (status != EvalStatus::Ok) return status;
+      time_ += uint32_t(n) * period_;
+      i += n;
+    }
+  }
+  return EvalStatus::Ok;
+}
+
+}
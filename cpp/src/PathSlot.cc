@@ -0,0 +1,46 @@
+#include <WickedWinchProtocol/PathSlot.h>
+
+#include <algorithm>
+
+namespace wickedwinch::protocol {
+
+PathSlot::PathSlot(size_t readers)
+    : readers_(std::make_unique<Reader[]>(readers)), reader_size_(readers) {}
+
+PathSlot::~PathSlot() = default;
+
+bool PathSlot::Publish(std::vector<uint8_t> buffer) {
+  auto path = std::make_unique<Path>();
+  path->buffer = std::move(buffer);
+  PathReader reader;
+  if (!reader.Read(path->buffer)) return false;
+  path->program.Load(reader);
+
+  std::lock_guard lock(writer_mutex_);
+  uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+  path->version = epoch;
+  current_.store(path.get(), std::memory_order_seq_cst);
+  // Readers that announce a later epoch load the new path.
+  epoch_.fetch_add(1, std::memory_order_seq_cst);
+  if (owned_) retired_.push_back({std::move(owned_), epoch});
+  owned_ = std::move(path);
+
+  std::erase_if(retired_, [this](const Retired& retired) { return !InUse(retired.epoch); });
+  return true;
+}
+
+size_t PathSlot::Reclaim() {
+  std::lock_guard lock(writer_mutex_);
+  std::erase_if(retired_, [this](const Retired& retired) { return !InUse(retired.epoch); });
+  return retired_.size();
+}
+
+bool PathSlot::InUse(uint64_t epoch) const {
+  for (size_t r = 0; r < reader_size_; ++r) {
+    uint64_t announced = readers_[r].epoch.load(std::memory_order_seq_cst);
+    if (announced != kIdle && announced <= epoch) return true;
+  }
+  return false;
+}
+
+}
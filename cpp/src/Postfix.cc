@@ -1,5 +1,9 @@
 #include <WickedWinchProtocol/Postfix.h>
 
+#include "FastMath.h"
+#include "Search.h"
+#include "VecKernels.h"
+
 #include <algorithm>
 #include <cmath>
 #include <cstring>
@@ -8,437 +12,525 @@
 #include <vector>
 
 namespace wickedwinch::protocol {
+
+#define CHECK_STATUS(expr) if (EvalStatus status = expr; status != EvalStatus::Ok) return status
+
+// With WICKEDWINCH_THREADED_DISPATCH every op handler ends in its own indirect
+// jump to the next handler (token threading through a label table), so the
+// branch predictor sees one site per op instead of the single shared jump of
+// a switch. Otherwise the handlers are plain switch cases.
+#if defined(WICKEDWINCH_THREADED_DISPATCH) && !(defined(__GNUC__) || defined(__clang__))
+#undef WICKEDWINCH_THREADED_DISPATCH
+#endif
+
+#ifdef WICKEDWINCH_THREADED_DISPATCH
+#define OP(name) case PostfixOp::name: op_##name:
+#define OP_DEFAULT default: op_Undefined
+#define DISPATCH()                                                             \
+  goto *(kChecked && uint8_t(cursor.op()) >= std::size(kDispatch)              \
+      ? &&op_Undefined                                                         \
+      : kDispatch[uint8_t(cursor.op())])
+#define NEXT_OP()                                                              \
+  { cursor.next(); if (cursor.done()) return EvalStatus::Ok; DISPATCH(); }
+#else
+#define OP(name) case PostfixOp::name:
+#define OP_DEFAULT default
+#define NEXT_OP() break
+#endif
+
 namespace {
 
-template <typename Pred>
-size_t search(size_t base, size_t n, const Pred& pred) {
-  while (n) {
-    size_t h = n >> 1;
-    if (pred(base + h)) {
-      n = h;
-    } else {
-      if (h == 0) break;
-      base += h;
-      n -= h;
-    }
-  }
-  return base + n;
-}
+// Walks the op, int and float streams of a serialized expression, checking
+// every read.
+struct StreamCursor {
+  static constexpr bool kChecked = true;
 
-// Return the smallest index i in [0, n) at which pred(i) is true.
-template <typename Pred>
-size_t search(size_t n, const Pred& pred) {
-  return search(0, n, pred);
-}
+  PostfixEvalContext& context;
+  uint8_t opi = 0;
 
-}
+  bool done() const { return opi >= context.op_size; }
+  void next() { ++opi; }
+  PostfixOp op() const { return context.op_head[opi]; }
 
-#define CHECK_STATUS(expr) if (EvalStatus status = expr; status != EvalStatus::Ok) return status
+  EvalStatus geti(uint8_t& n) { return context.geti(n); }
+  EvalStatus pushf(size_t n) { return context.pushf(n); }
+  EvalStatus implicitPushArg(uint8_t& arg, uint8_t multiple, uint8_t instances) {
+    return context.implicitPushArg(arg, multiple, instances);
+  }
+};
+
+// Walks instructions decoded by PostfixProgram, whose int operands are already
+// unpacked and whose literal pushes are resolved to a range of the float pool.
+struct InstrCursor {
+  static constexpr bool kChecked = false;
+
+  PostfixEvalContext& context;
+  const PostfixInstr* instr;
+  const PostfixInstr* end;
+  const float* f_data;
+  uint8_t argi = 0;
+
+  bool done() const { return instr == end; }
+  void next() {
+    ++instr;
+    argi = 0;
+  }
+  PostfixOp op() const { return instr->op; }
 
-EvalStatus PostfixEvalContext::push(float v) {
-  if (stack_size + 1 > stack_capacity) return EvalStatus::StackOverflow;
-  stack_data[stack_size++] = v;
-  return EvalStatus::Ok;
+  EvalStatus geti(uint8_t& n) {
+    n = instr->arg[argi++];
+    return EvalStatus::Ok;
+  }
+  EvalStatus pushf(size_t) {
+    return context.pushv<false>(std::span<const float>(f_data + instr->f_offset, instr->f_size));
+  }
+  EvalStatus implicitPushArg(uint8_t&, uint8_t, uint8_t) {
+    return pushf(instr->f_size);
+  }
+
+  const float* literals() const { return f_data + instr->f_offset; }
+};
+
+// Fully unrolled products for the shapes used by rotations, colour matrices
+// and their vectors. Sums run in the same order as the general loop.
+template <size_t A, size_t B, size_t C>
+void MulMatFixed(const float* a, const float* b, float* c) {
+  for (size_t i = 0; i < A; ++i) {
+    for (size_t j = 0; j < C; ++j) {
+      float r = 0;
+      for (size_t k = 0; k < B; ++k) r += a[B * i + k] * b[C * k + j];
+      c[C * i + j] = r;
+    }
+  }
 }
 
-EvalStatus PostfixEvalContext::pushv(std::span<const float> v) {
-  if (stack_size + v.size() > stack_capacity) return EvalStatus::StackOverflow;
-  memcpy(&stack_data[stack_size], v.data(), v.size() * sizeof(float));
-  stack_size += v.size();
-  return EvalStatus::Ok;
+bool MulMatSpecialized(uint8_t arows, uint8_t brows, uint8_t bcols, const float* a, const float* b, float* c) {
+  if (arows != brows) return false;
+  // Both dimensions are 8 bits, so the key is exact.
+  switch (unsigned(brows) << 8 | bcols) {
+  case 0x0202: MulMatFixed<2, 2, 2>(a, b, c); return true;
+  case 0x0303: MulMatFixed<3, 3, 3>(a, b, c); return true;
+  case 0x0404: MulMatFixed<4, 4, 4>(a, b, c); return true;
+  case 0x0301: MulMatFixed<3, 3, 1>(a, b, c); return true;
+  case 0x0401: MulMatFixed<4, 4, 1>(a, b, c); return true;
+  default: return false;
+  }
 }
 
-EvalStatus PostfixEvalContext::pushf(size_t n) {
-  if (n > f_size) return EvalStatus::FloatLiteralsUnderflow;
-  CHECK_STATUS(pushv(std::span<const float>(f_head, n)));
-  f_size -= n;
-  f_head += n;
-  return EvalStatus::Ok;
+// a * b + c, fused where the target has a fast fused multiply-add.
+inline float MulAdd(float a, float b, float c) {
+#ifdef FP_FAST_FMAF
+  return std::fma(a, b, c);
+#else
+  return a * b + c;
+#endif
 }
 
-EvalStatus PostfixEvalContext::implicitPushArg(uint8_t& arg, uint8_t multiple, uint8_t instances) {
-  uint8_t mask = uint8_t(1 << instances) - 1;
-  uint8_t push_count = arg & mask;
-  arg >>= instances;
-  if (push_count == 0) return EvalStatus::Ok;
-  uint16_t size = uint16_t(push_count * multiple * arg);
-  return pushf(size);
+template <size_t N>
+void PolyMatFixed(const float* coeff, uint8_t rows, float t, float* result) {
+  float r[N];
+  for (size_t j = 0; j < N; ++j) r[j] = coeff[(rows - 1) * N + j];
+  for (size_t i = rows - 1; i-- > 0;) {
+    for (size_t j = 0; j < N; ++j) r[j] = MulAdd(r[j], t, coeff[i * N + j]);
+  }
+  for (size_t j = 0; j < N; ++j) result[j] = r[j];
 }
 
-EvalStatus PostfixEvalContext::allocv(size_t n, std::span<float>& v) {
-  if (stack_size + n > stack_capacity) return EvalStatus::StackOverflow;
-  v = std::span<float>(&stack_data[stack_size], n);
-  stack_size += n;
-  return EvalStatus::Ok;
+// result may overlap coeff from one float below it; all of coeff is read
+// before result is written.
+bool PolyMatSpecialized(const float* coeff, uint8_t rows, uint8_t cols, float t, float* result) {
+  switch (cols) {
+  case 0: return true;
+  case 1: PolyMatFixed<1>(coeff, rows, t, result); return true;
+  case 2: PolyMatFixed<2>(coeff, rows, t, result); return true;
+  case 3: PolyMatFixed<3>(coeff, rows, t, result); return true;
+  case 4: PolyMatFixed<4>(coeff, rows, t, result); return true;
+  case 5: PolyMatFixed<5>(coeff, rows, t, result); return true;
+  case 6: PolyMatFixed<6>(coeff, rows, t, result); return true;
+  case 7: PolyMatFixed<7>(coeff, rows, t, result); return true;
+  case 8: PolyMatFixed<8>(coeff, rows, t, result); return true;
+  default: return false;
+  }
 }
 
-EvalStatus PostfixEvalContext::pop(float& v) {
-  if (stack_size < 1) return EvalStatus::StackUnderflow;
-  v = stack_data[--stack_size];
-  return EvalStatus::Ok;
+template <size_t N>
+void TransposeSquare(float* m) {
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = i + 1; j < N; ++j) std::swap(m[N * i + j], m[N * j + i]);
+  }
 }
 
-EvalStatus PostfixEvalContext::popv(size_t n, std::span<float>& v) {
-  if (stack_size < n) return EvalStatus::StackUnderflow;
-  stack_size -= n;
-  v = std::span<float>(&stack_data[stack_size], n);
-  return EvalStatus::Ok;
+// Transposes in place where no scratch is needed: a row or column vector has
+// the same layout as its transpose.
+bool TransposeSpecialized(uint8_t rows, uint8_t cols, float* m) {
+  if (rows == 1 || cols == 1) return true;
+  if (rows != cols) return false;
+  switch (rows) {
+  case 2: TransposeSquare<2>(m); return true;
+  case 3: TransposeSquare<3>(m); return true;
+  case 4: TransposeSquare<4>(m); return true;
+  default: return false;
+  }
 }
 
-EvalStatus PostfixEvalContext::peek(float& v) {
-  if (stack_size < 1) return EvalStatus::StackUnderflow;
-  v = stack_data[stack_size-1];
-  return EvalStatus::Ok;
 }
 
-EvalStatus PostfixEvalContext::peekv(size_t n, std::span<float>& v) {
-  if (stack_size < n) return EvalStatus::StackUnderflow;
-  v = std::span<float>(&stack_data[stack_size - n], n);
-  return EvalStatus::Ok;
+EvalStatus PostfixEvalContext::Eval() {
+  StreamCursor cursor{.context = *this};
+  return Run(cursor);
 }
 
-EvalStatus PostfixEvalContext::geti(uint8_t& n) {
-  if (i_size < 1) return EvalStatus::IntLiteralsUnderflow;
-  n = i_head[0];
-  --i_size;
-  ++i_head;
-  return EvalStatus::Ok;
+EvalStatus PostfixEvalContext::EvalUnchecked(std::span<const PostfixInstr> instrs, const float* f_data) {
+  InstrCursor cursor{
+    .context = *this,
+    .instr   = instrs.data(),
+    .end     = instrs.data() + instrs.size(),
+    .f_data  = f_data,
+  };
+  return Run(cursor);
 }
 
-EvalStatus PostfixEvalContext::Eval() {
-  for (uint8_t opi = 0; opi < op_size; ++opi) {
-    const PostfixOp op = op_head[opi];
-    switch (op) {
-    case PostfixOp::Push: {
+template <typename Cursor>
+EvalStatus PostfixEvalContext::Run(Cursor& cursor) {
+  constexpr bool kChecked = Cursor::kChecked;
+  const bool fast = precision == PostfixPrecision::Fast;
+#ifdef WICKEDWINCH_THREADED_DISPATCH
+  static const void* const kDispatch[] = {
+    &&op_Undefined, &&op_Push, &&op_Pop, &&op_Dup, &&op_RotL, &&op_RotR,
+    &&op_Rev, &&op_Transpose, &&op_Add, &&op_Sub, &&op_Mul, &&op_MulAdd,
+    &&op_Div, &&op_Mod, &&op_Neg, &&op_Abs, &&op_Inv, &&op_Pow, &&op_Sqrt,
+    &&op_Exp, &&op_Ln, &&op_Sin, &&op_Cos, &&op_Tan, &&op_Asin, &&op_Acos,
+    &&op_Atan2, &&op_AddVec, &&op_SubVec, &&op_MulVec, &&op_MulAddVec,
+    &&op_ScaleVec, &&op_NegVec, &&op_NormVec, &&op_MulMat, &&op_PolyVec,
+    &&op_PolyMat, &&op_Lerp, &&op_Lut, &&op_AddConst, &&op_SubConst,
+    &&op_MulConst, &&op_DivConst, &&op_Square, &&op_Axpy,
+  };
+  static_assert(std::size(kDispatch) == size_t(PostfixOp::Axpy) + 1);
+  if (cursor.done()) return EvalStatus::Ok;
+  DISPATCH();
+#endif
+  for (; !cursor.done(); cursor.next()) {
+    switch (cursor.op()) {
+    OP(Push) {
       uint8_t n;
-      CHECK_STATUS(geti(n));
-      CHECK_STATUS(pushf(n));
-      break;
+      CHECK_STATUS(cursor.geti(n));
+      CHECK_STATUS(cursor.pushf(n));
+      NEXT_OP();
     }
-    case PostfixOp::Pop: {
+    OP(Pop) {
       uint8_t n;
-      CHECK_STATUS(geti(n));
+      CHECK_STATUS(cursor.geti(n));
       std::span<float> discard;
-      CHECK_STATUS(popv(n, discard));
-      break;
+      CHECK_STATUS(popv<kChecked>(n, discard));
+      NEXT_OP();
     }
-    case PostfixOp::Dup: {
+    OP(Dup) {
       uint8_t n;
-      CHECK_STATUS(geti(n));
-      if (stack_size - 1 < n) return EvalStatus::StackUnderflow;
+      CHECK_STATUS(cursor.geti(n));
+      if (kChecked && stack_size < size_t(n) + 1) return EvalStatus::StackUnderflow;
       float v = stack_data[stack_size - 1 - n];
-      CHECK_STATUS(push(v));
-      break;
+      CHECK_STATUS(push<kChecked>(v));
+      NEXT_OP();
     }
-    case PostfixOp::RotL: {
+    OP(RotL) {
       uint8_t n;
-      CHECK_STATUS(geti(n));
-      if (n <= 1) break;
+      CHECK_STATUS(cursor.geti(n));
+      if (n <= 1) { NEXT_OP(); }
       std::span<float> values;
-      CHECK_STATUS(peekv(n, values));
+      CHECK_STATUS(peekv<kChecked>(n, values));
       float l = values[0];
       std::copy(values.begin() + 1, values.end(), values.begin());
       values.back() = l;
-      break;
+      NEXT_OP();
     }
-    case PostfixOp::RotR: {
+    OP(RotR) {
       uint8_t n;
-      CHECK_STATUS(geti(n));
-      if (n <= 1) break;
+      CHECK_STATUS(cursor.geti(n));
+      if (n <= 1) { NEXT_OP(); }
       std::span<float> values;
-      CHECK_STATUS(peekv(n, values));
+      CHECK_STATUS(peekv<kChecked>(n, values));
       float r = values.back();
       std::copy(values.begin(), values.end() - 1, values.begin() + 1);
       values[0] = r;
-      break;
+      NEXT_OP();
     }
-    case PostfixOp::Rev: {
+    OP(Rev) {
       uint8_t n;
-      CHECK_STATUS(geti(n));
+      CHECK_STATUS(cursor.geti(n));
       std::span<float> values;
-      CHECK_STATUS(peekv(n, values));
+      CHECK_STATUS(peekv<kChecked>(n, values));
       std::reverse(values.begin(), values.end());
-      break;
+      NEXT_OP();
     }
-    case PostfixOp::Transpose: {
+    OP(Transpose) {
       uint8_t rows, cols;
-      CHECK_STATUS(geti(rows));
-      CHECK_STATUS(geti(cols));
-      CHECK_STATUS(implicitPushArg(cols, rows, 1));
+      CHECK_STATUS(cursor.geti(rows));
+      CHECK_STATUS(cursor.geti(cols));
+      CHECK_STATUS(cursor.implicitPushArg(cols, rows, 1));
 
       std::span<float> m;
-      CHECK_STATUS(popv(rows * cols, m));
-      temp.resize(m.size());
+      CHECK_STATUS(peekv<kChecked>(rows * cols, m));
+      if (TransposeSpecialized(rows, cols, m.data())) { NEXT_OP(); }
+      stack_size -= m.size();
+      std::span<float> t = scratch<kChecked>(m.size(), m.size());
       for (uint8_t i = 0; i < rows; ++i) {
         for (uint8_t j = 0; j < cols; ++j) {
           size_t midx = cols * i + j;
           size_t tidx = rows * j + i;
-          temp[tidx] = m[midx];
+          t[tidx] = m[midx];
         }
       }
-      CHECK_STATUS(pushv(temp));
-      break;
+      CHECK_STATUS(pushv<kChecked>(t));
+      NEXT_OP();
     }
-    case PostfixOp::Add: {
+    OP(Add) {
       std::span<float> v;
-      CHECK_STATUS(popv(2, v));
-      CHECK_STATUS(push(v[0] + v[1]));
-      break;
+      CHECK_STATUS(popv<kChecked>(2, v));
+      CHECK_STATUS(push<kChecked>(v[0] + v[1]));
+      NEXT_OP();
     }
-    case PostfixOp::Sub: {
+    OP(Sub) {
       std::span<float> v;
-      CHECK_STATUS(popv(2, v));
-      CHECK_STATUS(push(v[0] - v[1]));
-      break;
+      CHECK_STATUS(popv<kChecked>(2, v));
+      CHECK_STATUS(push<kChecked>(v[0] - v[1]));
+      NEXT_OP();
     }
-    case PostfixOp::Mul: {
+    OP(Mul) {
       std::span<float> v;
-      CHECK_STATUS(popv(2, v));
-      CHECK_STATUS(push(v[0] * v[1]));
-      break;
+      CHECK_STATUS(popv<kChecked>(2, v));
+      CHECK_STATUS(push<kChecked>(v[0] * v[1]));
+      NEXT_OP();
     }
-    case PostfixOp::MulAdd: {
+    OP(MulAdd) {
       std::span<float> v;
-      CHECK_STATUS(popv(3, v));
-      CHECK_STATUS(push(v[0] * v[1] + v[2]));
-      break;
+      CHECK_STATUS(popv<kChecked>(3, v));
+      CHECK_STATUS(push<kChecked>(v[0] * v[1] + v[2]));
+      NEXT_OP();
     }
-    case PostfixOp::Div: {
+    OP(Div) {
       std::span<float> v;
-      CHECK_STATUS(popv(2, v));
-      CHECK_STATUS(push(v[0] / v[1]));
-      break;
+      CHECK_STATUS(popv<kChecked>(2, v));
+      CHECK_STATUS(push<kChecked>(v[0] / v[1]));
+      NEXT_OP();
     }
-    case PostfixOp::Mod: {
+    OP(Mod) {
       std::span<float> v;
-      CHECK_STATUS(popv(2, v));
-      CHECK_STATUS(push(std::fmod(v[0], v[1])));
-      break;
+      CHECK_STATUS(popv<kChecked>(2, v));
+      CHECK_STATUS(push<kChecked>(std::fmod(v[0], v[1])));
+      NEXT_OP();
     }
-    case PostfixOp::Neg: {
+    OP(Neg) {
       float v;
-      CHECK_STATUS(pop(v));
-      CHECK_STATUS(push(-v));
-      break;
+      CHECK_STATUS(pop<kChecked>(v));
+      CHECK_STATUS(push<kChecked>(-v));
+      NEXT_OP();
     }
-    case PostfixOp::Abs: {
+    OP(Abs) {
       float v;
-      CHECK_STATUS(pop(v));
-      CHECK_STATUS(push(std::abs(v)));
-      break;
+      CHECK_STATUS(pop<kChecked>(v));
+      CHECK_STATUS(push<kChecked>(std::abs(v)));
+      NEXT_OP();
     }
-    case PostfixOp::Inv: {
+    OP(Inv) {
       float v;
-      CHECK_STATUS(pop(v));
-      CHECK_STATUS(push(1.0f / v));
-      break;
+      CHECK_STATUS(pop<kChecked>(v));
+      CHECK_STATUS(push<kChecked>(1.0f / v));
+      NEXT_OP();
     }
-    case PostfixOp::Pow: {
+    OP(Pow) {
       std::span<float> v;
-      CHECK_STATUS(popv(2, v));
-      CHECK_STATUS(push(std::pow(v[0], v[1])));
-      break;
+      CHECK_STATUS(popv<kChecked>(2, v));
+      CHECK_STATUS(push<kChecked>(fast ? FastEval<FastPow>(v[0], v[1]) : std::pow(v[0], v[1])));
+      NEXT_OP();
     }
-    case PostfixOp::Sqrt: {
+    OP(Sqrt) {
       float v;
-      CHECK_STATUS(pop(v));
-      CHECK_STATUS(push(std::sqrt(v)));
-      break;
+      CHECK_STATUS(pop<kChecked>(v));
+      CHECK_STATUS(push<kChecked>(std::sqrt(v)));
+      NEXT_OP();
     }
-    case PostfixOp::Exp: {
+    OP(Exp) {
       float v;
-      CHECK_STATUS(pop(v));
-      CHECK_STATUS(push(std::exp(v)));
-      break;
+      CHECK_STATUS(pop<kChecked>(v));
+      CHECK_STATUS(push<kChecked>(fast ? FastEval<FastExp>(v) : std::exp(v)));
+      NEXT_OP();
     }
-    case PostfixOp::Ln: {
+    OP(Ln) {
       float v;
-      CHECK_STATUS(pop(v));
-      CHECK_STATUS(push(std::log(v)));
-      break;
+      CHECK_STATUS(pop<kChecked>(v));
+      CHECK_STATUS(push<kChecked>(fast ? FastEval<FastLn>(v) : std::log(v)));
+      NEXT_OP();
     }
-    case PostfixOp::Sin: {
+    OP(Sin) {
       float v;
-      CHECK_STATUS(pop(v));
-      CHECK_STATUS(push(std::sin(v)));
-      break;
+      CHECK_STATUS(pop<kChecked>(v));
+      CHECK_STATUS(push<kChecked>(fast ? FastEval<FastSin>(v) : std::sin(v)));
+      NEXT_OP();
     }
-    case PostfixOp::Cos: {
+    OP(Cos) {
       float v;
-      CHECK_STATUS(pop(v));
-      CHECK_STATUS(push(std::cos(v)));
-      break;
+      CHECK_STATUS(pop<kChecked>(v));
+      CHECK_STATUS(push<kChecked>(fast ? FastEval<FastCos>(v) : std::cos(v)));
+      NEXT_OP();
     }
-    case PostfixOp::Tan: {
+    OP(Tan) {
       float v;
-      CHECK_STATUS(pop(v));
-      CHECK_STATUS(push(std::tan(v)));
-      break;
+      CHECK_STATUS(pop<kChecked>(v));
+      CHECK_STATUS(push<kChecked>(fast ? FastEval<FastTan>(v) : std::tan(v)));
+      NEXT_OP();
     }
-    case PostfixOp::Asin: {
+    OP(Asin) {
       float v;
-      CHECK_STATUS(pop(v));
-      CHECK_STATUS(push(std::asin(v)));
-      break;
+      CHECK_STATUS(pop<kChecked>(v));
+      CHECK_STATUS(push<kChecked>(fast ? FastEval<FastAsin>(v) : std::asin(v)));
+      NEXT_OP();
     }
-    case PostfixOp::Acos: {
+    OP(Acos) {
       float v;
-      CHECK_STATUS(pop(v));
-      CHECK_STATUS(push(std::acos(v)));
-      break;
+      CHECK_STATUS(pop<kChecked>(v));
+      CHECK_STATUS(push<kChecked>(fast ? FastEval<FastAcos>(v) : std::acos(v)));
+      NEXT_OP();
     }
-    case PostfixOp::Atan2: {
+    OP(Atan2) {
       std::span<float> v;
-      CHECK_STATUS(popv(2, v));
-      CHECK_STATUS(push(std::atan2(v[0], v[1])));
-      break;
-    }
-    case PostfixOp::PolyVec: {
+      CHECK_STATUS(popv<kChecked>(2, v));
+      CHECK_STATUS(push<kChecked>(fast ? FastEval<FastAtan2>(v[0], v[1]) : std::atan2(v[0], v[1])));
+      NEXT_OP();
+    }
+    // PolyVec and PolyMat use Horner's rule, one multiply-add per term. For
+    // a polynomial of n coefficients the result is within 2(n-1) ulp of
+    // sum |c_i t^i|, or (n-1) ulp when the kernels fuse multiply-adds; with
+    // no cancellation between terms that bounds the relative error too.
+    OP(PolyVec) {
       uint8_t size;
-      CHECK_STATUS(geti(size));
-      CHECK_STATUS(implicitPushArg(size, 1, 1));
+      CHECK_STATUS(cursor.geti(size));
+      CHECK_STATUS(cursor.implicitPushArg(size, 1, 1));
 
-      float result = 0;
-      float p = 1;
       float t;
       std::span<float> coeff;
-      CHECK_STATUS(popv(size, coeff));
-      CHECK_STATUS(pop(t));
-      for (uint8_t n = 0; n < size; ++n) {
-        result += coeff[n] * p;
-        p *= t;
-      }
-      CHECK_STATUS(push(result));
-      break;
+      CHECK_STATUS(popv<kChecked>(size, coeff));
+      CHECK_STATUS(pop<kChecked>(t));
+      CHECK_STATUS(push<kChecked>(vec_kernels().poly(coeff.data(), size, t)));
+      NEXT_OP();
     }
-    case PostfixOp::PolyMat: {
+    OP(PolyMat) {
       uint8_t rows, cols;
-      CHECK_STATUS(geti(rows));
-      CHECK_STATUS(geti(cols));
-      CHECK_STATUS(implicitPushArg(cols, rows, 1));
-
+      CHECK_STATUS(cursor.geti(rows));
+      CHECK_STATUS(cursor.geti(cols));
+      CHECK_STATUS(cursor.implicitPushArg(cols, rows, 1));
+
+      // Walks the rows upwards once, stepping every column together. Up to
+      // eight columns stay in registers; wider polynomials accumulate in the
+      // last coefficient row. result overlaps t and the first row, which are
+      // read before it is written.
       float t;
       std::span<float> coeff, result;
-      CHECK_STATUS(popv(rows * cols, coeff));
-      CHECK_STATUS(pop(t));
-      CHECK_STATUS(allocv(cols, result));
-      for (uint8_t j = 0; j < cols; ++j) {
-        float r = 0;
-        float p = 1;
-        for (uint8_t i = 0; i < rows; ++i) {
-          size_t cidx = cols * i + j;
-          r += coeff[cidx] * p;
-          p *= t;
-        }
-        result[j] = r;
+      CHECK_STATUS(popv<kChecked>(rows * cols, coeff));
+      CHECK_STATUS(pop<kChecked>(t));
+      CHECK_STATUS(allocv<kChecked>(cols, result));
+      if (rows == 0) {
+        std::fill(result.begin(), result.end(), 0.0f);
+      } else if (!PolyMatSpecialized(coeff.data(), rows, cols, t, result.data())) {
+        float* acc = coeff.data() + (rows - 1) * cols;
+        vec_kernels().horner(acc, t, coeff.data(), rows - 1, cols);
+        std::copy(acc, acc + cols, result.begin());
       }
-      break;
+      NEXT_OP();
     }
-    case PostfixOp::AddVec: {
+    OP(AddVec) {
       uint8_t size;
-      CHECK_STATUS(geti(size));
-      CHECK_STATUS(implicitPushArg(size, 1, 1));
+      CHECK_STATUS(cursor.geti(size));
+      CHECK_STATUS(cursor.implicitPushArg(size, 1, 1));
 
       std::span<float> lhs, rhs;
-      CHECK_STATUS(popv(size, rhs));
-      CHECK_STATUS(peekv(size, lhs));
-      for (uint8_t i = 0; i < size; ++i) {
-        lhs[i] += rhs[i];
-      }
-      break;
+      CHECK_STATUS(popv<kChecked>(size, rhs));
+      CHECK_STATUS(peekv<kChecked>(size, lhs));
+      vec_kernels().add(lhs.data(), rhs.data(), size);
+      NEXT_OP();
     }
-    case PostfixOp::SubVec: {
+    OP(SubVec) {
       uint8_t size;
-      CHECK_STATUS(geti(size));
-      CHECK_STATUS(implicitPushArg(size, 1, 1));
+      CHECK_STATUS(cursor.geti(size));
+      CHECK_STATUS(cursor.implicitPushArg(size, 1, 1));
 
       std::span<float> lhs, rhs;
-      CHECK_STATUS(popv(size, rhs));
-      CHECK_STATUS(peekv(size, lhs));
-      for (uint8_t i = 0; i < size; ++i) {
-        lhs[i] -= rhs[i];
-      }
-      break;
+      CHECK_STATUS(popv<kChecked>(size, rhs));
+      CHECK_STATUS(peekv<kChecked>(size, lhs));
+      vec_kernels().sub(lhs.data(), rhs.data(), size);
+      NEXT_OP();
     }
-    case PostfixOp::MulVec: {
+    OP(MulVec) {
       uint8_t size;
-      CHECK_STATUS(geti(size));
-      CHECK_STATUS(implicitPushArg(size, 1, 1));
+      CHECK_STATUS(cursor.geti(size));
+      CHECK_STATUS(cursor.implicitPushArg(size, 1, 1));
 
       std::span<float> lhs, rhs;
-      CHECK_STATUS(popv(size, rhs));
-      CHECK_STATUS(peekv(size, lhs));
-      for (uint8_t i = 0; i < size; ++i) {
-        lhs[i] *= rhs[i];
-      }
-      break;
+      CHECK_STATUS(popv<kChecked>(size, rhs));
+      CHECK_STATUS(peekv<kChecked>(size, lhs));
+      vec_kernels().mul(lhs.data(), rhs.data(), size);
+      NEXT_OP();
     }
-    case PostfixOp::MulAddVec: {
+    OP(MulAddVec) {
       uint8_t size;
-      CHECK_STATUS(geti(size));
-      CHECK_STATUS(implicitPushArg(size, 1, 2));
+      CHECK_STATUS(cursor.geti(size));
+      CHECK_STATUS(cursor.implicitPushArg(size, 1, 2));
 
       std::span<float> a, b, c;
-      CHECK_STATUS(popv(size, c));
-      CHECK_STATUS(popv(size, b));
-      CHECK_STATUS(peekv(size, a));
-      for (uint8_t i = 0; i < size; ++i) {
-        a[i] = a[i] * b[i] + c[i];
-      }
-      break;
+      CHECK_STATUS(popv<kChecked>(size, c));
+      CHECK_STATUS(popv<kChecked>(size, b));
+      CHECK_STATUS(peekv<kChecked>(size, a));
+      vec_kernels().mul_add(a.data(), b.data(), c.data(), size);
+      NEXT_OP();
     }
-    case PostfixOp::ScaleVec: {
+    OP(ScaleVec) {
       uint8_t size;
-      CHECK_STATUS(geti(size));
-      CHECK_STATUS(implicitPushArg(size, 1, 1));
+      CHECK_STATUS(cursor.geti(size));
+      CHECK_STATUS(cursor.implicitPushArg(size, 1, 1));
 
       float scalar;
       std::span<float> v, result;
-      CHECK_STATUS(popv(size, v));
-      CHECK_STATUS(pop(scalar));
-      CHECK_STATUS(allocv(size, result));
-      for (uint8_t i = 0; i < size; ++i) {
-        result[i] = scalar * v[i];
-      }
-      break;
+      CHECK_STATUS(popv<kChecked>(size, v));
+      CHECK_STATUS(pop<kChecked>(scalar));
+      CHECK_STATUS(allocv<kChecked>(size, result));
+      vec_kernels().scale(result.data(), scalar, v.data(), size);
+      NEXT_OP();
     }
-    case PostfixOp::NegVec: {
+    OP(NegVec) {
       uint8_t size;
-      CHECK_STATUS(geti(size));
-      CHECK_STATUS(implicitPushArg(size, 1, 1));
+      CHECK_STATUS(cursor.geti(size));
+      CHECK_STATUS(cursor.implicitPushArg(size, 1, 1));
 
       std::span<float> v;
-      CHECK_STATUS(peekv(size, v));
-      for (uint8_t i = 0; i < size; ++i) {
-        v[i] = -v[i];
-      }
-      break;
+      CHECK_STATUS(peekv<kChecked>(size, v));
+      vec_kernels().neg(v.data(), size);
+      NEXT_OP();
     }
-    case PostfixOp::NormVec: {
+    OP(NormVec) {
       uint8_t size;
-      CHECK_STATUS(geti(size));
-      CHECK_STATUS(implicitPushArg(size, 1, 1));
+      CHECK_STATUS(cursor.geti(size));
+      CHECK_STATUS(cursor.implicitPushArg(size, 1, 1));
 
       std::span<float> v;
-      CHECK_STATUS(popv(size, v));
-      float result = 0;
-      for (uint8_t i = 0; i < size; ++i) {
-        result += v[i] * v[i];
-      }
-      CHECK_STATUS(push(std::sqrt(result)));
-      break;
+      CHECK_STATUS(popv<kChecked>(size, v));
+      float result = vec_kernels().norm2(v.data(), size);
+      CHECK_STATUS(push<kChecked>(std::sqrt(result)));
+      NEXT_OP();
     }
-    case PostfixOp::MulMat: {
+    OP(MulMat) {
       uint8_t arows, brows, bcols;
-      CHECK_STATUS(geti(arows));
-      CHECK_STATUS(geti(brows));
-      CHECK_STATUS(geti(bcols));
-      CHECK_STATUS(implicitPushArg(bcols, brows, 1));
+      CHECK_STATUS(cursor.geti(arows));
+      CHECK_STATUS(cursor.geti(brows));
+      CHECK_STATUS(cursor.geti(bcols));
+      CHECK_STATUS(cursor.implicitPushArg(bcols, brows, 1));
 
       std::span<float> a, b;
-      CHECK_STATUS(popv(brows * bcols, b));
-      CHECK_STATUS(popv(arows * brows, a));
-      temp.resize(arows * bcols);
+      CHECK_STATUS(popv<kChecked>(brows * bcols, b));
+      CHECK_STATUS(popv<kChecked>(arows * brows, a));
+      std::span<float> c = scratch<kChecked>(a.size() + b.size(), arows * bcols);
+      if (MulMatSpecialized(arows, brows, bcols, a.data(), b.data(), c.data())) {
+        CHECK_STATUS(pushv<kChecked>(c));
+        NEXT_OP();
+      }
       for (uint8_t i = 0; i < arows; ++i) {
         for (uint8_t j = 0; j < bcols; ++j) {
           float r = 0;
@@ -448,43 +540,41 @@ EvalStatus PostfixEvalContext::Eval() {
             r += a[aidx] * b[bidx];
           }
           size_t cidx = bcols * i + j;
-          temp[cidx] = r;
+          c[cidx] = r;
         }
       }
-      CHECK_STATUS(pushv(temp));
-      break;
+      CHECK_STATUS(pushv<kChecked>(c));
+      NEXT_OP();
     }
-    case PostfixOp::Lerp: {
+    OP(Lerp) {
       uint8_t size;
-      CHECK_STATUS(geti(size));
-      CHECK_STATUS(implicitPushArg(size, 1, 2));
+      CHECK_STATUS(cursor.geti(size));
+      CHECK_STATUS(cursor.implicitPushArg(size, 1, 2));
 
       float t;
       std::span<float> v0, v1, result;
-      CHECK_STATUS(popv(size, v1));
-      CHECK_STATUS(popv(size, v0));
-      CHECK_STATUS(pop(t));
-      CHECK_STATUS(allocv(size, result));
-      for (uint8_t i = 0; i < size; ++i) {
-        result[i] = (1-t)*v0[i] + t*v1[i];
-      }
-      break;
-    }
-    case PostfixOp::Lut: {
+      CHECK_STATUS(popv<kChecked>(size, v1));
+      CHECK_STATUS(popv<kChecked>(size, v0));
+      CHECK_STATUS(pop<kChecked>(t));
+      CHECK_STATUS(allocv<kChecked>(size, result));
+      vec_kernels().lerp(result.data(), t, v0.data(), v1.data(), size);
+      NEXT_OP();
+    }
+    OP(Lut) {
       uint8_t rows, cols;
-      CHECK_STATUS(geti(rows));
-      CHECK_STATUS(geti(cols));
-      CHECK_STATUS(implicitPushArg(cols, rows, 1));
-      if (rows < 1) return EvalStatus::IllegalOperation;
-      if (cols < 1) return EvalStatus::IllegalOperation;
+      CHECK_STATUS(cursor.geti(rows));
+      CHECK_STATUS(cursor.geti(cols));
+      CHECK_STATUS(cursor.implicitPushArg(cols, rows, 1));
+      if (kChecked && rows < 1) return EvalStatus::IllegalOperation;
+      if (kChecked && cols < 1) return EvalStatus::IllegalOperation;
 
       float t;
       std::span<float> lut, result;
       size_t size = rows * cols;
       uint8_t n = cols - 1;
-      CHECK_STATUS(popv(size, lut));
-      CHECK_STATUS(pop(t));
-      CHECK_STATUS(allocv(n, result));
+      CHECK_STATUS(popv<kChecked>(size, lut));
+      CHECK_STATUS(pop<kChecked>(t));
+      CHECK_STATUS(allocv<kChecked>(n, result));
       size_t ubrow = search(rows, [t, cols, lut](size_t i) -> bool {
         return t < lut[cols*i];
       });
@@ -506,9 +596,78 @@ EvalStatus PostfixEvalContext::Eval() {
           result[i] = (1-t)*v0[i] + t*v1[i];
         }
       }
-      break;
+      NEXT_OP();
+    }
+    // Superinstructions only occur in programs rewritten by
+    // PostfixProgram::Fuse, never in serialized expressions.
+    OP(AddConst) {
+      if constexpr (kChecked) {
+        return EvalStatus::UndefinedOperation;
+      } else {
+        std::span<float> v;
+        CHECK_STATUS(peekv<kChecked>(1, v));
+        v[0] += cursor.literals()[0];
+        NEXT_OP();
+      }
+    }
+    OP(SubConst) {
+      if constexpr (kChecked) {
+        return EvalStatus::UndefinedOperation;
+      } else {
+        std::span<float> v;
+        CHECK_STATUS(peekv<kChecked>(1, v));
+        v[0] -= cursor.literals()[0];
+        NEXT_OP();
+      }
+    }
+    OP(MulConst) {
+      if constexpr (kChecked) {
+        return EvalStatus::UndefinedOperation;
+      } else {
+        std::span<float> v;
+        CHECK_STATUS(peekv<kChecked>(1, v));
+        v[0] *= cursor.literals()[0];
+        NEXT_OP();
+      }
+    }
+    OP(DivConst) {
+      if constexpr (kChecked) {
+        return EvalStatus::UndefinedOperation;
+      } else {
+        std::span<float> v;
+        CHECK_STATUS(peekv<kChecked>(1, v));
+        v[0] /= cursor.literals()[0];
+        NEXT_OP();
+      }
+    }
+    OP(Square) {
+      if constexpr (kChecked) {
+        return EvalStatus::UndefinedOperation;
+      } else {
+        std::span<float> v;
+        CHECK_STATUS(peekv<kChecked>(1, v));
+        v[0] *= v[0];
+        NEXT_OP();
+      }
+    }
+    OP(Axpy) {
+      if constexpr (kChecked) {
+        return EvalStatus::UndefinedOperation;
+      } else {
+        uint8_t size;
+        CHECK_STATUS(cursor.geti(size));
+        CHECK_STATUS(cursor.implicitPushArg(size, 1, 1));
+
+        float a;
+        std::span<float> x, y;
+        CHECK_STATUS(popv<kChecked>(size, x));
+        CHECK_STATUS(pop<kChecked>(a));
+        CHECK_STATUS(peekv<kChecked>(size, y));
+        vec_kernels().axpy(y.data(), a, x.data(), size);
+        NEXT_OP();
+      }
     }
-    default:
+    OP_DEFAULT:
       return EvalStatus::UndefinedOperation;
     }
   }
@@ -0,0 +1,501 @@
+#include <WickedWinchProtocol/PostfixBatch.h>
+
+#include "FastMath.h"
+#include "Search.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace wickedwinch::protocol {
+namespace {
+
+#define FOR_LANES(l) for (size_t l = 0; l < kBatchLanes; ++l)
+
+using Lanes = float[kBatchLanes];
+
+// Runs decoded instructions over a structure-of-arrays stack. The program has
+// been verified, so no op checks stack or literal bounds; control flow only
+// depends on the instructions, never on lane values (except inside Lut).
+// Temporaries live in the stack headroom the verifier reserved above the top.
+struct BatchEvalContext {
+  PostfixBatchStack& stack;
+  const float* f_data;
+  size_t stack_size;
+  bool fast;
+
+  float* slot(size_t i) { return stack.slot(i); }
+  float* top(size_t n) { return stack.slot(stack_size - n); }
+
+  void pushf(const PostfixInstr& instr) {
+    const float* f = f_data + instr.f_offset;
+    for (uint16_t k = 0; k < instr.f_size; ++k) {
+      float* s = slot(stack_size++);
+      FOR_LANES(l) s[l] = f[k];
+    }
+  }
+
+  void copy(float* dst, const float* src, size_t slots) {
+    memmove(dst, src, slots * kBatchLanes * sizeof(float));
+  }
+
+  template <typename F>
+  void unary(F f) {
+    float* a = top(1);
+    FOR_LANES(l) a[l] = f(a[l]);
+  }
+
+  template <typename F>
+  void binary(F f) {
+    float* a = top(2);
+    const float* b = top(1);
+    FOR_LANES(l) a[l] = f(a[l], b[l]);
+    --stack_size;
+  }
+
+  // Runs Fn's branch-free core on every lane as one vector loop, then redoes
+  // any lane outside its range with the exact function.
+  template <typename Fn>
+  void fast_unary() {
+    float* a = top(1);
+    Lanes r;
+    int exact = 0;
+    FOR_LANES(l) {
+      exact |= !Fn::InRange(a[l]);
+      r[l] = Fn::Core(a[l]);
+    }
+    if (exact) {
+      FOR_LANES(l) r[l] = FastEval<Fn>(a[l]);
+    }
+    std::copy(r, r + kBatchLanes, a);
+  }
+
+  template <typename Fn>
+  void fast_binary() {
+    float* a = top(2);
+    const float* b = top(1);
+    Lanes r;
+    int exact = 0;
+    FOR_LANES(l) {
+      exact |= !Fn::InRange(a[l], b[l]);
+      r[l] = Fn::Core(a[l], b[l]);
+    }
+    if (exact) {
+      FOR_LANES(l) r[l] = FastEval<Fn>(a[l], b[l]);
+    }
+    std::copy(r, r + kBatchLanes, a);
+    --stack_size;
+  }
+
+  template <typename F>
+  void elementwise(uint8_t size, F f) {
+    float* lhs = top(2 * size);
+    const float* rhs = top(size);
+    for (size_t i = 0; i < size * kBatchLanes; ++i) {
+      lhs[i] = f(lhs[i], rhs[i]);
+    }
+    stack_size -= size;
+  }
+
+  void Step(const PostfixInstr& instr);
+};
+
+void BatchEvalContext::Step(const PostfixInstr& instr) {
+  switch (instr.op) {
+  case PostfixOp::Push:
+    pushf(instr);
+    break;
+  case PostfixOp::Pop:
+    stack_size -= instr.arg[0];
+    break;
+  case PostfixOp::Dup: {
+    uint8_t n = instr.arg[0];
+    copy(slot(stack_size), top(n + 1), 1);
+    ++stack_size;
+    break;
+  }
+  case PostfixOp::RotL: {
+    uint8_t n = instr.arg[0];
+    if (n <= 1) break;
+    float* v = top(n);
+    Lanes l0;
+    memcpy(l0, v, sizeof(l0));
+    copy(v, v + kBatchLanes, n - 1);
+    memcpy(v + (n - 1) * kBatchLanes, l0, sizeof(l0));
+    break;
+  }
+  case PostfixOp::RotR: {
+    uint8_t n = instr.arg[0];
+    if (n <= 1) break;
+    float* v = top(n);
+    Lanes r;
+    memcpy(r, v + (n - 1) * kBatchLanes, sizeof(r));
+    copy(v + kBatchLanes, v, n - 1);
+    memcpy(v, r, sizeof(r));
+    break;
+  }
+  case PostfixOp::Rev: {
+    uint8_t n = instr.arg[0];
+    float* v = top(n);
+    for (uint8_t i = 0, j = n - 1; i < n / 2; ++i, --j) {
+      std::swap_ranges(v + i * kBatchLanes, v + (i + 1) * kBatchLanes, v + j * kBatchLanes);
+    }
+    break;
+  }
+  case PostfixOp::Transpose: {
+    pushf(instr);
+    uint8_t rows = instr.arg[0];
+    uint8_t cols = instr.arg[1];
+    float* m = top(rows * cols);
+    float* temp = slot(stack_size);
+    for (uint8_t i = 0; i < rows; ++i) {
+      for (uint8_t j = 0; j < cols; ++j) {
+        size_t midx = cols * i + j;
+        size_t tidx = rows * j + i;
+        memcpy(temp + tidx * kBatchLanes, m + midx * kBatchLanes, sizeof(Lanes));
+      }
+    }
+    copy(m, temp, rows * cols);
+    break;
+  }
+  case PostfixOp::Add:
+    binary([](float a, float b) { return a + b; });
+    break;
+  case PostfixOp::Sub:
+    binary([](float a, float b) { return a - b; });
+    break;
+  case PostfixOp::Mul:
+    binary([](float a, float b) { return a * b; });
+    break;
+  case PostfixOp::MulAdd: {
+    float* a = top(3);
+    const float* b = top(2);
+    const float* c = top(1);
+    FOR_LANES(l) a[l] = a[l] * b[l] + c[l];
+    stack_size -= 2;
+    break;
+  }
+  case PostfixOp::Div:
+    binary([](float a, float b) { return a / b; });
+    break;
+  case PostfixOp::Mod:
+    binary([](float a, float b) { return std::fmod(a, b); });
+    break;
+  case PostfixOp::Neg:
+    unary([](float a) { return -a; });
+    break;
+  case PostfixOp::Abs:
+    unary([](float a) { return std::abs(a); });
+    break;
+  case PostfixOp::Inv:
+    unary([](float a) { return 1.0f / a; });
+    break;
+  case PostfixOp::Pow:
+    if (fast) {
+      fast_binary<FastPow>();
+    } else {
+      binary([](float a, float b) { return std::pow(a, b); });
+    }
+    break;
+  case PostfixOp::Sqrt:
+    unary([](float a) { return std::sqrt(a); });
+    break;
+  case PostfixOp::Exp:
+    if (fast) {
+      fast_unary<FastExp>();
+    } else {
+      unary([](float a) { return std::exp(a); });
+    }
+    break;
+  case PostfixOp::Ln:
+    if (fast) {
+      fast_unary<FastLn>();
+    } else {
+      unary([](float a) { return std::log(a); });
+    }
+    break;
+  case PostfixOp::Sin:
+    if (fast) {
+      fast_unary<FastSin>();
+    } else {
+      unary([](float a) { return std::sin(a); });
+    }
+    break;
+  case PostfixOp::Cos:
+    if (fast) {
+      fast_unary<FastCos>();
+    } else {
+      unary([](float a) { return std::cos(a); });
+    }
+    break;
+  case PostfixOp::Tan:
+    if (fast) {
+      fast_unary<FastTan>();
+    } else {
+      unary([](float a) { return std::tan(a); });
+    }
+    break;
+  case PostfixOp::Asin:
+    if (fast) {
+      fast_unary<FastAsin>();
+    } else {
+      unary([](float a) { return std::asin(a); });
+    }
+    break;
+  case PostfixOp::Acos:
+    if (fast) {
+      fast_unary<FastAcos>();
+    } else {
+      unary([](float a) { return std::acos(a); });
+    }
+    break;
+  case PostfixOp::Atan2:
+    if (fast) {
+      fast_binary<FastAtan2>();
+    } else {
+      binary([](float a, float b) { return std::atan2(a, b); });
+    }
+    break;
+  case PostfixOp::PolyVec: {
+    // Horner's rule as in the scalar interpreter, without fused multiply-add.
+    pushf(instr);
+    uint8_t size = instr.arg[0];
+    const float* coeff = top(size);
+    float* t = top(size + 1);
+    Lanes result = {};
+    if (size > 0) {
+      memcpy(result, coeff + (size - 1) * kBatchLanes, sizeof(result));
+      for (uint8_t n = size - 1; n-- > 0;) {
+        const float* c = coeff + n * kBatchLanes;
+        FOR_LANES(l) result[l] = result[l] * t[l] + c[l];
+      }
+    }
+    memcpy(t, result, sizeof(result));
+    stack_size -= size;
+    break;
+  }
+  case PostfixOp::PolyMat: {
+    // Accumulates in the last coefficient row, walking the rows upwards.
+    pushf(instr);
+    uint8_t rows = instr.arg[0];
+    uint8_t cols = instr.arg[1];
+    float* coeff = top(rows * cols);
+    float* result = top(rows * cols + 1);
+    if (rows == 0) {
+      memset(result, 0, cols * sizeof(Lanes));
+    } else {
+      Lanes t;
+      memcpy(t, result, sizeof(t));
+      float* acc = coeff + (rows - 1) * cols * kBatchLanes;
+      for (uint8_t i = rows - 1; i-- > 0;) {
+        const float* c = coeff + i * cols * kBatchLanes;
+        for (size_t j = 0; j < cols; ++j) {
+          FOR_LANES(l) acc[j * kBatchLanes + l] = acc[j * kBatchLanes + l] * t[l] + c[j * kBatchLanes + l];
+        }
+      }
+      copy(result, acc, cols);
+    }
+    stack_size -= rows * cols + 1;
+    stack_size += cols;
+    break;
+  }
+  case PostfixOp::AddVec:
+    pushf(instr);
+    elementwise(instr.arg[0], [](float a, float b) { return a + b; });
+    break;
+  case PostfixOp::SubVec:
+    pushf(instr);
+    elementwise(instr.arg[0], [](float a, float b) { return a - b; });
+    break;
+  case PostfixOp::MulVec:
+    pushf(instr);
+    elementwise(instr.arg[0], [](float a, float b) { return a * b; });
+    break;
+  case PostfixOp::MulAddVec: {
+    pushf(instr);
+    uint8_t size = instr.arg[0];
+    float* a = top(3 * size);
+    const float* b = top(2 * size);
+    const float* c = top(size);
+    for (size_t i = 0; i < size * kBatchLanes; ++i) {
+      a[i] = a[i] * b[i] + c[i];
+    }
+    stack_size -= 2 * size;
+    break;
+  }
+  case PostfixOp::ScaleVec: {
+    pushf(instr);
+    uint8_t size = instr.arg[0];
+    const float* v = top(size);
+    float* result = top(size + 1);
+    Lanes scalar;
+    memcpy(scalar, result, sizeof(scalar));
+    for (uint8_t i = 0; i < size; ++i) {
+      FOR_LANES(l) result[i * kBatchLanes + l] = scalar[l] * v[i * kBatchLanes + l];
+    }
+    --stack_size;
+    break;
+  }
+  case PostfixOp::NegVec: {
+    pushf(instr);
+    uint8_t size = instr.arg[0];
+    float* v = top(size);
+    for (size_t i = 0; i < size * kBatchLanes; ++i) {
+      v[i] = -v[i];
+    }
+    break;
+  }
+  case PostfixOp::NormVec: {
+    pushf(instr);
+    uint8_t size = instr.arg[0];
+    float* v = top(size);
+    Lanes result = {};
+    for (uint8_t i = 0; i < size; ++i) {
+      FOR_LANES(l) result[l] += v[i * kBatchLanes + l] * v[i * kBatchLanes + l];
+    }
+    FOR_LANES(l) v[l] = std::sqrt(result[l]);
+    stack_size -= size;
+    stack_size += 1;
+    break;
+  }
+  case PostfixOp::MulMat: {
+    pushf(instr);
+    uint8_t arows = instr.arg[0];
+    uint8_t brows = instr.arg[1];
+    uint8_t bcols = instr.arg[2];
+    const float* b = top(brows * bcols);
+    float* a = top(brows * bcols + arows * brows);
+    float* temp = slot(stack_size);
+    for (uint8_t i = 0; i < arows; ++i) {
+      for (uint8_t j = 0; j < bcols; ++j) {
+        Lanes r = {};
+        for (uint8_t k = 0; k < brows; ++k) {
+          const float* av = a + (brows * i + k) * kBatchLanes;
+          const float* bv = b + (bcols * k + j) * kBatchLanes;
+          FOR_LANES(l) r[l] += av[l] * bv[l];
+        }
+        memcpy(temp + (bcols * i + j) * kBatchLanes, r, sizeof(r));
+      }
+    }
+    copy(a, temp, arows * bcols);
+    stack_size -= brows * bcols + arows * brows;
+    stack_size += arows * bcols;
+    break;
+  }
+  case PostfixOp::Lerp: {
+    pushf(instr);
+    uint8_t size = instr.arg[0];
+    const float* v1 = top(size);
+    const float* v0 = top(2 * size);
+    float* result = top(2 * size + 1);
+    Lanes t;
+    memcpy(t, result, sizeof(t));
+    for (uint8_t i = 0; i < size; ++i) {
+      FOR_LANES(l) {
+        result[i * kBatchLanes + l] =
+            (1-t[l])*v0[i * kBatchLanes + l] + t[l]*v1[i * kBatchLanes + l];
+      }
+    }
+    stack_size -= 2 * size + 1;
+    stack_size += size;
+    break;
+  }
+  case PostfixOp::Lut: {
+    pushf(instr);
+    uint8_t rows = instr.arg[0];
+    uint8_t cols = instr.arg[1];
+    uint8_t n = cols - 1;
+    const float* lut = top(rows * cols);
+    float* result = top(rows * cols + 1);
+    // Each lane may land in a different row, so the search runs per lane.
+    FOR_LANES(l) {
+      auto at = [lut, l](size_t i) { return lut[i * kBatchLanes + l]; };
+      float t = result[l];
+      size_t ubrow = search(rows, [t, cols, &at](size_t i) -> bool {
+        return t < at(cols*i);
+      });
+      if (ubrow == 0) {
+        for (uint8_t i = 0; i < n; ++i) result[i * kBatchLanes + l] = at(1 + i);
+      } else if (ubrow == rows) {
+        size_t bound = (rows - 1) * cols;
+        for (uint8_t i = 0; i < n; ++i) result[i * kBatchLanes + l] = at(bound + 1 + i);
+      } else {
+        size_t ub = ubrow * cols;
+        size_t lb = ub - cols;
+        float t0 = at(lb);
+        float t1 = at(ub);
+        t = (t - t0) / (t1 - t0);
+        for (uint8_t i = 0; i < n; ++i) {
+          result[i * kBatchLanes + l] = (1-t)*at(lb + 1 + i) + t*at(ub + 1 + i);
+        }
+      }
+    }
+    stack_size -= rows * cols + 1;
+    stack_size += n;
+    break;
+  }
+  case PostfixOp::AddConst: {
+    float c = f_data[instr.f_offset];
+    unary([c](float a) { return a + c; });
+    break;
+  }
+  case PostfixOp::SubConst: {
+    float c = f_data[instr.f_offset];
+    unary([c](float a) { return a - c; });
+    break;
+  }
+  case PostfixOp::MulConst: {
+    float c = f_data[instr.f_offset];
+    unary([c](float a) { return a * c; });
+    break;
+  }
+  case PostfixOp::DivConst: {
+    float c = f_data[instr.f_offset];
+    unary([c](float a) { return a / c; });
+    break;
+  }
+  case PostfixOp::Square:
+    unary([](float a) { return a * a; });
+    break;
+  case PostfixOp::Axpy: {
+    pushf(instr);
+    uint8_t size = instr.arg[0];
+    const float* x = top(size);
+    Lanes a;
+    memcpy(a, top(size + 1), sizeof(a));
+    float* y = top(2 * size + 1);
+    for (uint8_t i = 0; i < size; ++i) {
+      FOR_LANES(l) y[i * kBatchLanes + l] += a[l] * x[i * kBatchLanes + l];
+    }
+    stack_size -= size + 1;
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+}
+
+EvalStatus PostfixBatchStack::Eval(const PostfixProgram& program, PostfixPrecision precision) {
+  if (!program.verified()) return EvalStatus::IllegalOperation;
+  if (stack_size < program.input_size()) return EvalStatus::StackUnderflow;
+  if (stack_size > stack_capacity ||
+      stack_capacity - stack_size < program.max_stack_size() - program.input_size()) {
+    return EvalStatus::StackOverflow;
+  }
+
+  BatchEvalContext context{
+    .stack      = *this,
+    .f_data     = program.f_data(),
+    .stack_size = stack_size,
+    .fast       = precision == PostfixPrecision::Fast,
+  };
+  for (const PostfixInstr& instr : program.instrs()) {
+    context.Step(instr);
+  }
+  stack_size = context.stack_size;
+  return EvalStatus::Ok;
+}
+
+}
@@ -0,0 +1,255 @@
+#include <WickedWinchProtocol/PostfixOptimize.h>
+#include <WickedWinchProtocol/PostfixProgram.h>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace wickedwinch::protocol {
+namespace {
+
+// How a decoded instruction uses the stack. inputs counts the implicitly
+// pushed literals, which sit on top of the values the op consumes.
+struct OpShape {
+  uint8_t args;
+  size_t inputs;
+  size_t outputs;
+  // The int operand carrying the implicit push count in its low bits, or -1.
+  int push_arg = -1;
+  uint8_t instances = 0;
+  // Floats pushed per instance.
+  size_t block = 0;
+};
+
+OpShape Shape(const PostfixInstr& instr) {
+  const uint8_t* a = instr.arg;
+  switch (instr.op) {
+  case PostfixOp::Push:
+    return {.args = 1, .inputs = 0, .outputs = a[0]};
+  case PostfixOp::Pop:
+    return {.args = 1, .inputs = a[0], .outputs = 0};
+  case PostfixOp::Dup:
+    return {.args = 1, .inputs = size_t(a[0]) + 1, .outputs = size_t(a[0]) + 2};
+  case PostfixOp::RotL:
+  case PostfixOp::RotR:
+  case PostfixOp::Rev: {
+    size_t n = a[0] <= 1 ? 0 : a[0];
+    return {.args = 1, .inputs = n, .outputs = n};
+  }
+  case PostfixOp::Transpose:
+    return {.args = 2, .inputs = size_t(a[0]) * a[1], .outputs = size_t(a[0]) * a[1],
+            .push_arg = 1, .instances = 1, .block = size_t(a[0]) * a[1]};
+  case PostfixOp::Add:
+  case PostfixOp::Sub:
+  case PostfixOp::Mul:
+  case PostfixOp::Div:
+  case PostfixOp::Mod:
+  case PostfixOp::Pow:
+  case PostfixOp::Atan2:
+    return {.args = 0, .inputs = 2, .outputs = 1};
+  case PostfixOp::MulAdd:
+    return {.args = 0, .inputs = 3, .outputs = 1};
+  case PostfixOp::PolyVec:
+    return {.args = 1, .inputs = size_t(a[0]) + 1, .outputs = 1,
+            .push_arg = 0, .instances = 1, .block = a[0]};
+  case PostfixOp::PolyMat:
+    return {.args = 2, .inputs = size_t(a[0]) * a[1] + 1, .outputs = a[1],
+            .push_arg = 1, .instances = 1, .block = size_t(a[0]) * a[1]};
+  case PostfixOp::AddVec:
+  case PostfixOp::SubVec:
+  case PostfixOp::MulVec:
+    return {.args = 1, .inputs = 2 * size_t(a[0]), .outputs = a[0],
+            .push_arg = 0, .instances = 1, .block = a[0]};
+  case PostfixOp::MulAddVec:
+    return {.args = 1, .inputs = 3 * size_t(a[0]), .outputs = a[0],
+            .push_arg = 0, .instances = 2, .block = a[0]};
+  case PostfixOp::ScaleVec:
+    return {.args = 1, .inputs = size_t(a[0]) + 1, .outputs = a[0],
+            .push_arg = 0, .instances = 1, .block = a[0]};
+  case PostfixOp::NegVec:
+    return {.args = 1, .inputs = a[0], .outputs = a[0],
+            .push_arg = 0, .instances = 1, .block = a[0]};
+  case PostfixOp::NormVec:
+    return {.args = 1, .inputs = a[0], .outputs = 1,
+            .push_arg = 0, .instances = 1, .block = a[0]};
+  case PostfixOp::MulMat:
+    return {.args = 3, .inputs = size_t(a[0]) * a[1] + size_t(a[1]) * a[2],
+            .outputs = size_t(a[0]) * a[2],
+            .push_arg = 2, .instances = 1, .block = size_t(a[1]) * a[2]};
+  case PostfixOp::Lerp:
+    return {.args = 1, .inputs = 2 * size_t(a[0]) + 1, .outputs = a[0],
+            .push_arg = 0, .instances = 2, .block = a[0]};
+  case PostfixOp::Lut:
+    return {.args = 2, .inputs = size_t(a[0]) * a[1] + 1, .outputs = size_t(a[1]) - 1,
+            .push_arg = 1, .instances = 1, .block = size_t(a[0]) * a[1]};
+  default:
+    // Every remaining op is unary.
+    return {.args = 0, .inputs = 1, .outputs = 1};
+  }
+}
+
+// Emits the optimized expression. pending holds the values on top of the
+// abstract stack that are known literals and have not been emitted yet; every
+// value below them is computed at evaluation time.
+struct Optimizer {
+  PostfixWriter& out;
+  PostfixOptimizeStats& stats;
+  std::vector<float> pending;
+  // Stream sizes of out, which the writer's accessors would truncate.
+  size_t op_size = 0;
+  size_t i_size = 0;
+  size_t f_size = 0;
+
+  void add_op(PostfixOp op) {
+    out.add_op(op);
+    ++op_size;
+  }
+
+  void add_i(uint8_t i) {
+    out.add_i(i);
+    ++i_size;
+  }
+
+  void add_f(float f) {
+    out.add_f(f);
+    ++f_size;
+  }
+
+  // Emits the pending values below the top n as Push ops.
+  void flush(size_t n = 0) {
+    size_t end = pending.size() - n;
+    for (size_t begin = 0; begin < end;) {
+      size_t count = std::min<size_t>(end - begin, std::numeric_limits<uint8_t>::max());
+      add_op(PostfixOp::Push);
+      add_i(uint8_t(count));
+      for (size_t k = 0; k < count; ++k) add_f(pending[begin + k]);
+      begin += count;
+    }
+    pending.erase(pending.begin(), pending.begin() + end);
+  }
+
+  void encode(const PostfixInstr& instr, const OpShape& shape, uint8_t push_count) {
+    add_op(instr.op);
+    for (int k = 0; k < shape.args; ++k) {
+      uint8_t v = instr.arg[k];
+      if (k == shape.push_arg) v = uint8_t(v << shape.instances | push_count);
+      add_i(v);
+    }
+  }
+
+  // Replaces the top shape.inputs pending values with the op's result.
+  bool fold(const PostfixInstr& instr, const OpShape& shape) {
+    PostfixWriter writer;
+    writer.add_op(instr.op);
+    for (int k = 0; k < shape.args; ++k) {
+      uint8_t v = instr.arg[k];
+      if (k == shape.push_arg) v = uint8_t(v << shape.instances);
+      writer.add_i(v);
+    }
+
+    std::vector<float> data(2 * shape.inputs + shape.outputs);
+    PostfixStack stack{
+      .stack_data     = data.data(),
+      .stack_size     = shape.inputs,
+      .stack_capacity = data.size(),
+    };
+    std::copy(pending.end() - shape.inputs, pending.end(), data.begin());
+    if (stack.Eval(writer) != EvalStatus::Ok || stack.stack_size != shape.outputs) {
+      return false;
+    }
+    pending.resize(pending.size() - shape.inputs);
+    pending.insert(pending.end(), data.begin(), data.begin() + shape.outputs);
+    return true;
+  }
+
+  // Emits an op whose operands are not all known, pushing as many of the
+  // pending values as its encoding allows implicitly.
+  void emit(const PostfixInstr& instr, const OpShape& shape) {
+    uint8_t push_count = 0;
+    if (shape.push_arg >= 0 && shape.block > 0) {
+      size_t mask = (size_t(1) << shape.instances) - 1;
+      push_count = uint8_t(std::min({
+          mask, pending.size() / shape.block, shape.inputs / shape.block}));
+    }
+    size_t literals = push_count * shape.block;
+    flush(literals);
+    encode(instr, shape, push_count);
+    for (float f : pending) add_f(f);
+    pending.clear();
+  }
+
+  void Step(const PostfixInstr& instr, const float* f_data) {
+    OpShape shape = Shape(instr);
+    const float* f = f_data + instr.f_offset;
+    pending.insert(pending.end(), f, f + instr.f_size);
+    if (instr.op == PostfixOp::Push) return;
+
+    if (shape.inputs == 0 && shape.outputs == 0) {
+      ++stats.folded_ops;
+      return;
+    }
+    if (pending.size() >= shape.inputs && fold(instr, shape)) {
+      ++stats.folded_ops;
+      if (instr.op == PostfixOp::Pop) stats.dropped_values += shape.inputs;
+      return;
+    }
+    if (instr.op == PostfixOp::Pop) {
+      stats.dropped_values += pending.size();
+      add_op(PostfixOp::Pop);
+      add_i(uint8_t(shape.inputs - pending.size()));
+      pending.clear();
+      return;
+    }
+    emit(instr, shape);
+  }
+};
+
+}
+
+EvalStatus OptimizePostfix(
+    const PostfixOp* op_data, uint8_t op_size,
+    const uint8_t* i_data, uint8_t i_size,
+    const float* f_data, uint16_t f_size,
+    size_t input_size, PostfixWriter& out,
+    PostfixOptimizeStats* stats) {
+  PostfixProgram program;
+  if (EvalStatus status = program.Verify(
+          op_data, op_size, i_data, i_size, f_data, f_size, input_size);
+      status != EvalStatus::Ok) {
+    return status;
+  }
+
+  out.clear();
+  PostfixOptimizeStats local;
+  PostfixOptimizeStats& s = stats ? *stats : local;
+  s = {};
+  s.input_ops = op_size;
+
+  Optimizer optimizer{.out = out, .stats = s, .pending = {}};
+  for (const PostfixInstr& instr : program.instrs()) {
+    optimizer.Step(instr, program.f_data());
+  }
+  optimizer.flush();
+
+  PostfixWriter original;
+  for (uint8_t k = 0; k < op_size; ++k) original.add_op(op_data[k]);
+  for (uint8_t k = 0; k < i_size; ++k) original.add_i(i_data[k]);
+  for (uint16_t k = 0; k < f_size; ++k) original.add_f(f_data[k]);
+
+  bool fits =
+      optimizer.op_size <= std::numeric_limits<uint8_t>::max() &&
+      optimizer.i_size <= std::numeric_limits<uint8_t>::max() &&
+      optimizer.f_size <= std::numeric_limits<uint16_t>::max();
+  if (!fits || out.data_size() > original.data_size()) {
+    out = std::move(original);
+    s.folded_ops = 0;
+    s.dropped_values = 0;
+    s.output_ops = op_size;
+    return EvalStatus::Ok;
+  }
+  s.output_ops = optimizer.op_size;
+  return EvalStatus::Ok;
+}
+
+}
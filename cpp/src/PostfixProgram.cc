@@ -0,0 +1,423 @@
+#include <WickedWinchProtocol/PostfixProgram.h>
+
+#include <algorithm>
+
+namespace wickedwinch::protocol {
+namespace {
+
+// Tracks only the sizes of the stack and literal streams, mirroring the
+// checks made by PostfixEvalContext, and records the decoded operands of the
+// current op in instr.
+struct Verifier {
+  const uint8_t* i_head;
+  uint8_t i_size;
+  uint16_t f_offset;
+  uint16_t f_size;
+  size_t stack_size;
+  size_t max_stack_size;
+  PostfixInstr instr;
+  uint8_t argi;
+
+  EvalStatus geti(uint8_t& n) {
+    if (i_size < 1) return EvalStatus::IntLiteralsUnderflow;
+    n = i_head[0];
+    --i_size;
+    ++i_head;
+    instr.arg[argi++] = n;
+    return EvalStatus::Ok;
+  }
+
+  void push(size_t n) {
+    stack_size += n;
+    max_stack_size = std::max(max_stack_size, stack_size);
+  }
+
+  EvalStatus pushf(size_t n) {
+    if (n > f_size) return EvalStatus::FloatLiteralsUnderflow;
+    instr.f_offset = f_offset;
+    instr.f_size = uint16_t(n);
+    f_offset += n;
+    f_size -= n;
+    push(n);
+    return EvalStatus::Ok;
+  }
+
+  // Every op applies this to the int operand it read last, so the unpacked
+  // value replaces that operand in the decoded instruction.
+  EvalStatus implicitPushArg(uint8_t& arg, uint8_t multiple, uint8_t instances) {
+    uint8_t mask = uint8_t(1 << instances) - 1;
+    uint8_t push_count = arg & mask;
+    arg >>= instances;
+    instr.arg[argi - 1] = arg;
+    if (push_count == 0) return EvalStatus::Ok;
+    return pushf(uint16_t(push_count * multiple * arg));
+  }
+
+  // Accounts for temporaries stored in the n values above the stack top.
+  void reserve(size_t n) {
+    max_stack_size = std::max(max_stack_size, stack_size + n);
+  }
+
+  EvalStatus pop(size_t n) {
+    if (stack_size < n) return EvalStatus::StackUnderflow;
+    stack_size -= n;
+    return EvalStatus::Ok;
+  }
+
+  EvalStatus peek(size_t n) {
+    if (stack_size < n) return EvalStatus::StackUnderflow;
+    return EvalStatus::Ok;
+  }
+
+  EvalStatus Step(PostfixOp op);
+};
+
+#define CHECK_STATUS(expr) if (EvalStatus status = expr; status != EvalStatus::Ok) return status
+
+EvalStatus Verifier::Step(PostfixOp op) {
+  switch (op) {
+  case PostfixOp::Push: {
+    uint8_t n;
+    CHECK_STATUS(geti(n));
+    return pushf(n);
+  }
+  case PostfixOp::Pop: {
+    uint8_t n;
+    CHECK_STATUS(geti(n));
+    return pop(n);
+  }
+  case PostfixOp::Dup: {
+    uint8_t n;
+    CHECK_STATUS(geti(n));
+    CHECK_STATUS(peek(size_t(n) + 1));
+    push(1);
+    return EvalStatus::Ok;
+  }
+  case PostfixOp::RotL:
+  case PostfixOp::RotR: {
+    uint8_t n;
+    CHECK_STATUS(geti(n));
+    if (n <= 1) return EvalStatus::Ok;
+    return peek(n);
+  }
+  case PostfixOp::Rev: {
+    uint8_t n;
+    CHECK_STATUS(geti(n));
+    return peek(n);
+  }
+  case PostfixOp::Transpose: {
+    uint8_t rows, cols;
+    CHECK_STATUS(geti(rows));
+    CHECK_STATUS(geti(cols));
+    CHECK_STATUS(implicitPushArg(cols, rows, 1));
+    CHECK_STATUS(pop(rows * cols));
+    reserve(2 * rows * cols);
+    push(rows * cols);
+    return EvalStatus::Ok;
+  }
+  case PostfixOp::Add:
+  case PostfixOp::Sub:
+  case PostfixOp::Mul:
+  case PostfixOp::Div:
+  case PostfixOp::Mod:
+  case PostfixOp::Pow:
+  case PostfixOp::Atan2:
+    CHECK_STATUS(pop(2));
+    push(1);
+    return EvalStatus::Ok;
+  case PostfixOp::MulAdd:
+    CHECK_STATUS(pop(3));
+    push(1);
+    return EvalStatus::Ok;
+  case PostfixOp::Neg:
+  case PostfixOp::Abs:
+  case PostfixOp::Inv:
+  case PostfixOp::Sqrt:
+  case PostfixOp::Exp:
+  case PostfixOp::Ln:
+  case PostfixOp::Sin:
+  case PostfixOp::Cos:
+  case PostfixOp::Tan:
+  case PostfixOp::Asin:
+  case PostfixOp::Acos:
+    CHECK_STATUS(pop(1));
+    push(1);
+    return EvalStatus::Ok;
+  case PostfixOp::PolyVec: {
+    uint8_t size;
+    CHECK_STATUS(geti(size));
+    CHECK_STATUS(implicitPushArg(size, 1, 1));
+    CHECK_STATUS(pop(size));
+    CHECK_STATUS(pop(1));
+    push(1);
+    return EvalStatus::Ok;
+  }
+  case PostfixOp::PolyMat: {
+    uint8_t rows, cols;
+    CHECK_STATUS(geti(rows));
+    CHECK_STATUS(geti(cols));
+    CHECK_STATUS(implicitPushArg(cols, rows, 1));
+    CHECK_STATUS(pop(rows * cols));
+    CHECK_STATUS(pop(1));
+    push(cols);
+    return EvalStatus::Ok;
+  }
+  case PostfixOp::AddVec:
+  case PostfixOp::SubVec:
+  case PostfixOp::MulVec: {
+    uint8_t size;
+    CHECK_STATUS(geti(size));
+    CHECK_STATUS(implicitPushArg(size, 1, 1));
+    CHECK_STATUS(pop(size));
+    return peek(size);
+  }
+  case PostfixOp::MulAddVec: {
+    uint8_t size;
+    CHECK_STATUS(geti(size));
+    CHECK_STATUS(implicitPushArg(size, 1, 2));
+    CHECK_STATUS(pop(size));
+    CHECK_STATUS(pop(size));
+    return peek(size);
+  }
+  case PostfixOp::ScaleVec: {
+    uint8_t size;
+    CHECK_STATUS(geti(size));
+    CHECK_STATUS(implicitPushArg(size, 1, 1));
+    CHECK_STATUS(pop(size));
+    CHECK_STATUS(pop(1));
+    push(size);
+    return EvalStatus::Ok;
+  }
+  case PostfixOp::NegVec: {
+    uint8_t size;
+    CHECK_STATUS(geti(size));
+    CHECK_STATUS(implicitPushArg(size, 1, 1));
+    return peek(size);
+  }
+  case PostfixOp::NormVec: {
+    uint8_t size;
+    CHECK_STATUS(geti(size));
+    CHECK_STATUS(implicitPushArg(size, 1, 1));
+    CHECK_STATUS(pop(size));
+    push(1);
+    return EvalStatus::Ok;
+  }
+  case PostfixOp::MulMat: {
+    uint8_t arows, brows, bcols;
+    CHECK_STATUS(geti(arows));
+    CHECK_STATUS(geti(brows));
+    CHECK_STATUS(geti(bcols));
+    CHECK_STATUS(implicitPushArg(bcols, brows, 1));
+    CHECK_STATUS(pop(brows * bcols));
+    CHECK_STATUS(pop(arows * brows));
+    reserve(brows * bcols + arows * brows + arows * bcols);
+    push(arows * bcols);
+    return EvalStatus::Ok;
+  }
+  case PostfixOp::Lerp: {
+    uint8_t size;
+    CHECK_STATUS(geti(size));
+    CHECK_STATUS(implicitPushArg(size, 1, 2));
+    CHECK_STATUS(pop(size));
+    CHECK_STATUS(pop(size));
+    CHECK_STATUS(pop(1));
+    push(size);
+    return EvalStatus::Ok;
+  }
+  case PostfixOp::Lut: {
+    uint8_t rows, cols;
+    CHECK_STATUS(geti(rows));
+    CHECK_STATUS(geti(cols));
+    CHECK_STATUS(implicitPushArg(cols, rows, 1));
+    if (rows < 1) return EvalStatus::IllegalOperation;
+    if (cols < 1) return EvalStatus::IllegalOperation;
+    CHECK_STATUS(pop(rows * cols));
+    CHECK_STATUS(pop(1));
+    push(cols - 1);
+    return EvalStatus::Ok;
+  }
+  default:
+    return EvalStatus::UndefinedOperation;
+  }
+}
+
+// Ops that push a literal range before executing, via implicitPushArg.
+bool AcceptsLiterals(PostfixOp op) {
+  switch (op) {
+  case PostfixOp::Transpose:
+  case PostfixOp::PolyVec:
+  case PostfixOp::PolyMat:
+  case PostfixOp::AddVec:
+  case PostfixOp::SubVec:
+  case PostfixOp::MulVec:
+  case PostfixOp::MulAddVec:
+  case PostfixOp::ScaleVec:
+  case PostfixOp::NegVec:
+  case PostfixOp::NormVec:
+  case PostfixOp::MulMat:
+  case PostfixOp::Lerp:
+  case PostfixOp::Lut:
+  case PostfixOp::Axpy:
+    return true;
+  default:
+    return false;
+  }
+}
+
+enum class Fusion {
+  None,
+  MergedPush,
+  ConstOp,
+  Square,
+  Axpy,
+};
+
+// Returns the kind of fusion, if any, that lets a followed by b run as the
+// single instruction fused.
+Fusion FusePair(const PostfixInstr& a, const PostfixInstr& b, PostfixInstr& fused) {
+  if (a.op == PostfixOp::Push) {
+    if (b.op == PostfixOp::Push) {
+      if (a.f_offset + a.f_size != b.f_offset) return Fusion::None;
+      if (a.f_size + b.f_size > UINT8_MAX) return Fusion::None;
+      fused = a;
+      fused.arg[0] = uint8_t(a.f_size + b.f_size);
+      fused.f_size = a.f_size + b.f_size;
+      return Fusion::MergedPush;
+    }
+    if (a.f_size == 1) {
+      PostfixOp op;
+      switch (b.op) {
+      case PostfixOp::Add: op = PostfixOp::AddConst; break;
+      case PostfixOp::Sub: op = PostfixOp::SubConst; break;
+      case PostfixOp::Mul: op = PostfixOp::MulConst; break;
+      case PostfixOp::Div: op = PostfixOp::DivConst; break;
+      default: op = PostfixOp::Undefined; break;
+      }
+      if (op != PostfixOp::Undefined) {
+        fused = PostfixInstr{.op = op, .arg = {}, .f_offset = a.f_offset, .f_size = 1};
+        return Fusion::ConstOp;
+      }
+    }
+    if (AcceptsLiterals(b.op) && b.f_size == 0) {
+      fused = b;
+      fused.f_offset = a.f_offset;
+      fused.f_size = a.f_size;
+      return Fusion::MergedPush;
+    }
+    return Fusion::None;
+  }
+  if (a.op == PostfixOp::Dup && a.arg[0] == 0 && b.op == PostfixOp::Mul) {
+    fused = PostfixInstr{.op = PostfixOp::Square, .arg = {}, .f_offset = 0, .f_size = 0};
+    return Fusion::Square;
+  }
+  if (a.op == PostfixOp::ScaleVec && b.op == PostfixOp::AddVec &&
+      b.f_size == 0 && a.arg[0] == b.arg[0]) {
+    fused = a;
+    fused.op = PostfixOp::Axpy;
+    return Fusion::Axpy;
+  }
+  return Fusion::None;
+}
+
+}
+
+EvalStatus PostfixProgram::Verify(
+    const PostfixOp* op_data, uint8_t op_size,
+    const uint8_t* i_data, uint8_t i_size,
+    const float* f_data, uint16_t f_size,
+    size_t input_size) {
+  instrs_.clear();
+  f_data_ = nullptr;
+  verified_ = false;
+
+  Verifier verifier{
+    .i_head         = i_data,
+    .i_size         = i_size,
+    .f_offset       = 0,
+    .f_size         = f_size,
+    .stack_size     = input_size,
+    .max_stack_size = input_size,
+    .instr          = {},
+    .argi           = 0,
+  };
+  instrs_.reserve(op_size);
+  for (uint8_t opi = 0; opi < op_size; ++opi) {
+    verifier.instr = PostfixInstr{.op = op_data[opi], .arg = {}, .f_offset = 0, .f_size = 0};
+    verifier.argi = 0;
+    if (EvalStatus status = verifier.Step(op_data[opi]); status != EvalStatus::Ok) {
+      instrs_.clear();
+      return status;
+    }
+    instrs_.push_back(verifier.instr);
+  }
+
+  f_data_ = f_data;
+  verified_ = true;
+  input_size_ = input_size;
+  max_stack_size_ = verifier.max_stack_size;
+  output_size_ = verifier.stack_size;
+  return EvalStatus::Ok;
+}
+
+PostfixFusionStats PostfixProgram::Fuse() {
+  PostfixFusionStats stats;
+  stats.input_instrs = instrs_.size();
+
+  size_t n = 0;
+  for (size_t i = 0; i < instrs_.size(); ++i) {
+    PostfixInstr instr = instrs_[i];
+    while (n > 0) {
+      PostfixInstr fused;
+      Fusion fusion = FusePair(instrs_[n - 1], instr, fused);
+      if (fusion == Fusion::None) break;
+
+      // Leave a push alone if it fuses into a superinstruction with the op
+      // after it instead.
+      PostfixInstr next;
+      if (fusion == Fusion::MergedPush && instr.op == PostfixOp::Push &&
+          i + 1 < instrs_.size()) {
+        Fusion next_fusion = FusePair(instr, instrs_[i + 1], next);
+        if (next_fusion != Fusion::None && next_fusion != Fusion::MergedPush) break;
+      }
+
+      switch (fusion) {
+      case Fusion::MergedPush: ++stats.merged_pushes; break;
+      case Fusion::ConstOp: ++stats.const_ops; break;
+      case Fusion::Square: ++stats.squares; break;
+      case Fusion::Axpy: ++stats.axpys; break;
+      case Fusion::None: break;
+      }
+      instr = fused;
+      --n;
+    }
+    instrs_[n++] = instr;
+  }
+  instrs_.resize(n);
+
+  stats.output_instrs = instrs_.size();
+  return stats;
+}
+
+EvalStatus PostfixStack::Eval(const PostfixProgram& program, PostfixPrecision precision) {
+  if (!program.verified()) return EvalStatus::IllegalOperation;
+  if (stack_size < program.input_size()) return EvalStatus::StackUnderflow;
+  if (stack_capacity - stack_size < program.max_stack_size() - program.input_size()) {
+    return EvalStatus::StackOverflow;
+  }
+
+  // Only the stack fields are read by EvalUnchecked. Leaving the stream
+  // fields unset keeps GCC from zeroing the whole context with rep stosq,
+  // whose startup cost exceeded that of a short program.
+  PostfixEvalContext context;
+  context.stack_data = stack_data;
+  context.stack_size = stack_size;
+  context.stack_capacity = stack_capacity;
+  context.scratch_data = scratch_data;
+  context.scratch_capacity = scratch_capacity;
+  context.precision = precision;
+  EvalStatus status = context.EvalUnchecked(program.instrs(), program.f_data());
+  stack_size = context.stack_size;
+  return status;
+}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+
+namespace wickedwinch::protocol {
+
+template <typename Pred>
+size_t search(size_t base, size_t n, const Pred& pred) {
+  while (n) {
+    size_t h = n >> 1;
+    if (pred(base + h)) {
+      n = h;
+    } else {
+      if (h == 0) break;
+      base += h;
+      n -= h;
+    }
+  }
+  return base + n;
+}
+
+// Return the smallest index i in [0, n) at which pred(i) is true.
+template <typename Pred>
+size_t search(size_t n, const Pred& pred) {
+  return search(0, n, pred);
+}
+
+}
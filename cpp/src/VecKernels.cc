@@ -0,0 +1,105 @@
+#include <WickedWinchProtocol/Simd.h>
+
+#include "VecKernelsImpl.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define WICKEDWINCH_SSE_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace wickedwinch::protocol {
+namespace {
+
+struct Scalar {
+  using V = float;
+  static constexpr size_t kWidth = 1;
+
+  static V load(const float* p) { return *p; }
+  static void store(float* p, V v) { *p = v; }
+  static V set1(float f) { return f; }
+  static V zero() { return 0; }
+  static V add(V a, V b) { return a + b; }
+  static V sub(V a, V b) { return a - b; }
+  static V mul(V a, V b) { return a * b; }
+  static V neg(V a) { return -a; }
+  static V madd(V a, V b, V c) { return a * b + c; }
+  static float madd1(float a, float b, float c) { return a * b + c; }
+  static float hsum(V v) { return v; }
+};
+
+#ifdef WICKEDWINCH_SSE_KERNELS
+// SSE2 is part of the x86-64 baseline, so this needs no CPU check.
+struct Sse {
+  using V = __m128;
+  static constexpr size_t kWidth = 4;
+
+  static V load(const float* p) { return _mm_loadu_ps(p); }
+  static void store(float* p, V v) { _mm_storeu_ps(p, v); }
+  static V set1(float f) { return _mm_set1_ps(f); }
+  static V zero() { return _mm_setzero_ps(); }
+  static V add(V a, V b) { return _mm_add_ps(a, b); }
+  static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+  static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+  static V neg(V a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+  static V madd(V a, V b, V c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+  static float madd1(float a, float b, float c) { return a * b + c; }
+
+  static float hsum(V v) {
+    V s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+  }
+};
+#endif
+
+const VecKernels* Table(SimdLevel level) {
+  switch (level) {
+#ifdef WICKEDWINCH_AVX2_KERNELS
+  case SimdLevel::Avx2:
+    return &avx2_vec_kernels;
+#endif
+#ifdef WICKEDWINCH_SSE_KERNELS
+  case SimdLevel::Sse:
+    return &Kernels<Sse>::kTable;
+#endif
+  default:
+    return &Kernels<Scalar>::kTable;
+  }
+}
+
+SimdLevel active_level = SimdLevel::Scalar;
+
+// Evaluation before this runs, such as from another static initializer, uses
+// the scalar kernels.
+[[maybe_unused]] const bool selected = (SetSimdLevel(SupportedSimdLevel()), true);
+
+}
+
+const VecKernels* active_vec_kernels = &Kernels<Scalar>::kTable;
+
+SimdLevel SupportedSimdLevel() {
+#ifdef WICKEDWINCH_AVX2_KERNELS
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return SimdLevel::Avx2;
+  }
+#endif
+#ifdef WICKEDWINCH_SSE_KERNELS
+  return SimdLevel::Sse;
+#else
+  return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel ActiveSimdLevel() {
+  return active_level;
+}
+
+void SetSimdLevel(SimdLevel level) {
+  level = std::min(level, SupportedSimdLevel());
+  active_level = level;
+  active_vec_kernels = Table(level);
+}
+
+}
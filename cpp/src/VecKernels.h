@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+
+namespace wickedwinch::protocol {
+
+// Elementwise kernels for the vector ops, one table per SimdLevel.
+//
+// Outputs may overlap inputs the way the interpreter lays them out: out may
+// start one float below v or v0, since every kernel loads a block before
+// storing the block it produces.
+struct VecKernels {
+  void (*add)(float* a, const float* b, size_t n);
+  void (*sub)(float* a, const float* b, size_t n);
+  void (*mul)(float* a, const float* b, size_t n);
+  void (*mul_add)(float* a, const float* b, const float* c, size_t n);
+  void (*scale)(float* out, float s, const float* v, size_t n);
+  void (*axpy)(float* y, float a, const float* x, size_t n);
+  void (*neg)(float* v, size_t n);
+  float (*norm2)(const float* v, size_t n);
+  void (*lerp)(float* out, float t, const float* v0, const float* v1, size_t n);
+  // Horner steps over rows of polynomial coefficients, last row first:
+  // acc[j] = acc[j] * t + coeff[i * cols + j] for i from rows - 1 down to 0.
+  void (*horner)(float* acc, float t, const float* coeff, size_t rows, size_t cols);
+  // c[0] + c[1] t + ... + c[n-1] t^(n-1) by Horner's rule.
+  float (*poly)(const float* c, size_t n, float t);
+};
+
+extern const VecKernels* active_vec_kernels;
+
+inline const VecKernels& vec_kernels() { return *active_vec_kernels; }
+
+#ifdef WICKEDWINCH_AVX2_KERNELS
+// Defined in a translation unit built for AVX2 and FMA; only call when the CPU
+// has both.
+extern const VecKernels avx2_vec_kernels;
+#endif
+
+}
@@ -0,0 +1,39 @@
+// Built with AVX2 and FMA enabled; nothing here may run before the CPU is
+// checked. Contraction is disabled for this file, so only madd fuses.
+
+#include "VecKernelsImpl.h"
+
+#include <cmath>
+#include <immintrin.h>
+
+namespace wickedwinch::protocol {
+namespace {
+
+struct Avx2 {
+  using V = __m256;
+  static constexpr size_t kWidth = 8;
+
+  static V load(const float* p) { return _mm256_loadu_ps(p); }
+  static void store(float* p, V v) { _mm256_storeu_ps(p, v); }
+  static V set1(float f) { return _mm256_set1_ps(f); }
+  static V zero() { return _mm256_setzero_ps(); }
+  static V add(V a, V b) { return _mm256_add_ps(a, b); }
+  static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+  static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+  static V neg(V a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+  static V madd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+  static float madd1(float a, float b, float c) { return std::fma(a, b, c); }
+
+  static float hsum(V v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+  }
+};
+
+}
+
+const VecKernels avx2_vec_kernels = Kernels<Avx2>::kTable;
+
+}
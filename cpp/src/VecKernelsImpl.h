@@ -0,0 +1,149 @@
+#pragma once
+
+// Kernel bodies shared by every SimdLevel. Each translation unit that
+// includes this gets its own copy compiled for its own target flags, so the
+// templates live in an anonymous namespace.
+
+#include "VecKernels.h"
+
+namespace wickedwinch::protocol {
+namespace {
+
+// S provides a register type V of kWidth floats and the operations below.
+// The scalar tail of each kernel applies the same operations in the same
+// order, so results match the scalar table exactly except for norm2, which
+// sums in kWidth partial sums, and the Horner kernels, which round once per
+// step where S::madd is a fused multiply-add.
+template <typename S>
+struct Kernels {
+  using V = typename S::V;
+  static constexpr size_t kWidth = S::kWidth;
+
+  static void Add(float* a, const float* b, size_t n) {
+    size_t i = 0;
+    for (; i + kWidth <= n; i += kWidth) {
+      S::store(a + i, S::add(S::load(a + i), S::load(b + i)));
+    }
+    for (; i < n; ++i) a[i] += b[i];
+  }
+
+  static void Sub(float* a, const float* b, size_t n) {
+    size_t i = 0;
+    for (; i + kWidth <= n; i += kWidth) {
+      S::store(a + i, S::sub(S::load(a + i), S::load(b + i)));
+    }
+    for (; i < n; ++i) a[i] -= b[i];
+  }
+
+  static void Mul(float* a, const float* b, size_t n) {
+    size_t i = 0;
+    for (; i + kWidth <= n; i += kWidth) {
+      S::store(a + i, S::mul(S::load(a + i), S::load(b + i)));
+    }
+    for (; i < n; ++i) a[i] *= b[i];
+  }
+
+  static void MulAdd(float* a, const float* b, const float* c, size_t n) {
+    size_t i = 0;
+    for (; i + kWidth <= n; i += kWidth) {
+      V r = S::add(S::mul(S::load(a + i), S::load(b + i)), S::load(c + i));
+      S::store(a + i, r);
+    }
+    for (; i < n; ++i) a[i] = a[i] * b[i] + c[i];
+  }
+
+  static void Scale(float* out, float s, const float* v, size_t n) {
+    V vs = S::set1(s);
+    size_t i = 0;
+    for (; i + kWidth <= n; i += kWidth) {
+      S::store(out + i, S::mul(vs, S::load(v + i)));
+    }
+    for (; i < n; ++i) out[i] = s * v[i];
+  }
+
+  static void Axpy(float* y, float a, const float* x, size_t n) {
+    V va = S::set1(a);
+    size_t i = 0;
+    for (; i + kWidth <= n; i += kWidth) {
+      S::store(y + i, S::add(S::load(y + i), S::mul(va, S::load(x + i))));
+    }
+    for (; i < n; ++i) y[i] += a * x[i];
+  }
+
+  static void Neg(float* v, size_t n) {
+    size_t i = 0;
+    for (; i + kWidth <= n; i += kWidth) {
+      S::store(v + i, S::neg(S::load(v + i)));
+    }
+    for (; i < n; ++i) v[i] = -v[i];
+  }
+
+  static float Norm2(const float* v, size_t n) {
+    size_t i = 0;
+    float result = 0;
+    if (n >= kWidth) {
+      V sum = S::zero();
+      for (; i + kWidth <= n; i += kWidth) {
+        V x = S::load(v + i);
+        sum = S::add(sum, S::mul(x, x));
+      }
+      result = S::hsum(sum);
+    }
+    for (; i < n; ++i) result += v[i] * v[i];
+    return result;
+  }
+
+  static void Lerp(float* out, float t, const float* v0, const float* v1, size_t n) {
+    float u = 1 - t;
+    V vu = S::set1(u);
+    V vt = S::set1(t);
+    size_t i = 0;
+    for (; i + kWidth <= n; i += kWidth) {
+      V r = S::add(S::mul(vu, S::load(v0 + i)), S::mul(vt, S::load(v1 + i)));
+      S::store(out + i, r);
+    }
+    for (; i < n; ++i) out[i] = u*v0[i] + t*v1[i];
+  }
+
+  // Keeps each block of columns in a register across all rows.
+  static void Horner(float* acc, float t, const float* coeff, size_t rows, size_t cols) {
+    V vt = S::set1(t);
+    size_t j = 0;
+    for (; j + kWidth <= cols; j += kWidth) {
+      V r = S::load(acc + j);
+      for (size_t i = rows; i-- > 0;) r = S::madd(r, vt, S::load(coeff + i * cols + j));
+      S::store(acc + j, r);
+    }
+    // The remaining columns are independent chains; stepping them together
+    // lets their multiply-adds overlap.
+    if (j == cols) return;
+    for (size_t i = rows; i-- > 0;) {
+      const float* row = coeff + i * cols;
+      for (size_t k = j; k < cols; ++k) acc[k] = S::madd1(acc[k], t, row[k]);
+    }
+  }
+
+  static float Poly(const float* c, size_t n, float t) {
+    if (n == 0) return 0;
+    float r = c[n - 1];
+    for (size_t i = n - 1; i-- > 0;) r = S::madd1(r, t, c[i]);
+    return r;
+  }
+
+  static constexpr VecKernels kTable{
+    .add     = Add,
+    .sub     = Sub,
+    .mul     = Mul,
+    .mul_add = MulAdd,
+    .scale   = Scale,
+    .axpy    = Axpy,
+    .neg     = Neg,
+    .norm2   = Norm2,
+    .lerp    = Lerp,
+    .horner  = Horner,
+    .poly    = Poly,
+  };
+};
+
+}
+}
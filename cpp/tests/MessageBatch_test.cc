@@ -0,0 +1,122 @@
+#include <WickedWinchProtocol/MessageBatch.h>
+#include <WickedWinchProtocol/Message.h>
+
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::ElementsAreArray;
+
+namespace wickedwinch::protocol {
+namespace {
+
+std::vector<uint8_t> Path(size_t size, uint8_t seed) {
+  std::vector<uint8_t> path(size);
+  for (size_t i = 0; i < size; ++i) path[i] = seed + i;
+  return path;
+}
+
+TEST(MessageBatchTest, MatchesMessageWriter) {
+  std::vector<uint8_t> small = Path(20, 1);
+  std::vector<uint8_t> large = Path(1000, 2);
+  WickedPingRequest ping = {7};
+  auto ping_bytes = std::span(reinterpret_cast<const uint8_t*>(&ping), sizeof(ping));
+
+  MessageBatch batch;
+  ASSERT_TRUE(batch.AddWinchPath(1, WickedWinchMode_LinearVelocity, small));
+  ASSERT_TRUE(batch.AddDmxPath(2, large));
+  ASSERT_TRUE(batch.Add(3, WickedMessageType_PingRequest, ping_bytes));
+  ASSERT_TRUE(batch.Add(4, WickedMessageType_GetDmxTargetsRequest, {}));
+  ASSERT_TRUE(batch.AddWinchPath(5, WickedWinchMode_LinearPosition, large));
+
+  MessageWriter writer;
+  writer.WriteWinchPath(1, WickedWinchMode_LinearVelocity, small);
+  writer.WriteDmxPath(2, large);
+  writer.Write(3, ping);
+  writer.Write(4, WickedMessageType_GetDmxTargetsRequest);
+  writer.WriteWinchPath(5, WickedWinchMode_LinearPosition, large);
+
+  EXPECT_EQ(batch.message_size(), 5u);
+  EXPECT_EQ(batch.data_size(), writer.data().size());
+  std::vector<uint8_t> buffer;
+  batch.Gather(buffer);
+  EXPECT_THAT(buffer, ElementsAreArray(writer.data()));
+
+  // Copied bytes run together; large paths are referenced, not copied.
+  std::span<const iovec> iovecs = batch.iovecs();
+  ASSERT_EQ(iovecs.size(), 4u);
+  EXPECT_EQ(iovecs[1].iov_base, large.data());
+  EXPECT_EQ(iovecs[3].iov_base, large.data());
+  EXPECT_EQ(iovecs[2].iov_len, 4 + sizeof(ping) + 4 + 8);
+}
+
+TEST(MessageBatchTest, RejectsOversizedPayload) {
+  std::vector<uint8_t> path(0x10000 - 4);
+  MessageBatch batch;
+  EXPECT_FALSE(batch.AddDmxPath(0, path));
+  EXPECT_FALSE(batch.Add(0, WickedMessageType_SetDmxPath, std::vector<uint8_t>(0x10000)));
+  EXPECT_EQ(batch.message_size(), 0u);
+  path.pop_back();
+  EXPECT_TRUE(batch.AddDmxPath(0, path));
+}
+
+TEST(MessageBatchTest, FlushToSocket) {
+  // More referenced payloads than one writev takes, and more bytes than the
+  // socket buffers, so the batch is written in several partial writevs.
+  std::vector<std::vector<uint8_t>> paths;
+  for (size_t i = 0; i < 3000; ++i) paths.push_back(Path(200 + i % 300, i));
+  MessageBatch batch;
+  MessageWriter expected;
+  for (size_t i = 0; i < paths.size(); ++i) {
+    ASSERT_TRUE(batch.AddWinchPath(i, i % 3, paths[i]));
+    expected.WriteWinchPath(i, i % 3, paths[i]);
+  }
+
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  std::vector<uint8_t> received;
+  std::thread reader([&] {
+    uint8_t chunk[4096];
+    ssize_t size;
+    while ((size = read(fds[0], chunk, sizeof(chunk))) > 0) {
+      received.insert(received.end(), chunk, chunk + size);
+    }
+  });
+  EXPECT_TRUE(batch.Flush(fds[1]));
+  close(fds[1]);
+  reader.join();
+  close(fds[0]);
+
+  EXPECT_THAT(received, ElementsAreArray(expected.data()));
+}
+
+TEST(MessageBatchTest, FlushFailsOnClosedFd) {
+  std::vector<uint8_t> path = Path(300, 0);
+  MessageBatch batch;
+  batch.AddDmxPath(0, path);
+  EXPECT_FALSE(batch.Flush(-1));
+}
+
+TEST(MessageBatchTest, ClearKeepsWorking) {
+  std::vector<uint8_t> path = Path(300, 0);
+  MessageBatch batch;
+  batch.AddDmxPath(0, path);
+  batch.clear();
+  EXPECT_EQ(batch.data_size(), 0u);
+  EXPECT_TRUE(batch.iovecs().empty());
+  batch.AddDmxPath(1, path);
+
+  MessageWriter expected;
+  expected.WriteDmxPath(1, path);
+  std::vector<uint8_t> buffer;
+  batch.Gather(buffer);
+  EXPECT_THAT(buffer, ElementsAreArray(expected.data()));
+}
+
+}
+}
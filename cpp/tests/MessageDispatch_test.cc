@@ -0,0 +1,157 @@
+#include <WickedWinchProtocol/MessageDispatch.h>
+#include <WickedWinchProtocol/Message.h>
+
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+
+namespace wickedwinch::protocol {
+namespace {
+
+// Handles a few types and records the rest through the fallback.
+struct Recorder {
+  void operator()(MessageTag<WickedMessageType_PingRequest>, uint8_t target_id, const WickedPingRequest& ping) {
+    pings.push_back(ping.ping_id);
+    targets.push_back(target_id);
+  }
+  void operator()(MessageTag<WickedMessageType_NotifyWinchStatus>, uint8_t, const WickedWinchStatus& status) {
+    positions.push_back(status.position);
+    flags.push_back(status.flags);
+  }
+  void operator()(MessageTag<WickedMessageType_GetDmxTargetsResponse>, uint8_t, std::span<const uint8_t> list) {
+    dmx_targets.assign(list.begin(), list.end());
+  }
+  void operator()(MessageTag<WickedMessageType_SetDmxConfig>, uint8_t, const MessageDmxConfig& config) {
+    channel_offset = config.channel_offset;
+    channel_map.assign(config.channel_map.begin(), config.channel_map.end());
+  }
+  void operator()(MessageTag<WickedMessageType_SetWinchPath>, uint8_t, const MessageWinchPath& path) {
+    mode = path.mode;
+    path_data.assign(path.path_data.begin(), path.path_data.end());
+  }
+  void operator()(WickedMessageType type, uint8_t, std::span<const uint8_t> payload) {
+    others.push_back(type);
+    other_sizes.push_back(payload.size());
+  }
+
+  std::vector<uint32_t> pings;
+  std::vector<uint8_t> targets;
+  std::vector<uint32_t> positions;
+  std::vector<uint8_t> flags;
+  std::vector<uint8_t> dmx_targets;
+  uint8_t channel_offset = 0;
+  std::vector<uint8_t> channel_map;
+  uint8_t mode = 0;
+  std::vector<uint8_t> path_data;
+  std::vector<WickedMessageType> others;
+  std::vector<size_t> other_sizes;
+};
+
+// Dispatches every message in data, returning false if one is malformed.
+template <typename Handler>
+bool DispatchAll(std::span<const uint8_t> data, Handler& handler) {
+  while (!data.empty()) {
+    size_t size = DispatchMessage(data, handler);
+    if (size == 0) return false;
+    data = data.subspan(size);
+  }
+  return true;
+}
+
+TEST(MessageDispatchTest, DispatchesByType) {
+  std::vector<uint8_t> path = {1, 2, 3, 4, 5};
+  std::vector<uint8_t> dmx_targets = {4, 5};
+  std::vector<uint8_t> channel_map = {0, 2};
+  MessageWriter writer;
+  writer.Write(7, WickedPingRequest{11});
+  writer.Write(1, WickedWinchStatus{0, 300, WickedWinchStatusFlag_Limit1});
+  writer.Write(8, WickedPingRequest{12});
+  writer.WriteTargets(0, WickedMessageType_GetDmxTargetsResponse, dmx_targets);
+  writer.WriteDmxConfig(0, WickedMessageType_SetDmxConfig, 16, channel_map);
+  writer.WriteWinchPath(2, WickedWinchMode_LinearVelocity, path);
+  writer.Write(3, WickedBmpStatus{1, 2, 3});
+  writer.Write(3, WickedMessageType_GetWinchConfigRequest);
+
+  Recorder recorder;
+  ASSERT_TRUE(DispatchAll(writer.data(), recorder));
+  EXPECT_THAT(recorder.pings, ElementsAre(11, 12));
+  EXPECT_THAT(recorder.targets, ElementsAre(7, 8));
+  EXPECT_THAT(recorder.positions, ElementsAre(300));
+  EXPECT_THAT(recorder.flags, ElementsAre(WickedWinchStatusFlag_Limit1));
+  EXPECT_THAT(recorder.dmx_targets, ElementsAreArray(dmx_targets));
+  EXPECT_EQ(recorder.channel_offset, 16);
+  EXPECT_THAT(recorder.channel_map, ElementsAreArray(channel_map));
+  EXPECT_EQ(recorder.mode, WickedWinchMode_LinearVelocity);
+  EXPECT_THAT(recorder.path_data, ElementsAreArray(path));
+  EXPECT_THAT(recorder.others, ElementsAre(WickedMessageType_NotifyBmpStatus, WickedMessageType_GetWinchConfigRequest));
+  EXPECT_THAT(recorder.other_sizes, ElementsAre(sizeof(WickedBmpStatus), 0));
+}
+
+TEST(MessageDispatchTest, UnknownTypeGoesToFallback) {
+  std::vector<uint8_t> buffer = {9, 100, 2, 0, 1, 2};
+  Recorder recorder;
+  EXPECT_EQ(DispatchMessage(buffer, recorder), buffer.size());
+  EXPECT_THAT(recorder.others, ElementsAre(WickedMessageType(100)));
+  EXPECT_THAT(recorder.other_sizes, ElementsAre(2));
+}
+
+TEST(MessageDispatchTest, UnhandledTypesAreSkipped) {
+  int pings = 0;
+  auto handler = [&](MessageTag<WickedMessageType_PingRequest>, uint8_t, const WickedPingRequest&) { ++pings; };
+  MessageWriter writer;
+  writer.Write(0, WickedBmpStatus{1, 2, 3});
+  writer.Write(0, WickedPingRequest{1});
+  std::vector<uint8_t> unknown = {0, 200, 0, 0};
+  std::vector<uint8_t> buffer(writer.data().begin(), writer.data().end());
+  buffer.insert(buffer.end(), unknown.begin(), unknown.end());
+
+  EXPECT_TRUE(DispatchAll(buffer, handler));
+  EXPECT_EQ(pings, 1);
+}
+
+TEST(MessageDispatchTest, RejectsShortPayloads) {
+  Recorder recorder;
+  // Truncated header and payload.
+  std::vector<uint8_t> ping = {0, WickedMessageType_PingRequest, 4, 0, 1, 0, 0, 0};
+  for (size_t size = 0; size < ping.size(); ++size) {
+    EXPECT_EQ(DispatchMessage(std::span(ping).first(size), recorder), 0u) << "size = " << size;
+  }
+  // A payload shorter than the type's struct.
+  std::vector<uint8_t> status = {0, WickedMessageType_NotifyWinchStatus, 8, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  EXPECT_EQ(DispatchMessage(status, recorder), 0u);
+  // Trailing arrays longer than the payload.
+  std::vector<uint8_t> targets = {0, WickedMessageType_GetWinchTargetsResponse, 2, 0, 2, 1};
+  EXPECT_EQ(DispatchMessage(targets, recorder), 0u);
+  std::vector<uint8_t> config = {0, WickedMessageType_SetDmxConfig, 3, 0, 0, 2, 1};
+  EXPECT_EQ(DispatchMessage(config, recorder), 0u);
+  std::vector<uint8_t> path = {0, WickedMessageType_SetWinchPath, 5, 0, 0, 0, 2, 0, 1};
+  EXPECT_EQ(DispatchMessage(path, recorder), 0u);
+  std::vector<uint8_t> dmx_path = {0, WickedMessageType_SetDmxPath, 3, 0, 0, 0, 0};
+  EXPECT_EQ(DispatchMessage(dmx_path, recorder), 0u);
+
+  EXPECT_TRUE(recorder.pings.empty());
+  EXPECT_TRUE(recorder.positions.empty());
+  EXPECT_TRUE(recorder.others.empty());
+}
+
+TEST(MessageDispatchTest, MinSizes) {
+  EXPECT_EQ(MessagePayloadMinSize(WickedMessageType_None), 0u);
+  EXPECT_EQ(MessagePayloadMinSize(WickedMessageType_PingRequest), 4u);
+  EXPECT_EQ(MessagePayloadMinSize(WickedMessageType_PingResponse), 8u);
+  EXPECT_EQ(MessagePayloadMinSize(WickedMessageType_NotifyBmpStatus), 12u);
+  EXPECT_EQ(MessagePayloadMinSize(WickedMessageType_NotifyWinchStatus), 9u);
+  EXPECT_EQ(MessagePayloadMinSize(WickedMessageType_GetWinchTargetsRequest), 0u);
+  EXPECT_EQ(MessagePayloadMinSize(WickedMessageType_GetWinchTargetsResponse), 1u);
+  EXPECT_EQ(MessagePayloadMinSize(WickedMessageType_SetWinchConfig), 8u);
+  EXPECT_EQ(MessagePayloadMinSize(WickedMessageType_SetWinchPath), 4u);
+  EXPECT_EQ(MessagePayloadMinSize(WickedMessageType_SetDmxConfig), 2u);
+  EXPECT_EQ(MessagePayloadMinSize(WickedMessageType_SetDmxPath), 4u);
+  EXPECT_EQ(MessagePayloadMinSize(WickedMessageType(17)), 0u);
+}
+
+}
+}
@@ -0,0 +1,177 @@
+#include <WickedWinchProtocol/MessageFramer.h>
+#include <WickedWinchProtocol/Message.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::ElementsAreArray;
+using ::testing::IsEmpty;
+
+namespace wickedwinch::protocol {
+namespace {
+
+// A stream of status messages with a large path message every so often.
+MessageWriter MakeStream(size_t messages, std::mt19937& rng) {
+  MessageWriter writer;
+  for (size_t i = 0; i < messages; ++i) {
+    switch (rng() % 4) {
+    case 0:
+      writer.Write(i, WickedWinchStatus{uint32_t(i), uint32_t(i), 0});
+      break;
+    case 1:
+      writer.Write(i, WickedPingRequest{uint32_t(i)});
+      break;
+    case 2:
+      writer.Write(i, WickedMessageType_GetDmxConfigRequest);
+      break;
+    case 3: {
+      std::vector<uint8_t> path(rng() % 8 == 0 ? 40000 + rng() % 20000 : rng() % 64);
+      for (size_t b = 0; b < path.size(); ++b) path[b] = b * 7 + i;
+      writer.WriteDmxPath(i, path);
+      break;
+    }
+    }
+  }
+  return writer;
+}
+
+// Splits the stream into messages with MessageReader, for comparison.
+std::vector<std::vector<uint8_t>> SplitStream(std::span<const uint8_t> data) {
+  std::vector<std::vector<uint8_t>> messages;
+  MessageReader reader;
+  while (reader.Read(data)) {
+    messages.emplace_back(data.begin(), data.begin() + reader.data_size());
+    data = data.subspan(reader.data_size());
+  }
+  return messages;
+}
+
+TEST(MessageFramerTest, Capacity) {
+  EXPECT_EQ(MessageFramer().capacity(), 0x20000u);
+  EXPECT_EQ(MessageFramer(0x30000).capacity(), 0x40000u);
+}
+
+TEST(MessageFramerTest, WholeMessages) {
+  MessageWriter writer;
+  writer.Write(1, WickedPingRequest{5});
+  writer.Write(2, WickedWinchStatus{1, 2, 3});
+
+  MessageFramer framer;
+  EXPECT_THAT(framer.Next(), IsEmpty());
+  EXPECT_EQ(framer.Push(writer.data()), writer.data().size());
+  EXPECT_THAT(framer.Next(), ElementsAreArray(writer.data().first(8)));
+  EXPECT_THAT(framer.Next(), ElementsAreArray(writer.data().subspan(8)));
+  EXPECT_THAT(framer.Next(), IsEmpty());
+  EXPECT_EQ(framer.size(), 0u);
+}
+
+TEST(MessageFramerTest, PartialHeaderAndPayload) {
+  MessageWriter writer;
+  writer.Write(1, WickedBmpStatus{1, 2, 3});
+  std::span<const uint8_t> data = writer.data();
+
+  MessageFramer framer;
+  for (size_t i = 0; i + 1 < data.size(); ++i) {
+    framer.Push(data.subspan(i, 1));
+    EXPECT_THAT(framer.Next(), IsEmpty()) << "i = " << i;
+  }
+  framer.Push(data.last(1));
+  EXPECT_THAT(framer.Next(), ElementsAreArray(data));
+}
+
+TEST(MessageFramerTest, RandomSplits) {
+  std::mt19937 rng(1);
+  MessageWriter writer = MakeStream(2000, rng);
+  std::vector<std::vector<uint8_t>> expected = SplitStream(writer.data());
+
+  // Many passes around the ring, so messages and headers wrap at every
+  // offset the chunking produces.
+  MessageFramer framer;
+  std::span<const uint8_t> data = writer.data();
+  size_t next = 0;
+  while (!data.empty()) {
+    size_t chunk = std::min<size_t>(data.size(), rng() % 2 ? rng() % 16 : rng() % 20000);
+    size_t pushed = framer.Push(data.first(chunk));
+    data = data.subspan(pushed);
+    for (std::span<const uint8_t> message = framer.Next(); !message.empty(); message = framer.Next()) {
+      ASSERT_LT(next, expected.size());
+      ASSERT_THAT(message, ElementsAreArray(expected[next])) << "message " << next;
+      ++next;
+    }
+  }
+  EXPECT_EQ(next, expected.size());
+  EXPECT_EQ(framer.size(), 0u);
+}
+
+TEST(MessageFramerTest, WriteSpan) {
+  std::mt19937 rng(2);
+  MessageWriter writer = MakeStream(500, rng);
+  std::vector<std::vector<uint8_t>> expected = SplitStream(writer.data());
+
+  MessageFramer framer;
+  std::span<const uint8_t> data = writer.data();
+  size_t next = 0;
+  while (!data.empty()) {
+    // Receive as a read(2) into the ring would.
+    std::span<uint8_t> space = framer.write_span();
+    size_t size = std::min({space.size(), data.size(), size_t(rng() % 30000)});
+    std::copy_n(data.begin(), size, space.begin());
+    framer.Commit(size);
+    data = data.subspan(size);
+    for (std::span<const uint8_t> message = framer.Next(); !message.empty(); message = framer.Next()) {
+      ASSERT_THAT(message, ElementsAreArray(expected[next])) << "message " << next;
+      ++next;
+    }
+  }
+  EXPECT_EQ(next, expected.size());
+}
+
+TEST(MessageFramerTest, FullRing) {
+  MessageFramer framer;
+  std::vector<uint8_t> path(UINT16_MAX - 4);
+  MessageWriter writer;
+  ASSERT_TRUE(writer.WriteDmxPath(0, path));
+  ASSERT_TRUE(writer.WriteDmxPath(1, path));
+  ASSERT_TRUE(writer.WriteDmxPath(2, path));
+  std::span<const uint8_t> data = writer.data();
+
+  // The ring fills before the second of the largest messages is complete.
+  size_t pushed = framer.Push(data);
+  EXPECT_EQ(pushed, framer.capacity());
+  EXPECT_TRUE(framer.write_span().empty());
+  EXPECT_EQ(framer.Next().size(), MessageFramer::kMaxMessageSize);
+  data = data.subspan(pushed);
+
+  // Taking the first frees room for the rest of the second, which wraps.
+  pushed = framer.Push(data);
+  EXPECT_EQ(pushed, MessageFramer::kMaxMessageSize);
+  data = data.subspan(pushed);
+  std::span<const uint8_t> second = framer.Next();
+  ASSERT_EQ(second.size(), MessageFramer::kMaxMessageSize);
+  EXPECT_EQ(second[0], 1);
+  EXPECT_THAT(framer.Next(), IsEmpty());
+
+  EXPECT_EQ(framer.Push(data), data.size());
+  std::span<const uint8_t> third = framer.Next();
+  ASSERT_EQ(third.size(), MessageFramer::kMaxMessageSize);
+  EXPECT_EQ(third[0], 2);
+  EXPECT_THAT(framer.Next(), IsEmpty());
+}
+
+TEST(MessageFramerTest, Clear) {
+  MessageWriter writer;
+  writer.Write(1, WickedPingRequest{5});
+  MessageFramer framer;
+  framer.Push(writer.data().first(5));
+  framer.clear();
+  EXPECT_EQ(framer.size(), 0u);
+  framer.Push(writer.data());
+  EXPECT_THAT(framer.Next(), ElementsAreArray(writer.data()));
+}
+
+}
+}
@@ -0,0 +1,259 @@
+#include <WickedWinchProtocol/Message.h>
+#include <WickedWinchProtocol/Path.h>
+#include <WickedWinchProtocol/PathBuilder.h>
+
+#include <cstdint>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::IsEmpty;
+
+namespace wickedwinch::protocol {
+namespace {
+
+std::vector<uint8_t> Bytes(std::span<const uint8_t> data) {
+  return {data.begin(), data.end()};
+}
+
+TEST(MessageTest, PingRoundTrip) {
+  MessageWriter writer;
+  ASSERT_TRUE(writer.Write(3, WickedPingRequest{0x12345678}));
+  ASSERT_TRUE(writer.Write(4, WickedPingResponse{7, 9}));
+  EXPECT_THAT(writer.data(), ElementsAre(
+      3, WickedMessageType_PingRequest, 4, 0, 0x78, 0x56, 0x34, 0x12,
+      4, WickedMessageType_PingResponse, 8, 0, 7, 0, 0, 0, 9, 0, 0, 0));
+
+  MessageReader reader;
+  ASSERT_TRUE(reader.Read(writer.data()));
+  EXPECT_EQ(reader.target_id(), 3);
+  EXPECT_EQ(reader.payload_type(), WickedMessageType_PingRequest);
+  EXPECT_EQ(reader.ping_request().ping_id, 0x12345678u);
+  EXPECT_EQ(reader.data_size(), 8u);
+
+  ASSERT_TRUE(reader.Read(writer.data().subspan(reader.data_size())));
+  EXPECT_EQ(reader.target_id(), 4);
+  EXPECT_EQ(reader.ping_response().ping_id, 7u);
+  EXPECT_EQ(reader.ping_response().device_time, 9u);
+}
+
+TEST(MessageTest, WinchStatusIsPacked) {
+  // The Go encoder writes no trailing padding, so the next message starts
+  // unaligned.
+  MessageWriter writer;
+  ASSERT_TRUE(writer.Write(1, WickedWinchStatus{100, 200, WickedWinchStatusFlag_PositionKnown}));
+  ASSERT_TRUE(writer.Write(2, WickedBmpStatus{5, 21.5f, 101325.0f}));
+  EXPECT_THAT(Bytes(writer.data().first(13)), ElementsAre(
+      1, WickedMessageType_NotifyWinchStatus, 9, 0, 100, 0, 0, 0, 200, 0, 0, 0, 1));
+
+  MessageReader reader;
+  ASSERT_TRUE(reader.Read(writer.data()));
+  WickedWinchStatus status = reader.winch_status();
+  EXPECT_EQ(status.device_time, 100u);
+  EXPECT_EQ(status.position, 200u);
+  EXPECT_EQ(status.flags, WickedWinchStatusFlag_PositionKnown);
+
+  ASSERT_TRUE(reader.Read(writer.data().subspan(reader.data_size())));
+  WickedBmpStatus bmp = reader.bmp_status();
+  EXPECT_EQ(bmp.device_time, 5u);
+  EXPECT_EQ(bmp.celsius, 21.5f);
+  EXPECT_EQ(bmp.pascals, 101325.0f);
+}
+
+TEST(MessageTest, WinchConfig) {
+  MessageWriter writer;
+  EXPECT_FALSE(writer.Write(1, WickedMessageType_SetDmxConfig, WickedWinchConfig{200, 4096, 0.1f}));
+  EXPECT_THAT(writer.data(), IsEmpty());
+  ASSERT_TRUE(writer.Write(1, WickedMessageType_SetWinchConfig, WickedWinchConfig{200, 4096, 0.1f}));
+
+  MessageReader reader;
+  ASSERT_TRUE(reader.Read(writer.data()));
+  EXPECT_EQ(reader.payload_size(), 8);
+  WickedWinchConfig config = reader.winch_config();
+  EXPECT_EQ(config.steps_per_rev, 200);
+  EXPECT_EQ(config.ticks_per_rev, 4096);
+  EXPECT_EQ(config.distance_per_rev, 0.1f);
+}
+
+TEST(MessageTest, NoPayload) {
+  MessageWriter writer;
+  ASSERT_TRUE(writer.Write(5, WickedMessageType_GetWinchConfigRequest));
+  EXPECT_FALSE(writer.Write(5, WickedMessageType_PingRequest));
+  EXPECT_THAT(writer.data(), ElementsAre(5, WickedMessageType_GetWinchConfigRequest, 0, 0));
+
+  MessageReader reader;
+  ASSERT_TRUE(reader.Read(writer.data()));
+  EXPECT_THAT(reader.payload(), IsEmpty());
+}
+
+TEST(MessageTest, Targets) {
+  MessageWriter writer;
+  std::vector<uint8_t> targets = {1, 2, 7};
+  ASSERT_TRUE(writer.WriteTargets(0, WickedMessageType_GetDmxTargetsResponse, targets));
+  EXPECT_FALSE(writer.WriteTargets(0, WickedMessageType_SetDmxPath, targets));
+  EXPECT_FALSE(writer.WriteTargets(0, WickedMessageType_GetDmxTargetsResponse, std::vector<uint8_t>(256)));
+  EXPECT_THAT(writer.data(), ElementsAre(0, WickedMessageType_GetDmxTargetsResponse, 4, 0, 3, 1, 2, 7));
+
+  MessageReader reader;
+  ASSERT_TRUE(reader.Read(writer.data()));
+  EXPECT_THAT(reader.targets(), ElementsAreArray(targets));
+  EXPECT_EQ(reader.targets().data(), writer.data().data() + 5);
+}
+
+TEST(MessageTest, DmxConfig) {
+  MessageWriter writer;
+  std::vector<uint8_t> channel_map = {0, 3, 1};
+  ASSERT_TRUE(writer.WriteDmxConfig(2, WickedMessageType_SetDmxConfig, 10, channel_map));
+  EXPECT_THAT(writer.data(), ElementsAre(2, WickedMessageType_SetDmxConfig, 5, 0, 10, 3, 0, 3, 1));
+
+  MessageReader reader;
+  ASSERT_TRUE(reader.Read(writer.data()));
+  EXPECT_EQ(reader.dmx_channel_offset(), 10);
+  EXPECT_THAT(reader.dmx_channel_map(), ElementsAreArray(channel_map));
+}
+
+TEST(MessageTest, WrongTypeAccessorsAreEmpty) {
+  MessageWriter writer;
+  ASSERT_TRUE(writer.Write(1, WickedPingRequest{42}));
+  MessageReader reader;
+  ASSERT_TRUE(reader.Read(writer.data()));
+  EXPECT_EQ(reader.ping_response().ping_id, 0u);
+  EXPECT_EQ(reader.winch_config().steps_per_rev, 0);
+  EXPECT_THAT(reader.targets(), IsEmpty());
+  EXPECT_THAT(reader.dmx_channel_map(), IsEmpty());
+  EXPECT_THAT(reader.path_data(), IsEmpty());
+
+  // A default reader holds an empty message.
+  MessageReader empty;
+  EXPECT_EQ(empty.payload_type(), WickedMessageType_None);
+  EXPECT_THAT(empty.payload(), IsEmpty());
+}
+
+TEST(MessageTest, RejectsTruncated) {
+  MessageWriter writer;
+  ASSERT_TRUE(writer.Write(1, WickedBmpStatus{1, 2, 3}));
+  std::vector<uint8_t> buffer = Bytes(writer.data());
+
+  MessageReader reader;
+  for (size_t size = 0; size < buffer.size(); ++size) {
+    EXPECT_FALSE(reader.Read(buffer.data(), size)) << "size = " << size;
+  }
+  EXPECT_TRUE(reader.Read(buffer));
+
+  // A payload shorter than its type's fixed part.
+  buffer[2] = 11;
+  EXPECT_FALSE(reader.Read(buffer));
+}
+
+TEST(MessageTest, RejectsTrailingArrayBeyondPayload) {
+  MessageReader reader;
+  std::vector<uint8_t> targets = {0, WickedMessageType_GetWinchTargetsResponse, 3, 0, 3, 1, 2, 0xff};
+  EXPECT_FALSE(reader.Read(targets));
+  targets[2] = 4;
+  EXPECT_TRUE(reader.Read(targets));
+
+  std::vector<uint8_t> dmx = {0, WickedMessageType_GetDmxConfigResponse, 3, 0, 0, 2, 1, 0xff};
+  EXPECT_FALSE(reader.Read(dmx));
+
+  std::vector<uint8_t> path = {0, WickedMessageType_SetDmxPath, 4, 0, 0, 0, 1, 0};
+  EXPECT_FALSE(reader.Read(path));
+}
+
+TEST(MessageTest, UnknownTypeIsOpaque) {
+  std::vector<uint8_t> buffer = {9, 200, 3, 0, 1, 2, 3};
+  MessageReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  EXPECT_EQ(reader.payload_type(), WickedMessageType(200));
+  EXPECT_THAT(reader.payload(), ElementsAre(1, 2, 3));
+}
+
+TEST(MessageTest, PathHandoff) {
+  PathBuilder builder;
+  builder.BeginSegment(0);
+  builder.Push({1, 2});
+  builder.BeginSegment(1000);
+  builder.Push({3, 4});
+  std::vector<uint8_t> path = builder.Write();
+
+  MessageWriter writer;
+  ASSERT_TRUE(writer.WriteWinchPath(1, WickedWinchMode_LinearPosition, path));
+  size_t first_size = writer.data().size();
+  ASSERT_TRUE(writer.WriteWinchPath(1, WickedWinchMode_LinearPosition, builder));
+  ASSERT_TRUE(writer.WriteDmxPath(2, builder));
+  EXPECT_THAT(Bytes(writer.data().first(4)), ElementsAre(1, WickedMessageType_SetWinchPath, 4 + path.size(), 0));
+
+  MessageReader reader;
+  std::span<const uint8_t> data = writer.data();
+  ASSERT_TRUE(reader.Read(data));
+  EXPECT_EQ(reader.data_size(), first_size);
+  EXPECT_EQ(reader.winch_mode(), WickedWinchMode_LinearPosition);
+  EXPECT_THAT(reader.path_data(), ElementsAreArray(path));
+
+  // The builder serializes into the message the same bytes.
+  data = data.subspan(reader.data_size());
+  ASSERT_TRUE(reader.Read(data));
+  EXPECT_THAT(reader.path_data(), ElementsAreArray(path));
+
+  data = data.subspan(reader.data_size());
+  ASSERT_TRUE(reader.Read(data));
+  EXPECT_EQ(reader.payload_type(), WickedMessageType_SetDmxPath);
+  EXPECT_EQ(reader.winch_mode(), 0);
+  EXPECT_EQ(reader.data_size(), data.size());
+
+  EXPECT_EQ(reader.path_data().data(), data.data() + 8);
+  std::vector<uint8_t> copy;
+  reader.CopyPathData(copy);
+  PathReader path_reader;
+  ASSERT_TRUE(path_reader.Read(copy));
+  EXPECT_EQ(path_reader.segment_header_size(), 2u);
+  EXPECT_EQ(path_reader.SegmentAt(1500), 1u);
+}
+
+TEST(MessageTest, UnalignedPath) {
+  PathBuilder builder;
+  builder.BeginSegment(1000);
+  builder.BeginSegment(2000);
+  std::vector<uint8_t> path(builder.data_size());
+  ASSERT_TRUE(builder.Write(path.data(), path.size()));
+
+  // A winch status's 9-byte payload leaves the next message at an odd offset.
+  MessageWriter writer;
+  ASSERT_TRUE(writer.Write(0, WickedWinchStatus{1, 2, 0}));
+  ASSERT_TRUE(writer.WriteDmxPath(1, builder));
+  MessageReader reader;
+  std::span<const uint8_t> data = writer.data();
+  ASSERT_TRUE(reader.Read(data));
+  ASSERT_TRUE(reader.Read(data.subspan(reader.data_size())));
+  EXPECT_NE(reinterpret_cast<uintptr_t>(reader.path_data().data()) % alignof(PathSegmentHeader), 0u);
+  EXPECT_THAT(reader.path_data(), ElementsAreArray(path));
+
+  std::vector<uint8_t> copy;
+  reader.CopyPathData(copy);
+  EXPECT_THAT(copy, ElementsAreArray(path));
+  PathReader path_reader;
+  ASSERT_TRUE(path_reader.Read(copy));
+  EXPECT_EQ(path_reader.segment_header_size(), 2u);
+  EXPECT_EQ(path_reader.SegmentAt(1500), 0u);
+  EXPECT_EQ(path_reader.SegmentAt(2500), 1u);
+}
+
+TEST(MessageTest, PathTooLarge) {
+  MessageWriter writer;
+  std::vector<uint8_t> path(0x10000 - 4);
+  EXPECT_FALSE(writer.WriteDmxPath(0, path));
+  path.pop_back();
+  EXPECT_TRUE(writer.WriteDmxPath(0, path));
+
+  // A path builder too large for the message leaves the buffer unchanged.
+  PathBuilder builder;
+  for (uint32_t s = 0; s < 6000; ++s) builder.BeginSegment(s);
+  writer.clear();
+  EXPECT_FALSE(writer.WriteWinchPath(0, 0, builder));
+  EXPECT_THAT(writer.data(), IsEmpty());
+}
+
+}
+}
@@ -0,0 +1,176 @@
+#include <WickedWinchProtocol/PathBuilder.h>
+#include <WickedWinchProtocol/Path.h>
+#include <WickedWinchProtocol/Postfix.h>
+
+#include "PathTestUtil.h"
+
+#include <cstdlib>
+#include <new>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::ElementsAreArray;
+
+// Counts heap allocations made while counting is enabled.
+static bool counting = false;
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+  if (counting) ++allocations;
+  if (void* p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace wickedwinch::protocol {
+namespace {
+
+struct CountAllocations {
+  CountAllocations() { allocations = 0; counting = true; }
+  ~CountAllocations() { counting = false; }
+};
+
+// Segment s of a test path: a push of s + 1 values, summed, and for odd s a
+// lerp whose int stream leaves the float pool needing alignment.
+template <typename Expr>
+void AddExpr(Expr& expr, size_t s) {
+  expr.add_op(PostfixOp::Push);
+  expr.add_i(s % 4 + 1);
+  for (size_t i = 0; i <= s % 4; ++i) expr.add_f(float(s) + i);
+  if (s % 2) {
+    expr.add_op(PostfixOp::Lerp);
+    expr.add_i(1 << 2 | 2);
+    for (float v : {0.0f, 1.0f, 2.0f, 3.0f}) expr.add_f(v);
+  }
+}
+
+std::vector<uint8_t> WriterPath(const std::vector<uint32_t>& start_times) {
+  return WritePath(start_times, [](PostfixWriter& expr, size_t s) { AddExpr(expr, s); });
+}
+
+void Build(PathBuilder& builder, const std::vector<uint32_t>& start_times) {
+  for (size_t s = 0; s < start_times.size(); ++s) {
+    builder.BeginSegment(start_times[s]);
+    AddExpr(builder, s);
+  }
+}
+
+TEST(PathBuilderTest, MatchesPathWriter) {
+  std::vector<uint32_t> start_times = {0, 100, 250, 1000, 1001};
+  PathBuilder builder;
+  Build(builder, start_times);
+  EXPECT_EQ(builder.segment_size(), start_times.size());
+
+  std::vector<uint8_t> expected = WriterPath(start_times);
+  std::vector<uint8_t> buffer = builder.Write();
+  EXPECT_EQ(builder.data_size(), expected.size());
+  EXPECT_THAT(buffer, ElementsAreArray(expected));
+
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  EXPECT_EQ(reader.flags(), 0);
+  EXPECT_EQ(reader.SegmentAt(300), 2);
+}
+
+TEST(PathBuilderTest, SetsOverflow) {
+  std::vector<uint32_t> start_times = {0xfffffff0, 0xfffffff8, 4, 12};
+  PathBuilder builder;
+  Build(builder, start_times);
+
+  std::vector<uint8_t> buffer = builder.Write();
+  EXPECT_THAT(buffer, ElementsAreArray(WriterPath(start_times)));
+
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  EXPECT_EQ(reader.flags(), PathHeader::Overflow);
+}
+
+TEST(PathBuilderTest, Empty) {
+  PathBuilder builder;
+  std::vector<uint8_t> buffer = builder.Write();
+  EXPECT_THAT(buffer, ElementsAreArray(WriterPath({})));
+}
+
+TEST(PathBuilderTest, EmptySegment) {
+  PathBuilder builder;
+  builder.BeginSegment(0);
+  builder.BeginSegment(10);
+  builder.Push({1, 2});
+  builder.Pop(1);
+
+  PathWriter writer;
+  writer.add_segments()->start_time = 0;
+  PathSegmentWriter* segment = writer.add_segments();
+  segment->start_time = 10;
+  segment->expr.Push({1, 2});
+  segment->expr.Pop(1);
+
+  EXPECT_THAT(builder.Write(), ElementsAreArray(writer.Write()));
+}
+
+TEST(PathBuilderTest, WriteFailsWhenTooSmall) {
+  PathBuilder builder;
+  Build(builder, {0, 10});
+  std::vector<uint8_t> buffer(builder.data_size() - 1);
+  EXPECT_FALSE(builder.Write(buffer.data(), buffer.size()));
+}
+
+TEST(PathBuilderTest, LargeFormat) {
+  // More than 64 KiB of segments no longer fits the small format.
+  std::vector<uint32_t> start_times;
+  for (uint32_t s = 0; s < 4000; ++s) start_times.push_back(s * 10);
+  PathBuilder builder;
+  Build(builder, start_times);
+
+  std::vector<uint8_t> buffer = builder.Write();
+  EXPECT_THAT(buffer, ElementsAreArray(WriterPath(start_times)));
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  EXPECT_TRUE(reader.large());
+  EXPECT_EQ(reader.segment_header_size(), start_times.size());
+  EXPECT_EQ(reader.SegmentAt(39995), 3999);
+}
+
+TEST(PathBuilderTest, WriteFailsBeyondExprLimits) {
+  std::vector<uint8_t> buffer;
+  PathBuilder too_many_ops;
+  too_many_ops.BeginSegment(0);
+  for (size_t i = 0; i < 256; ++i) too_many_ops.add_op(PostfixOp::Add);
+  EXPECT_FALSE(too_many_ops.Write(buffer));
+
+  PathBuilder too_many_ints;
+  too_many_ints.BeginSegment(0);
+  for (size_t i = 0; i < 256; ++i) too_many_ints.add_i(0);
+  EXPECT_FALSE(too_many_ints.Write(buffer));
+
+  PathBuilder too_many_floats;
+  too_many_floats.BeginSegment(0);
+  for (size_t i = 0; i < 0x10000; ++i) too_many_floats.add_f(0);
+  EXPECT_FALSE(too_many_floats.Write(buffer));
+}
+
+TEST(PathBuilderTest, ResetKeepsCapacity) {
+  std::vector<uint32_t> start_times;
+  for (uint32_t s = 0; s < 64; ++s) start_times.push_back(s * 10);
+
+  PathBuilder builder;
+  std::vector<uint8_t> buffer;
+  Build(builder, start_times);
+  ASSERT_TRUE(builder.Write(buffer));
+
+  {
+    CountAllocations count;
+    builder.reset();
+    EXPECT_EQ(builder.segment_size(), 0u);
+    Build(builder, start_times);
+    ASSERT_TRUE(builder.Write(buffer));
+    EXPECT_EQ(allocations, 0u);
+  }
+  EXPECT_THAT(buffer, ElementsAreArray(WriterPath(start_times)));
+}
+
+}
+}
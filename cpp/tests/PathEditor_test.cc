@@ -0,0 +1,235 @@
+#include <WickedWinchProtocol/PathEditor.h>
+#include <WickedWinchProtocol/Path.h>
+#include <WickedWinchProtocol/Postfix.h>
+
+#include "PathTestUtil.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::ElementsAreArray;
+
+namespace wickedwinch::protocol {
+namespace {
+
+// An expression pushing value, padded with s % 3 extra ints so expression
+// sizes vary.
+PostfixWriter Expr(float value, size_t s = 0) {
+  PostfixWriter expr;
+  expr.Push({value});
+  for (size_t i = 0; i < s % 3; ++i) {
+    expr.add_op(PostfixOp::Dup);
+    expr.add_i(0);
+    expr.Pop(1);
+  }
+  return expr;
+}
+
+std::vector<uint8_t> WriterPath(const std::vector<uint32_t>& start_times) {
+  return WritePath(start_times, [](PostfixWriter& expr, size_t s) { expr = Expr(s, s); });
+}
+
+float EvalAt(const PathReader& reader, uint32_t t) {
+  float data[8];
+  PostfixStack stack{.stack_data = data, .stack_size = 0, .stack_capacity = 8};
+  if (reader.Eval(t, stack) != EvalStatus::Ok) return -1;
+  return stack.stack_data[stack.stack_size - 1];
+}
+
+// Checks that the edited path reads back with the given segment start times
+// and the values Expr(first + i) gives segment i.
+void ExpectSegments(PathEditor& editor, const std::vector<uint32_t>& start_times, size_t first) {
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(editor.data()));
+  ASSERT_EQ(reader.segment_header_size(), start_times.size());
+  for (size_t i = 0; i < start_times.size(); ++i) {
+    EXPECT_EQ(reader.segment_header(i).start_time, start_times[i]);
+    EXPECT_EQ(EvalAt(reader, start_times[i]), float(first + i));
+  }
+}
+
+TEST(PathEditorTest, Empty) {
+  PathEditor editor;
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(editor.data()));
+  EXPECT_EQ(reader.segment_header_size(), 0);
+}
+
+TEST(PathEditorTest, AppendMatchesWriter) {
+  std::vector<uint32_t> start_times;
+  PathEditor editor;
+  for (uint32_t s = 0; s < 100; ++s) {
+    start_times.push_back(s * 10);
+    ASSERT_TRUE(editor.Append(s * 10, Expr(s, s)));
+    ExpectSegments(editor, start_times, 0);
+  }
+
+  PathReader expected;
+  std::vector<uint8_t> buffer = WriterPath(start_times);
+  ASSERT_TRUE(expected.Read(buffer));
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(editor.data()));
+  for (uint8_t i = 0; i < start_times.size(); ++i) {
+    EXPECT_THAT(reader.segment_data(i), ElementsAreArray(expected.segment_data(i)));
+  }
+  EXPECT_EQ(reader.flags(), 0);
+}
+
+TEST(PathEditorTest, AppendSerializedExpr) {
+  PathEditor editor;
+  std::vector<uint8_t> expr = Expr(7).Write();
+  ASSERT_TRUE(editor.Append(5, expr));
+  ExpectSegments(editor, {5}, 7);
+
+  expr.resize(2);
+  EXPECT_FALSE(editor.Append(10, expr));
+  ExpectSegments(editor, {5}, 7);
+}
+
+TEST(PathEditorTest, LoadAndAppendPath) {
+  PathEditor editor;
+  ASSERT_TRUE(editor.Load(WriterPath({0, 10, 20})));
+  ExpectSegments(editor, {0, 10, 20}, 0);
+
+  // An update whose segments evaluate to 0 and 1, appended as segments 3
+  // and 4.
+  ASSERT_TRUE(editor.Append(WriterPath({30, 40})));
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(editor.data()));
+  ASSERT_EQ(reader.segment_header_size(), 5);
+  EXPECT_EQ(EvalAt(reader, 25), 2);
+  EXPECT_EQ(EvalAt(reader, 35), 0);
+  EXPECT_EQ(EvalAt(reader, 45), 1);
+
+  std::vector<uint8_t> invalid = WriterPath({50});
+  invalid.resize(invalid.size() - 1);
+  EXPECT_FALSE(editor.Append(invalid));
+  EXPECT_EQ(editor.segment_size(), 5);
+  EXPECT_FALSE(editor.Load(invalid));
+  EXPECT_EQ(editor.segment_size(), 0);
+}
+
+TEST(PathEditorTest, Trim) {
+  PathEditor editor;
+  for (uint32_t s = 0; s < 10; ++s) ASSERT_TRUE(editor.Append(s * 10, Expr(s, s)));
+
+  // Before the first segment and inside it nothing has expired.
+  EXPECT_EQ(editor.Trim(0), 0);
+  EXPECT_EQ(editor.Trim(9), 0);
+  // Segments 0 to 2 end by 35; segment 3 covers it.
+  EXPECT_EQ(editor.Trim(35), 3);
+  ExpectSegments(editor, {30, 40, 50, 60, 70, 80, 90}, 3);
+  // The last segment is never trimmed.
+  EXPECT_EQ(editor.Trim(1000), 6);
+  ExpectSegments(editor, {90}, 9);
+
+  ASSERT_TRUE(editor.Append(100, Expr(10)));
+  ExpectSegments(editor, {90, 100}, 9);
+}
+
+TEST(PathEditorTest, TrimCompactsDeadData) {
+  PathEditor editor;
+  for (uint32_t s = 0; s < 64; ++s) ASSERT_TRUE(editor.Append(s * 10, Expr(s, s)));
+  size_t full = editor.data().size();
+
+  EXPECT_EQ(editor.Trim(600), 60);
+  EXPECT_LT(editor.data().size(), full / 2);
+  ExpectSegments(editor, {600, 610, 620, 630}, 60);
+}
+
+TEST(PathEditorTest, RollingWindow) {
+  // Appending one segment and trimming one per step keeps the path bounded.
+  PathEditor editor;
+  std::vector<uint32_t> start_times;
+  for (uint32_t s = 0; s < 16; ++s) {
+    ASSERT_TRUE(editor.Append(s * 10, Expr(s)));
+  }
+  size_t max_size = 0;
+  for (uint32_t s = 16; s < 1000; ++s) {
+    ASSERT_TRUE(editor.Append(s * 10, Expr(s)));
+    EXPECT_EQ(editor.Trim((s - 15) * 10), 1);
+    max_size = std::max(max_size, editor.data().size());
+  }
+  EXPECT_LT(max_size, 1024);
+  for (uint32_t s = 984; s < 1000; ++s) start_times.push_back(s * 10);
+  ExpectSegments(editor, start_times, 984);
+}
+
+TEST(PathEditorTest, TrimWithoutReads) {
+  // Trims between reads leave dead headers in front of the live ones, which
+  // appends and data() must look past.
+  PathEditor editor;
+  for (uint32_t s = 0; s < 1000; ++s) ASSERT_TRUE(editor.Append(s * 10, Expr(s)));
+  for (uint32_t s = 1000; s < 6000; ++s) {
+    ASSERT_TRUE(editor.Append(s * 10, Expr(s)));
+    ASSERT_EQ(editor.Trim((s - 999) * 10), 1);
+    ASSERT_EQ(editor.segment_size(), 1000);
+    ASSERT_EQ(editor.segment_header(0).start_time, (s - 999) * 10);
+    if (s % 1000 == 0) {
+      PathReader reader;
+      ASSERT_TRUE(reader.Read(editor.data()));
+      EXPECT_EQ(EvalAt(reader, s * 10), float(s));
+    }
+  }
+  EXPECT_EQ(editor.Trim(59000), 900);
+  std::vector<uint32_t> start_times;
+  for (uint32_t s = 5900; s < 6000; ++s) start_times.push_back(s * 10);
+  ExpectSegments(editor, start_times, 5900);
+}
+
+TEST(PathEditorTest, Overflow) {
+  PathEditor editor;
+  ASSERT_TRUE(editor.Append(0xfffffff0, Expr(0)));
+  ASSERT_TRUE(editor.Append(0xfffffff8, Expr(1)));
+  ASSERT_TRUE(editor.Append(4, Expr(2)));
+  ASSERT_TRUE(editor.Append(12, Expr(3)));
+  EXPECT_EQ(editor.data()[2], PathHeader::Overflow);
+  ExpectSegments(editor, {0xfffffff0, 0xfffffff8, 4, 12}, 0);
+
+  // Trimming up to a time past the wrap follows the Overflow ordering.
+  EXPECT_EQ(editor.Trim(0xfffffffa), 1);
+  EXPECT_EQ(editor.data()[2], PathHeader::Overflow);
+  // Once the wrap is trimmed the flag is cleared.
+  EXPECT_EQ(editor.Trim(5), 1);
+  EXPECT_EQ(editor.data()[2], 0);
+  ExpectSegments(editor, {4, 12}, 2);
+}
+
+TEST(PathEditorTest, Limits) {
+  // Segments are appended until the small format's 64 KiB are used up.
+  PathEditor editor;
+  uint32_t segments = 0;
+  while (editor.Append(segments, Expr(segments))) ++segments;
+  EXPECT_GT(segments, 2000);
+  EXPECT_FALSE(editor.Append(WriterPath({segments})));
+  EXPECT_EQ(editor.segment_size(), segments);
+  std::vector<uint32_t> start_times;
+  for (uint32_t s = 0; s < segments; ++s) start_times.push_back(s);
+  ExpectSegments(editor, start_times, 0);
+
+  // A full path keeps rolling: each trim makes room for the next append.
+  for (uint32_t s = segments; s < 2 * segments; ++s) {
+    ASSERT_EQ(editor.Trim(s - segments + 1), 1);
+    ASSERT_TRUE(editor.Append(s, Expr(s))) << "s = " << s;
+  }
+  start_times.clear();
+  for (uint32_t s = segments; s < 2 * segments; ++s) start_times.push_back(s);
+  ExpectSegments(editor, start_times, segments);
+
+  PathEditor large;
+  PostfixWriter big;
+  for (size_t i = 0; i < 0x1000; ++i) big.add_f(0);
+  size_t appended = 0;
+  while (large.Append(appended, big)) ++appended;
+  EXPECT_EQ(appended, 3);
+  PathReader reader;
+  EXPECT_TRUE(reader.Read(large.data()));
+
+  // Trimming frees room for more.
+  EXPECT_EQ(large.Trim(2), 2);
+  EXPECT_TRUE(large.Append(3, big));
+  EXPECT_TRUE(reader.Read(large.data()));
+}
+
+}
+}
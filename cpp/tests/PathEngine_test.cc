@@ -0,0 +1,113 @@
+#include <WickedWinchProtocol/PathEngine.h>
+#include <WickedWinchProtocol/PathProgram.h>
+#include <WickedWinchProtocol/Path.h>
+
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::FloatEq;
+using ::testing::Pointwise;
+
+namespace wickedwinch::protocol {
+namespace {
+
+struct TestStack : PostfixStack {
+  float buffer[32];
+
+  TestStack() {
+    stack_data = buffer;
+    stack_size = 0;
+    stack_capacity = std::size(buffer);
+  }
+};
+
+// A path whose segments do a target-dependent amount of work, so that the
+// ranges are uneven.
+std::vector<uint8_t> WritePath(size_t target) {
+  PathWriter writer;
+  for (uint32_t s = 0; s < 4; ++s) {
+    PathSegmentWriter* segment = writer.add_segments();
+    segment->start_time = s * 100;
+    for (size_t k = 0; k < target % 7; ++k) {
+      segment->expr.Push({float(target), float(s)});
+      segment->expr.add_op(PostfixOp::Atan2);
+      segment->expr.add_op(PostfixOp::Add);
+    }
+  }
+  return writer.Write();
+}
+
+class PathEngineTest : public testing::TestWithParam<size_t> {};
+
+TEST_P(PathEngineTest, MatchesPathEval) {
+  std::vector<std::vector<uint8_t>> buffers;
+  for (size_t i = 0; i < 50; ++i) buffers.push_back(WritePath(i));
+
+  PathEngine engine(GetParam());
+  std::vector<PathProgram> programs(buffers.size());
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    PathReader reader;
+    ASSERT_TRUE(reader.Read(buffers[i]));
+    EXPECT_EQ(engine.AddTarget(reader), i);
+    programs[i].Load(reader);
+  }
+
+  for (uint32_t t = 0; t < 500; t += 37) {
+    PathEngineStats stats = engine.Eval(t);
+    EXPECT_EQ(stats.failed, 0);
+    for (size_t i = 0; i < buffers.size(); ++i) {
+      TestStack want;
+      ASSERT_EQ(programs[i].Eval(t, want), EvalStatus::Ok);
+      EXPECT_EQ(engine.status(i), EvalStatus::Ok);
+      EXPECT_THAT(engine.result(i), Pointwise(FloatEq(), std::vector<float>(want.begin(), want.end())))
+          << "target " << i << " t " << t;
+    }
+  }
+}
+
+TEST_P(PathEngineTest, PerTargetStatus) {
+  PathWriter late;
+  late.add_segments()->start_time = 1000;
+  PathWriter underflow;
+  underflow.add_segments()->expr.Pop(2);
+  auto ok_buffer = WritePath(3);
+  auto late_buffer = late.Write();
+  auto underflow_buffer = underflow.Write();
+
+  PathEngine engine(GetParam());
+  for (const auto* buffer : {&ok_buffer, &late_buffer, &underflow_buffer}) {
+    PathReader reader;
+    ASSERT_TRUE(reader.Read(*buffer));
+    engine.AddTarget(reader);
+  }
+
+  EXPECT_EQ(engine.Eval(500).failed, 2);
+  EXPECT_EQ(engine.status(0), EvalStatus::Ok);
+  EXPECT_EQ(engine.status(1), EvalStatus::UndefinedOperation);
+  EXPECT_EQ(engine.status(2), EvalStatus::StackUnderflow);
+
+  EXPECT_EQ(engine.Eval(1500).failed, 1);
+  EXPECT_EQ(engine.status(1), EvalStatus::Ok);
+  EXPECT_THAT(engine.result(1), Pointwise(FloatEq(), {0.5}));
+
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(ok_buffer));
+  engine.SetPath(2, reader);
+  EXPECT_EQ(engine.Eval(1500).failed, 0);
+}
+
+INSTANTIATE_TEST_SUITE_P(Workers, PathEngineTest, testing::Values(1, 2, 3, 8));
+
+TEST(PathEngineStatsTest, Empty) {
+  PathEngine engine(4);
+  EXPECT_EQ(engine.workers(), 4);
+  EXPECT_EQ(engine.size(), 0);
+  PathEngineStats stats = engine.Eval(0);
+  EXPECT_EQ(stats.failed, 0);
+  EXPECT_GE(stats.latency.count(), 0);
+}
+
+}
+}
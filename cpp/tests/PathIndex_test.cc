@@ -0,0 +1,122 @@
+#include <WickedWinchProtocol/PathIndex.h>
+#include <WickedWinchProtocol/Path.h>
+
+#include "PathTestUtil.h"
+
+#include <random>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace wickedwinch::protocol {
+namespace {
+
+// Checks the index against the reader's search at every start time, one
+// before and after it, and at the given extra times.
+void ExpectMatchesReader(const std::vector<uint32_t>& start_times, const std::vector<uint32_t>& times = {}) {
+  std::vector<uint8_t> buffer = WritePath(start_times);
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  PathIndex index;
+  index.Build(reader);
+
+  std::vector<uint32_t> probes = times;
+  for (uint32_t start_time : start_times) {
+    probes.insert(probes.end(), {start_time - 1, start_time, start_time + 1});
+  }
+  probes.insert(probes.end(), {0, 1, 0x7fffffff, 0xfffffffe, 0xffffffff});
+  for (uint32_t t : probes) {
+    EXPECT_EQ(index.SegmentAt(t), reader.SegmentAt(t)) << "t = " << t;
+  }
+}
+
+TEST(PathIndexTest, Empty) {
+  PathIndex index;
+  EXPECT_EQ(index.SegmentAt(0), PathReader::kNoSegment);
+  ExpectMatchesReader({});
+}
+
+TEST(PathIndexTest, Uniform) {
+  std::vector<uint32_t> start_times;
+  for (uint32_t s = 0; s < 1000; ++s) start_times.push_back(5000 + s * 1000);
+  ExpectMatchesReader(start_times);
+}
+
+TEST(PathIndexTest, SingleSegment) {
+  ExpectMatchesReader({0});
+  ExpectMatchesReader({1000});
+}
+
+TEST(PathIndexTest, EqualStartTimes) {
+  ExpectMatchesReader({0, 0, 10, 10, 10, 20});
+  ExpectMatchesReader({7, 7, 7, 7});
+}
+
+TEST(PathIndexTest, Irregular) {
+  // Dense clusters separated by long gaps put many segments in one bucket.
+  std::mt19937 rng(1);
+  std::vector<uint32_t> start_times;
+  uint32_t t = 100;
+  for (int s = 0; s < 3000; ++s) {
+    t += rng() % 8 == 0 ? rng() % 10000000 : rng() % 4;
+    start_times.push_back(t);
+  }
+  std::vector<uint32_t> times;
+  for (int i = 0; i < 10000; ++i) times.push_back(rng() % (t + 1000));
+  ExpectMatchesReader(start_times, times);
+}
+
+TEST(PathIndexTest, FullRange) {
+  ExpectMatchesReader({0, 1, 0x80000000, 0xfffffffe, 0xffffffff});
+}
+
+TEST(PathIndexTest, Overflow) {
+  std::vector<uint32_t> start_times;
+  for (uint32_t s = 0; s < 500; ++s) start_times.push_back(uint32_t(-250000) + s * 1000);
+  std::vector<uint32_t> times;
+  for (uint32_t i = 0; i < 800; ++i) times.push_back(uint32_t(-300000) + i * 777);
+  ExpectMatchesReader(start_times, times);
+
+  std::vector<uint8_t> buffer = WritePath(start_times);
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  PathIndex index;
+  index.Build(reader);
+  EXPECT_TRUE(index.indexed());
+  EXPECT_EQ(index.SegmentAt(uint32_t(-1)), 249);
+  EXPECT_EQ(index.SegmentAt(0), 250);
+}
+
+TEST(PathIndexTest, UnorderedFallsBack) {
+  // Two decreases make the start times unordered even relative to the first.
+  std::vector<uint32_t> start_times = {1000, 500, 2000, 100, 3000};
+  std::vector<uint8_t> buffer = WritePath(start_times);
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  PathIndex index;
+  index.Build(reader);
+  EXPECT_FALSE(index.indexed());
+  ExpectMatchesReader(start_times, {0, 600, 1500, 2500, 5000});
+}
+
+TEST(PathIndexTest, Cursor) {
+  std::vector<uint32_t> start_times;
+  for (uint32_t s = 0; s < 4000; ++s) start_times.push_back(s * 10 + (s % 7));
+  std::vector<uint8_t> buffer = WritePath(start_times);
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  PathIndex index;
+  index.Build(reader);
+
+  PathCursor cursor;
+  std::mt19937 rng(2);
+  for (int i = 0; i < 5000; ++i) {
+    // Mix forward playback with random seeks.
+    uint32_t t = i % 4 == 0 ? rng() % 41000 : cursor.begin + 3;
+    EXPECT_EQ(reader.SegmentAt(t, cursor, index), reader.SegmentAt(t)) << "t = " << t;
+  }
+}
+
+}
+}
@@ -0,0 +1,236 @@
+#include <WickedWinchProtocol/PathProgram.h>
+#include <WickedWinchProtocol/Path.h>
+#include <WickedWinchProtocol/Postfix.h>
+
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::FloatEq;
+using ::testing::Pointwise;
+
+namespace wickedwinch::protocol {
+namespace {
+
+struct TestStack : PostfixStack {
+  float buffer[16];
+
+  TestStack(size_t capacity = 16) {
+    stack_data = buffer;
+    stack_size = 0;
+    stack_capacity = capacity;
+  }
+};
+
+struct TestBatchStack : PostfixBatchStack {
+  float buffer[16 * kBatchLanes];
+
+  TestBatchStack() {
+    stack_data = buffer;
+    stack_size = 0;
+    stack_capacity = std::size(buffer) / kBatchLanes;
+  }
+};
+
+std::vector<uint8_t> WritePath() {
+  PathWriter writer;
+  PathSegmentWriter* segment;
+  segment = writer.add_segments();
+  segment->start_time = 1000;
+  segment->expr.Push({2});
+  segment->expr.add_op(PostfixOp::Mul);
+  segment->expr.add_op(PostfixOp::Sin);
+  segment = writer.add_segments();
+  segment->start_time = 2000;
+  segment->expr.Push({1, 2, 3, 4});
+  segment->expr.add_op(PostfixOp::Transpose);
+  segment->expr.add_i(2);
+  segment->expr.add_i(2 << 1);
+  segment = writer.add_segments();
+  segment->start_time = 3000;
+  segment->expr.Pop(2);
+  return writer.Write();
+}
+
+TEST(PathProgramTest, Load) {
+  auto buffer = WritePath();
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  PathProgram program;
+  program.Load(reader);
+
+  ASSERT_EQ(program.segments().size(), 3);
+  EXPECT_EQ(program.segments()[0].start_time, 1000);
+  EXPECT_EQ(program.segments()[0].status, EvalStatus::Ok);
+  EXPECT_EQ(program.segments()[1].status, EvalStatus::Ok);
+  EXPECT_EQ(program.segments()[2].status, EvalStatus::StackUnderflow);
+}
+
+TEST(PathProgramTest, MatchesReader) {
+  auto buffer = WritePath();
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  PathProgram program;
+  program.Load(reader);
+
+  PathCursor cursor;
+  for (uint32_t t = 0; t < 4000; t += 70) {
+    SCOPED_TRACE(t);
+    // A stack too small for the Transpose temporaries still evaluates
+    // through the checked evaluator.
+    for (size_t capacity : {16, 5}) {
+      TestStack want(capacity);
+      TestStack got(capacity);
+      EvalStatus status = reader.Eval(t, want);
+      EXPECT_EQ(program.Eval(t, cursor, got), status);
+      if (status == EvalStatus::Ok) {
+        EXPECT_THAT(got, Pointwise(FloatEq(), std::vector<float>(want.begin(), want.end())));
+      }
+    }
+  }
+}
+
+TEST(PathProgramTest, EvalBatch) {
+  auto buffer = WritePath();
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  PathProgram program;
+  program.Load(reader);
+
+  std::vector<uint32_t> times;
+  for (uint32_t t = 1000; t < 3000; t += 90) times.push_back(t);
+  std::vector<float> want(times.size());
+  std::vector<float> got(times.size());
+  TestBatchStack batch;
+  ASSERT_EQ(reader.EvalBatch(times, 1, want, batch), EvalStatus::Ok);
+  ASSERT_EQ(program.EvalBatch(times, 1, got, batch), EvalStatus::Ok);
+  EXPECT_THAT(got, Pointwise(FloatEq(), want));
+
+  std::vector<uint32_t> failing = {2500, 3000};
+  EXPECT_EQ(program.EvalBatch(failing, 1, got, batch), EvalStatus::StackUnderflow);
+  EXPECT_EQ(reader.EvalBatch(failing, 1, want, batch), EvalStatus::StackUnderflow);
+
+  batch.stack_capacity = 0;
+  EXPECT_EQ(program.EvalBatch(times, 1, got, batch), EvalStatus::StackOverflow);
+}
+
+TEST(PathProgramTest, Reload) {
+  auto first = WritePath();
+  PathWriter writer;
+  writer.add_segments()->start_time = 0;
+  auto second = writer.Write();
+
+  PathReader reader;
+  PathProgram program;
+  ASSERT_TRUE(reader.Read(first));
+  program.Load(reader);
+  ASSERT_TRUE(reader.Read(second));
+  program.Load(reader);
+  ASSERT_EQ(program.segments().size(), 1);
+
+  TestStack stack;
+  EXPECT_EQ(program.Eval(500, stack), EvalStatus::Ok);
+  EXPECT_THAT(stack, Pointwise(FloatEq(), {0.5}));
+}
+
+// Samples the path one frame at a time with PathProgram::Eval.
+std::vector<float> EvalFrames(const PathProgram& program, uint32_t t, uint32_t period, size_t frames, size_t width) {
+  std::vector<float> out;
+  for (size_t i = 0; i < frames; ++i, t += period) {
+    TestStack stack;
+    EXPECT_EQ(program.Eval(t, stack), EvalStatus::Ok) << "t = " << t;
+    out.insert(out.end(), stack.begin(), stack.begin() + width);
+  }
+  return out;
+}
+
+std::vector<uint8_t> WriteVectorPath(std::initializer_list<uint32_t> start_times) {
+  PathWriter writer;
+  float k = 1;
+  for (uint32_t start_time : start_times) {
+    PathSegmentWriter* segment = writer.add_segments();
+    segment->start_time = start_time;
+    segment->expr.add_op(PostfixOp::Dup);
+    segment->expr.add_i(0);
+    segment->expr.Push({k++});
+    segment->expr.add_op(PostfixOp::Add);
+  }
+  return writer.Write();
+}
+
+TEST(PathSamplerTest, CrossesSegments) {
+  auto buffer = WriteVectorPath({0, 100, 130, 131, 500});
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  PathProgram program;
+  program.Load(reader);
+
+  for (uint32_t period : {1, 7, 40, 1000}) {
+    SCOPED_TRACE(period);
+    PathSampler sampler(program, 20, period, 2);
+    std::vector<float> out(2 * 50);
+    TestBatchStack batch;
+    ASSERT_EQ(sampler.Fill(out, batch), EvalStatus::Ok);
+    EXPECT_EQ(sampler.time(), 20 + 50 * period);
+    EXPECT_THAT(out, Pointwise(FloatEq(), EvalFrames(program, 20, period, 50, 2)));
+  }
+}
+
+TEST(PathSamplerTest, Continues) {
+  auto buffer = WriteVectorPath({0, 100, 200});
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  PathProgram program;
+  program.Load(reader);
+
+  PathSampler sampler(program, 0, 3, 1);
+  TestBatchStack batch;
+  std::vector<float> out;
+  for (size_t frames : {1, 5, 13, 40, 21}) {
+    std::vector<float> chunk(frames);
+    ASSERT_EQ(sampler.Fill(chunk, batch), EvalStatus::Ok);
+    out.insert(out.end(), chunk.begin(), chunk.end());
+  }
+  EXPECT_THAT(out, Pointwise(FloatEq(), EvalFrames(program, 0, 3, out.size(), 1)));
+}
+
+TEST(PathSamplerTest, Overflow) {
+  auto buffer = WriteVectorPath({uint32_t(-50), 10, 60});
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  ASSERT_EQ(reader.flags(), PathHeader::Overflow);
+  PathProgram program;
+  program.Load(reader);
+
+  PathSampler sampler(program, uint32_t(-45), 4, 1);
+  std::vector<float> out(40);
+  TestBatchStack batch;
+  ASSERT_EQ(sampler.Fill(out, batch), EvalStatus::Ok);
+  EXPECT_THAT(out, Pointwise(FloatEq(), EvalFrames(program, uint32_t(-45), 4, 40, 1)));
+}
+
+TEST(PathSamplerTest, Errors) {
+  auto buffer = WritePath();
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  PathProgram program;
+  program.Load(reader);
+  TestBatchStack batch;
+
+  PathSampler before(program, 900, 50, 1);
+  std::vector<float> out(4);
+  EXPECT_EQ(before.Fill(out, batch), EvalStatus::UndefinedOperation);
+  EXPECT_EQ(before.time(), 900);
+
+  // Segment 2 fails verification; the frames before it are written.
+  PathSampler failing(program, 2900, 50, 1);
+  EXPECT_EQ(failing.Fill(out, batch), EvalStatus::StackUnderflow);
+  EXPECT_EQ(failing.time(), 3000);
+
+  PathSampler wide(program, 1000, 50, 2);
+  EXPECT_EQ(wide.Fill(out, batch), EvalStatus::StackUnderflow);
+}
+
+}
+}
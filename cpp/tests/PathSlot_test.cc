@@ -0,0 +1,153 @@
+#include <WickedWinchProtocol/PathEngine.h>
+#include <WickedWinchProtocol/PathSlot.h>
+#include <WickedWinchProtocol/Path.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::FloatEq;
+using ::testing::Pointwise;
+
+namespace wickedwinch::protocol {
+namespace {
+
+struct TestStack : PostfixStack {
+  float buffer[8];
+
+  TestStack() {
+    stack_data = buffer;
+    stack_size = 0;
+    stack_capacity = std::size(buffer);
+  }
+};
+
+// A path that evaluates to value from time 0 on, over two segments.
+std::vector<uint8_t> ConstantPath(float value) {
+  PathWriter writer;
+  for (uint32_t start_time : {0, 1000}) {
+    PathSegmentWriter* segment = writer.add_segments();
+    segment->start_time = start_time;
+    segment->expr.Pop(1);
+    segment->expr.Push({value});
+  }
+  return writer.Write();
+}
+
+float EvalAt(const PathProgram& path, uint32_t t) {
+  TestStack stack;
+  EXPECT_EQ(path.Eval(t, stack), EvalStatus::Ok);
+  return stack[0];
+}
+
+TEST(PathSlotTest, Publish) {
+  PathSlot slot(2);
+  EXPECT_FALSE(slot.Read(0));
+
+  EXPECT_FALSE(slot.Publish({1, 2}));
+  EXPECT_FALSE(slot.Read(0));
+
+  EXPECT_TRUE(slot.Publish(ConstantPath(5)));
+  {
+    PathSlot::Guard path = slot.Read(1);
+    ASSERT_TRUE(path);
+    EXPECT_EQ(EvalAt(*path.get(), 1500), 5);
+  }
+
+  // An invalid upload keeps the active path.
+  EXPECT_FALSE(slot.Publish({}));
+  EXPECT_EQ(EvalAt(*slot.Read(0).get(), 10), 5);
+}
+
+TEST(PathSlotTest, ReclaimsAfterReaders) {
+  PathSlot slot(2);
+  ASSERT_TRUE(slot.Publish(ConstantPath(1)));
+  EXPECT_EQ(slot.Reclaim(), 0);
+
+  {
+    PathSlot::Guard old_path = slot.Read(0);
+    uint64_t old_version = old_path.version();
+    ASSERT_TRUE(slot.Publish(ConstantPath(2)));
+    EXPECT_EQ(slot.Reclaim(), 1);
+
+    // The held path stays valid; new reads see the new one.
+    EXPECT_EQ(EvalAt(*old_path.get(), 500), 1);
+    PathSlot::Guard new_path = slot.Read(1);
+    EXPECT_EQ(EvalAt(*new_path.get(), 500), 2);
+    EXPECT_NE(new_path.version(), old_version);
+  }
+  EXPECT_EQ(slot.Reclaim(), 0);
+
+  // A reader pinned to an epoch holds back everything retired since, and
+  // Publish reclaims once it is released.
+  {
+    PathSlot::Guard current = slot.Read(1);
+    ASSERT_TRUE(slot.Publish(ConstantPath(3)));
+    ASSERT_TRUE(slot.Publish(ConstantPath(4)));
+    EXPECT_EQ(slot.Reclaim(), 2);
+  }
+  ASSERT_TRUE(slot.Publish(ConstantPath(5)));
+  EXPECT_EQ(slot.Reclaim(), 0);
+}
+
+TEST(PathSlotTest, ConcurrentPublish) {
+  constexpr size_t kReaders = 3;
+  constexpr int kPaths = 200;
+  PathSlot slot(kReaders);
+  ASSERT_TRUE(slot.Publish(ConstantPath(0)));
+
+  std::atomic<bool> done = false;
+  std::vector<std::thread> readers;
+  std::atomic<int> errors = 0;
+  for (size_t r = 0; r < kReaders; ++r) {
+    readers.emplace_back([&, r] {
+      float last = 0;
+      for (uint32_t t = 0; !done.load(); t = (t + 7) % 2000) {
+        PathSlot::Guard path = slot.Read(r);
+        TestStack stack;
+        if (path->Eval(t, stack) != EvalStatus::Ok) ++errors;
+        // Values only move forward as paths are published.
+        if (stack[0] < last) ++errors;
+        last = stack[0];
+      }
+    });
+  }
+  for (int k = 1; k <= kPaths; ++k) {
+    ASSERT_TRUE(slot.Publish(ConstantPath(k)));
+    std::this_thread::yield();
+  }
+  done = true;
+  for (std::thread& reader : readers) reader.join();
+
+  EXPECT_EQ(errors, 0);
+  EXPECT_EQ(slot.Reclaim(), 0);
+  EXPECT_EQ(EvalAt(*slot.Read(0).get(), 0), kPaths);
+}
+
+TEST(PathSlotTest, Engine) {
+  PathSlot slot(2);
+  PathEngine engine(2);
+  size_t target = engine.AddTarget(slot, 8);
+
+  EXPECT_EQ(engine.Eval(0).failed, 1);
+  EXPECT_EQ(engine.status(target), EvalStatus::UndefinedOperation);
+
+  ASSERT_TRUE(slot.Publish(ConstantPath(7)));
+  EXPECT_EQ(engine.Eval(1500).failed, 0);
+  EXPECT_THAT(engine.result(target), Pointwise(FloatEq(), {7}));
+
+  // The new path has a single segment; the cursor must not reuse the old
+  // path's spans.
+  PathWriter writer;
+  writer.add_segments()->start_time = 2000;
+  ASSERT_TRUE(slot.Publish(writer.Write()));
+  EXPECT_EQ(engine.Eval(1600).failed, 1);
+  EXPECT_EQ(engine.Eval(2500).failed, 0);
+  EXPECT_THAT(engine.result(target), Pointwise(FloatEq(), {0.5}));
+}
+
+}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <WickedWinchProtocol/Path.h>
+#include <WickedWinchProtocol/Postfix.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace wickedwinch::protocol {
+
+// Serializes a path with one segment per start time, in order.
+// add_expr(expr, s) writes segment s's expression.
+template <typename AddExpr>
+std::vector<uint8_t> WritePath(const std::vector<uint32_t>& start_times, AddExpr add_expr) {
+  PathWriter writer;
+  for (size_t s = 0; s < start_times.size(); ++s) {
+    PathSegmentWriter* segment = writer.add_segments();
+    segment->start_time = start_times[s];
+    add_expr(segment->expr, s);
+  }
+  return writer.Write();
+}
+
+// As above, with empty expressions.
+inline std::vector<uint8_t> WritePath(const std::vector<uint32_t>& start_times) {
+  return WritePath(start_times, [](PostfixWriter&, size_t) {});
+}
+
+}
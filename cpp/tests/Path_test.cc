@@ -1,6 +1,8 @@
 #include <WickedWinchProtocol/Path.h>
 #include <WickedWinchProtocol/Postfix.h>
 
+#include "PathTestUtil.h"
+
 #include <vector>
 
 #include <gmock/gmock.h>
@@ -22,6 +24,16 @@ struct TestStack : PostfixStack {
   }
 };
 
+struct TestBatchStack : PostfixBatchStack {
+  float buffer[8 * kBatchLanes];
+
+  TestBatchStack() {
+    stack_data = buffer;
+    stack_size = 0;
+    stack_capacity = std::size(buffer) / kBatchLanes;
+  }
+};
+
 TEST(PathEvalTest, Empty) {
   PathReader reader;
 
@@ -106,5 +118,240 @@ TEST(PathEvalTest, Overflow) {
   EXPECT_THAT(stack, Pointwise(FloatEq(), {0.5}));
 }
 
+TEST(PathEvalTest, EvalBatch) {
+  PathWriter writer;
+  PathSegmentWriter* segment;
+  segment = writer.add_segments();
+  segment->start_time = 1000;
+  segment->expr.Push({2});
+  segment->expr.add_op(PostfixOp::Mul);
+  segment->expr.add_op(PostfixOp::Sin);
+  segment = writer.add_segments();
+  segment->start_time = 2000;
+  segment->expr.Push({99});
+  segment->expr.add_op(PostfixOp::Add);
+
+  PathReader reader;
+  auto buffer = writer.Write();
+  EXPECT_TRUE(reader.Read(buffer));
+
+  std::vector<uint32_t> times;
+  for (uint32_t t = 1000; t < 3000; t += 90) times.push_back(t);
+
+  std::vector<float> out(times.size());
+  TestBatchStack batch;
+  EXPECT_EQ(reader.EvalBatch(times, 1, out, batch), EvalStatus::Ok);
+
+  std::vector<float> want;
+  for (uint32_t t : times) {
+    TestStack stack;
+    EXPECT_EQ(reader.Eval(t, stack), EvalStatus::Ok);
+    want.push_back(stack[0]);
+  }
+  EXPECT_THAT(out, Pointwise(FloatEq(), want));
+
+  std::vector<uint32_t> before = {1000, 500};
+  EXPECT_EQ(reader.EvalBatch(before, 1, out, batch), EvalStatus::UndefinedOperation);
+
+  // No room for the segment time.
+  batch.stack_capacity = 0;
+  EXPECT_EQ(reader.EvalBatch(times, 1, out, batch), EvalStatus::StackOverflow);
+}
+
+// Checks that a cursor lookup at every time agrees with the uncached search.
+void ExpectCursorMatches(const PathReader& reader, PathCursor& cursor, std::span<const uint32_t> times) {
+  for (uint32_t t : times) {
+    EXPECT_EQ(reader.SegmentAt(t, cursor), reader.SegmentAt(t)) << "t = " << t;
+  }
+}
+
+TEST(PathCursorTest, Forward) {
+  auto buffer = WritePath({1000, 2000, 2000, 2500, 4000});
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+
+  std::vector<uint32_t> times;
+  for (uint32_t t = 0; t < 6000; t += 10) times.push_back(t);
+  PathCursor cursor;
+  ExpectCursorMatches(reader, cursor, times);
+  EXPECT_EQ(cursor.segment, 4);
+
+  // Skipping several segments at once.
+  PathCursor skip;
+  ExpectCursorMatches(reader, skip, std::vector<uint32_t>{0, 1500, 4500, 0xffffffff});
+}
+
+TEST(PathCursorTest, Seek) {
+  auto buffer = WritePath({1000, 2000, 3000});
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+
+  PathCursor cursor;
+  ExpectCursorMatches(reader, cursor, std::vector<uint32_t>{3500, 2500, 500, 1999, 1000, 3000, 2999});
+}
+
+TEST(PathCursorTest, Overflow) {
+  auto buffer = WritePath({uint32_t(-2000), uint32_t(-1000), 0, 1000});
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  ASSERT_EQ(reader.flags(), PathHeader::Overflow);
+
+  std::vector<uint32_t> times;
+  for (uint32_t t = -2500; t != 3000; t += 250) times.push_back(t);
+  PathCursor cursor;
+  ExpectCursorMatches(reader, cursor, times);
+  ExpectCursorMatches(reader, cursor, std::vector<uint32_t>{uint32_t(-1500), 500, uint32_t(-500)});
+  EXPECT_EQ(reader.SegmentAt(uint32_t(-1), cursor), 1);
+  EXPECT_EQ(reader.SegmentAt(0, cursor), 2);
+}
+
+TEST(PathCursorTest, Empty) {
+  auto buffer = WritePath({});
+  PathReader reader;
+  PathCursor cursor;
+  EXPECT_EQ(reader.SegmentAt(0, cursor), PathReader::kNoSegment);
+  ASSERT_TRUE(reader.Read(buffer));
+  EXPECT_EQ(reader.SegmentAt(0, cursor), PathReader::kNoSegment);
+  EXPECT_EQ(reader.SegmentAt(1000, cursor), PathReader::kNoSegment);
+}
+
+TEST(PathCursorTest, ChangesPath) {
+  auto first = WritePath({0, 1000});
+  auto second = WritePath({0, 500, 1000});
+  PathReader reader;
+  PathCursor cursor;
+
+  ASSERT_TRUE(reader.Read(first));
+  EXPECT_EQ(reader.SegmentAt(700, cursor), 0);
+  ASSERT_TRUE(reader.Read(second));
+  EXPECT_EQ(reader.SegmentAt(700, cursor), 1);
+}
+
+TEST(PathCursorTest, ReusedBuffer) {
+  auto first = WritePath({0, 10, 20, 30});
+  auto second = WritePath({0, 1000});
+  std::vector<uint8_t> buffer = first;
+  buffer.reserve(256);
+  PathReader reader;
+  PathCursor cursor;
+
+  ASSERT_TRUE(reader.Read(buffer));
+  EXPECT_EQ(reader.SegmentAt(25, cursor), 2);
+  // A shorter path read into the same storage.
+  const uint8_t* data = buffer.data();
+  buffer = second;
+  ASSERT_EQ(buffer.data(), data);
+  ASSERT_TRUE(reader.Read(buffer));
+  EXPECT_EQ(reader.SegmentAt(25, cursor), 0);
+
+  // A path with the same segment count and the same first segment.
+  buffer = WritePath({0, 20});
+  ASSERT_TRUE(reader.Read(buffer));
+  EXPECT_EQ(reader.SegmentAt(25, cursor), 1);
+
+  // Copies of a reader share its cursors.
+  PathReader copy = reader;
+  EXPECT_EQ(copy.generation(), reader.generation());
+  EXPECT_EQ(copy.SegmentAt(30, cursor), 1);
+}
+
+TEST(PathCursorTest, Eval) {
+  PathWriter writer;
+  writer.add_segments()->start_time = 1000;
+  PathSegmentWriter* segment = writer.add_segments();
+  segment->start_time = 2000;
+  segment->expr.Push({2});
+  segment->expr.add_op(PostfixOp::Mul);
+
+  PathReader reader;
+  auto buffer = writer.Write();
+  ASSERT_TRUE(reader.Read(buffer));
+
+  PathCursor cursor;
+  TestStack stack;
+  EXPECT_EQ(reader.Eval(500, cursor, stack), EvalStatus::UndefinedOperation);
+
+  EXPECT_EQ(reader.Eval(1500, cursor, stack), EvalStatus::Ok);
+  EXPECT_THAT(stack, Pointwise(FloatEq(), {0.5}));
+
+  EXPECT_EQ(reader.Eval(2500, cursor, stack), EvalStatus::Ok);
+  EXPECT_THAT(stack, Pointwise(FloatEq(), {1}));
+  EXPECT_EQ(cursor.segment, 1);
+}
+
+std::vector<uint8_t> WriteSegments(size_t n, uint32_t first, uint32_t step) {
+  PathWriter writer;
+  for (size_t s = 0; s < n; ++s) {
+    writer.add_segments()->start_time = first + uint32_t(s) * step;
+  }
+  return writer.Write();
+}
+
+TEST(PathLargeTest, SmallFormatBeyond255Segments) {
+  auto buffer = WriteSegments(300, 0, 10);
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  EXPECT_FALSE(reader.large());
+  EXPECT_EQ(reader.segment_header_size(), 300);
+  EXPECT_EQ(reader.SegmentAt(2995), 299);
+  EXPECT_EQ(reader.start_time(299), 2990);
+}
+
+TEST(PathLargeTest, LargeFormat) {
+  constexpr size_t kSegments = 100000;
+  auto buffer = WriteSegments(kSegments, 1000, 10);
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  EXPECT_TRUE(reader.large());
+  EXPECT_EQ(reader.flags(), PathHeader::Large);
+  EXPECT_EQ(reader.segment_header_size(), kSegments);
+
+  EXPECT_EQ(reader.SegmentAt(999), PathReader::kNoSegment);
+  EXPECT_EQ(reader.SegmentAt(1000), 0);
+  EXPECT_EQ(reader.SegmentAt(1000 + 70000 * 10 + 5), 70000);
+  EXPECT_EQ(reader.SegmentAt(0xffffffff), kSegments - 1);
+  EXPECT_EQ(reader.segment_header(70000).start_time, 1000 + 70000 * 10);
+  EXPECT_EQ(reader.segment_header(70000).size, sizeof(PostfixHeader));
+
+  std::vector<uint32_t> times;
+  for (uint32_t t = 0; t < 1000 + kSegments * 10; t += 7) times.push_back(t);
+  PathCursor cursor;
+  ExpectCursorMatches(reader, cursor, times);
+
+  TestStack stack;
+  EXPECT_EQ(reader.Eval(1000 + 70000 * 10 + 5, stack), EvalStatus::Ok);
+  EXPECT_THAT(stack, Pointwise(FloatEq(), {0.005}));
+}
+
+TEST(PathLargeTest, LargeFormatOverflow) {
+  auto buffer = WriteSegments(100000, uint32_t(-500000), 10);
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  EXPECT_EQ(reader.flags(), PathHeader::Large | PathHeader::Overflow);
+  EXPECT_EQ(reader.base_time(), uint32_t(-500000));
+  EXPECT_EQ(reader.SegmentAt(uint32_t(-5)), 49999);
+  EXPECT_EQ(reader.SegmentAt(0), 50000);
+  EXPECT_EQ(reader.SegmentAt(499995), 99999);
+}
+
+TEST(PathLargeTest, ReadRejectsMalformed) {
+  auto buffer = WriteSegments(10000, 0, 10);
+  PathReader reader;
+  ASSERT_TRUE(reader.Read(buffer));
+  ASSERT_TRUE(reader.large());
+
+  auto* large = reinterpret_cast<PathLargeHeader*>(buffer.data() + sizeof(PathHeader));
+  large->version = PathLargeHeader::kVersion + 1;
+  EXPECT_FALSE(reader.Read(buffer));
+  large->version = PathLargeHeader::kVersion;
+
+  EXPECT_FALSE(reader.Read(buffer.data(), sizeof(PathHeader) + sizeof(PathLargeHeader) - 1));
+  EXPECT_FALSE(reader.Read(buffer.data(), sizeof(PathHeader) + sizeof(PathLargeHeader) + 12 * 10000 - 1));
+  EXPECT_FALSE(reader.Read(buffer.data(), buffer.size() - 1));
+
+  large->segment_size = 0xffffffff;
+  EXPECT_FALSE(reader.Read(buffer));
+}
+
 }
 }
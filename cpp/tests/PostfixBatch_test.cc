@@ -0,0 +1,164 @@
+#include <WickedWinchProtocol/PostfixBatch.h>
+#include <WickedWinchProtocol/PostfixProgram.h>
+#include <WickedWinchProtocol/Postfix.h>
+
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::FloatEq;
+using ::testing::Pointwise;
+
+namespace wickedwinch::protocol {
+namespace {
+
+struct TestStack : PostfixStack {
+  float buffer[32];
+
+  TestStack() {
+    stack_data = buffer;
+    stack_size = 0;
+    stack_capacity = std::size(buffer);
+  }
+};
+
+struct TestBatchStack : PostfixBatchStack {
+  float buffer[32 * kBatchLanes];
+
+  TestBatchStack() {
+    stack_data = buffer;
+    stack_size = 0;
+    stack_capacity = std::size(buffer) / kBatchLanes;
+  }
+};
+
+// Distinct inputs in (0, 1) for every slot and lane, so every op stays in its
+// domain.
+float Input(size_t slot, size_t lane) {
+  return 0.1f + 0.1f * slot + 0.07f * lane;
+}
+
+// Evaluates the program on a batch stack and on one scalar stack per lane,
+// and checks that every lane matches.
+void ExpectBatchMatches(const PostfixWriter& writer, size_t input_size, bool fuse = false) {
+  PostfixProgram program;
+  ASSERT_EQ(program.Verify(writer, input_size), EvalStatus::Ok);
+  if (fuse) program.Fuse();
+
+  TestBatchStack batch;
+  for (size_t s = 0; s < input_size; ++s) {
+    for (size_t l = 0; l < kBatchLanes; ++l) batch.slot(s)[l] = Input(s, l);
+  }
+  batch.stack_size = input_size;
+  ASSERT_EQ(batch.Eval(program), EvalStatus::Ok);
+  ASSERT_EQ(batch.stack_size, program.output_size());
+
+  for (size_t l = 0; l < kBatchLanes; ++l) {
+    TestStack stack;
+    for (size_t s = 0; s < input_size; ++s) stack.push(Input(s, l));
+    ASSERT_EQ(stack.Eval(program), EvalStatus::Ok);
+
+    std::vector<float> lane;
+    for (size_t s = 0; s < batch.stack_size; ++s) lane.push_back(batch.slot(s)[l]);
+    EXPECT_THAT(lane, Pointwise(FloatEq(), std::vector<float>(stack.begin(), stack.end())))
+        << "lane " << l;
+  }
+}
+
+PostfixWriter Op(PostfixOp op, std::initializer_list<uint8_t> i = {}, std::initializer_list<float> f = {}) {
+  PostfixWriter writer;
+  writer.add_op(op);
+  for (uint8_t v : i) writer.add_i(v);
+  for (float v : f) writer.add_f(v);
+  return writer;
+}
+
+TEST(BatchEvalTest, StackOps) {
+  ExpectBatchMatches(Op(PostfixOp::Push, {2}, {5, 6}), 1);
+  ExpectBatchMatches(Op(PostfixOp::Pop, {2}), 4);
+  ExpectBatchMatches(Op(PostfixOp::Dup, {2}), 4);
+  ExpectBatchMatches(Op(PostfixOp::RotL, {3}), 4);
+  ExpectBatchMatches(Op(PostfixOp::RotR, {3}), 4);
+  ExpectBatchMatches(Op(PostfixOp::Rev, {4}), 4);
+  ExpectBatchMatches(Op(PostfixOp::Transpose, {2, 3 << 1}), 7);
+  ExpectBatchMatches(Op(PostfixOp::Transpose, {3, 2 << 1 | 1}, {1, 2, 3, 4, 5, 6}), 1);
+}
+
+TEST(BatchEvalTest, ScalarOps) {
+  for (PostfixOp op : {
+      PostfixOp::Add, PostfixOp::Sub, PostfixOp::Mul, PostfixOp::MulAdd,
+      PostfixOp::Div, PostfixOp::Mod, PostfixOp::Neg, PostfixOp::Abs,
+      PostfixOp::Inv, PostfixOp::Pow, PostfixOp::Sqrt, PostfixOp::Exp,
+      PostfixOp::Ln, PostfixOp::Sin, PostfixOp::Cos, PostfixOp::Tan,
+      PostfixOp::Asin, PostfixOp::Acos, PostfixOp::Atan2}) {
+    SCOPED_TRACE(int(op));
+    ExpectBatchMatches(Op(op), 4);
+  }
+}
+
+TEST(BatchEvalTest, VectorOps) {
+  ExpectBatchMatches(Op(PostfixOp::PolyVec, {3 << 1}), 5);
+  ExpectBatchMatches(Op(PostfixOp::PolyVec, {3 << 1 | 1}, {1, 2, 3}), 1);
+  ExpectBatchMatches(Op(PostfixOp::PolyMat, {3, 2 << 1}), 8);
+  ExpectBatchMatches(Op(PostfixOp::PolyMat, {2, 3 << 1 | 1}, {1, 2, 3, 4, 5, 6}), 1);
+  ExpectBatchMatches(Op(PostfixOp::AddVec, {2 << 1}), 5);
+  ExpectBatchMatches(Op(PostfixOp::SubVec, {2 << 1 | 1}, {1, 2}), 3);
+  ExpectBatchMatches(Op(PostfixOp::MulVec, {2 << 1}), 5);
+  ExpectBatchMatches(Op(PostfixOp::MulAddVec, {2 << 2}), 7);
+  ExpectBatchMatches(Op(PostfixOp::MulAddVec, {2 << 2 | 2}, {1, 2, 3, 4}), 3);
+  ExpectBatchMatches(Op(PostfixOp::ScaleVec, {3 << 1}), 5);
+  ExpectBatchMatches(Op(PostfixOp::NegVec, {3 << 1}), 4);
+  ExpectBatchMatches(Op(PostfixOp::NormVec, {3 << 1}), 4);
+  ExpectBatchMatches(Op(PostfixOp::MulMat, {2, 3, 2 << 1}), 13);
+  ExpectBatchMatches(Op(PostfixOp::MulMat, {1, 2, 2 << 1 | 1}, {1, 2, 3, 4}), 3);
+  ExpectBatchMatches(Op(PostfixOp::Lerp, {2 << 2}), 6);
+  ExpectBatchMatches(Op(PostfixOp::Lerp, {2 << 2 | 2}, {1, 2, 3, 4}), 2);
+}
+
+TEST(BatchEvalTest, Lut) {
+  // Lane inputs span 0.1 to 0.59, covering both clamped ends and the
+  // interpolated rows.
+  ExpectBatchMatches(
+      Op(PostfixOp::Lut, {3, 3 << 1 | 1}, {0.2f, 1, 2, 0.3f, 5, 3, 0.5f, -1, 0}), 1);
+}
+
+TEST(BatchEvalTest, Fused) {
+  PostfixWriter writer;
+  writer.Push({2});
+  writer.add_op(PostfixOp::Mul);
+  writer.Push({0.5f});
+  writer.add_op(PostfixOp::Sub);
+  writer.add_op(PostfixOp::Dup);
+  writer.add_i(0);
+  writer.add_op(PostfixOp::Mul);
+  writer.Push({1, 2});
+  writer.add_op(PostfixOp::RotL);
+  writer.add_i(3);
+  writer.add_op(PostfixOp::ScaleVec);
+  writer.add_i(2 << 1 | 1);
+  writer.add_f(3);
+  writer.add_f(4);
+  writer.add_op(PostfixOp::AddVec);
+  writer.add_i(2 << 1);
+  ExpectBatchMatches(writer, 1, true);
+}
+
+TEST(BatchEvalTest, StackOverflow) {
+  PostfixProgram program;
+  ASSERT_EQ(program.Verify(Op(PostfixOp::Push, {2}, {5, 6}), 1), EvalStatus::Ok);
+
+  TestBatchStack batch;
+  batch.stack_capacity = 2;
+  batch.stack_size = 1;
+  EXPECT_EQ(batch.Eval(program), EvalStatus::StackOverflow);
+
+  // A stack already past its capacity.
+  PostfixProgram identity;
+  ASSERT_EQ(identity.Verify(PostfixWriter(), 1), EvalStatus::Ok);
+  batch.stack_capacity = 0;
+  EXPECT_EQ(batch.Eval(identity), EvalStatus::StackOverflow);
+}
+
+}
+}
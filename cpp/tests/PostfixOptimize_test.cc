@@ -0,0 +1,212 @@
+#include <WickedWinchProtocol/PostfixOptimize.h>
+#include <WickedWinchProtocol/Postfix.h>
+
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::ElementsAre;
+using ::testing::FloatEq;
+using ::testing::Pointwise;
+
+namespace wickedwinch::protocol {
+namespace {
+
+struct TestStack : PostfixStack {
+  float buffer[64];
+
+  TestStack() {
+    stack_data = buffer;
+    stack_size = 0;
+    stack_capacity = std::size(buffer);
+  }
+};
+
+std::vector<float> Eval(const PostfixWriter& writer, std::initializer_list<float> inputs) {
+  TestStack stack;
+  for (float v : inputs) stack.push(v);
+  EXPECT_EQ(stack.Eval(writer), EvalStatus::Ok);
+  return std::vector<float>(stack.begin(), stack.end());
+}
+
+// Optimizes the expression and checks that both versions give the same
+// stack for a few input stacks.
+PostfixWriter ExpectOptimizedMatches(
+    const PostfixWriter& writer, size_t input_size, PostfixOptimizeStats* stats = nullptr) {
+  PostfixWriter optimized;
+  EXPECT_EQ(OptimizePostfix(writer, input_size, optimized, stats), EvalStatus::Ok);
+  EXPECT_LE(optimized.data_size(), writer.data_size());
+  for (float t : {0.1f, 0.5f, 0.9f}) {
+    TestStack a, b;
+    for (size_t k = 0; k < input_size; ++k) {
+      a.push(t + k);
+      b.push(t + k);
+    }
+    EXPECT_EQ(a.Eval(writer), EvalStatus::Ok);
+    EXPECT_EQ(b.Eval(optimized), EvalStatus::Ok);
+    EXPECT_THAT(std::vector<float>(b.begin(), b.end()),
+                Pointwise(FloatEq(), std::vector<float>(a.begin(), a.end())));
+  }
+  return optimized;
+}
+
+TEST(OptimizeTest, FoldsScalars) {
+  PostfixWriter writer;
+  writer.Push({2});
+  writer.Push({3});
+  writer.add_op(PostfixOp::Mul);
+  writer.add_op(PostfixOp::Sqrt);
+  writer.add_op(PostfixOp::Add);
+
+  PostfixOptimizeStats stats;
+  PostfixWriter optimized = ExpectOptimizedMatches(writer, 1, &stats);
+  EXPECT_THAT(std::vector(optimized.op_data(), optimized.op_data() + optimized.op_size()),
+              ElementsAre(PostfixOp::Push, PostfixOp::Add));
+  EXPECT_EQ(optimized.f_size(), 1);
+  EXPECT_THAT(Eval(optimized, {1}), ElementsAre(FloatEq(1 + std::sqrt(6.0f))));
+  EXPECT_EQ(stats.input_ops, 5);
+  EXPECT_EQ(stats.output_ops, 2);
+  EXPECT_EQ(stats.folded_ops, 2);
+}
+
+TEST(OptimizeTest, DropsPoppedPushes) {
+  PostfixWriter writer;
+  writer.Push({1, 2, 3});
+  writer.Pop(2);
+  writer.add_op(PostfixOp::Add);
+  writer.Push({4});
+  writer.Pop(2);
+
+  PostfixOptimizeStats stats;
+  PostfixWriter optimized = ExpectOptimizedMatches(writer, 2, &stats);
+  EXPECT_THAT(std::vector(optimized.op_data(), optimized.op_data() + optimized.op_size()),
+              ElementsAre(PostfixOp::Push, PostfixOp::Add, PostfixOp::Pop));
+  EXPECT_EQ(optimized.f_size(), 1);
+  EXPECT_EQ(stats.dropped_values, 3);
+}
+
+TEST(OptimizeTest, RemovesNoOps) {
+  PostfixWriter writer;
+  writer.add_op(PostfixOp::RotL);
+  writer.add_i(1);
+  writer.add_op(PostfixOp::Rev);
+  writer.add_i(0);
+  writer.Pop(0);
+  writer.add_op(PostfixOp::Neg);
+
+  PostfixWriter optimized = ExpectOptimizedMatches(writer, 1);
+  EXPECT_EQ(optimized.op_size(), 1);
+}
+
+TEST(OptimizeTest, FoldsStackOps) {
+  PostfixWriter writer;
+  writer.Push({1, 2, 3});
+  writer.add_op(PostfixOp::Dup);
+  writer.add_i(2);
+  writer.add_op(PostfixOp::RotL);
+  writer.add_i(4);
+  writer.add_op(PostfixOp::AddVec);
+  writer.add_i(2 << 1);
+
+  PostfixWriter optimized = ExpectOptimizedMatches(writer, 1);
+  EXPECT_EQ(optimized.op_size(), 1);
+  EXPECT_THAT(Eval(optimized, {0}), ElementsAre(0, 2 + 1, 3 + 1));
+}
+
+TEST(OptimizeTest, FoldsVectorOps) {
+  PostfixWriter writer;
+  writer.Push({2});
+  writer.add_op(PostfixOp::ScaleVec);
+  writer.add_i(3 << 1 | 1);
+  writer.add_f(1);
+  writer.add_f(2);
+  writer.add_f(3);
+  writer.add_op(PostfixOp::MulMat);
+  writer.add_i(1);
+  writer.add_i(3);
+  writer.add_i(1 << 1 | 1);
+  writer.add_f(1);
+  writer.add_f(1);
+  writer.add_f(1);
+
+  PostfixWriter optimized = ExpectOptimizedMatches(writer, 1);
+  EXPECT_EQ(optimized.op_size(), 1);
+  EXPECT_THAT(Eval(optimized, {0}), ElementsAre(0, 12));
+}
+
+TEST(OptimizeTest, PushesLiteralsImplicitly) {
+  // The folded vector becomes the implicit operand of the time dependent
+  // MulAddVec.
+  PostfixWriter writer;
+  writer.Push({1, 2});
+  writer.Push({3, 4});
+  writer.add_op(PostfixOp::AddVec);
+  writer.add_i(2 << 1);
+  writer.add_op(PostfixOp::MulAddVec);
+  writer.add_i(2 << 2);
+
+  PostfixWriter optimized = ExpectOptimizedMatches(writer, 4);
+  EXPECT_THAT(std::vector(optimized.op_data(), optimized.op_data() + optimized.op_size()),
+              ElementsAre(PostfixOp::MulAddVec));
+  EXPECT_THAT(std::vector(optimized.i_data(), optimized.i_data() + optimized.i_size()),
+              ElementsAre(2 << 2 | 1));
+}
+
+TEST(OptimizeTest, FlushesPartialOperands) {
+  // Only the top of Lerp's operands is known, so the rest stays a Push.
+  PostfixWriter writer;
+  writer.Push({1, 2});
+  writer.Push({3});
+  writer.add_op(PostfixOp::Neg);
+  writer.add_op(PostfixOp::Lerp);
+  writer.add_i(1 << 2);
+
+  ExpectOptimizedMatches(writer, 2);
+}
+
+TEST(OptimizeTest, KeepsTimeDependentOps) {
+  PostfixWriter writer;
+  writer.add_op(PostfixOp::Dup);
+  writer.add_i(0);
+  writer.add_op(PostfixOp::Mul);
+  writer.add_op(PostfixOp::PolyVec);
+  writer.add_i(3 << 1 | 1);
+  writer.add_f(1);
+  writer.add_f(2);
+  writer.add_f(3);
+  writer.add_op(PostfixOp::Sin);
+
+  PostfixOptimizeStats stats;
+  PostfixWriter optimized = ExpectOptimizedMatches(writer, 1, &stats);
+  EXPECT_EQ(optimized.op_size(), writer.op_size());
+  EXPECT_EQ(optimized.i_size(), writer.i_size());
+  EXPECT_EQ(optimized.f_size(), writer.f_size());
+  EXPECT_EQ(stats.folded_ops, 0);
+}
+
+TEST(OptimizeTest, KeepsOriginalWhenLarger) {
+  // Duplicating a literal many times is smaller as Dup ops than as literals.
+  PostfixWriter writer;
+  writer.Push({1});
+  for (int i = 0; i < 40; ++i) {
+    writer.add_op(PostfixOp::Dup);
+    writer.add_i(0);
+  }
+
+  PostfixOptimizeStats stats;
+  PostfixWriter optimized = ExpectOptimizedMatches(writer, 0, &stats);
+  EXPECT_EQ(optimized.op_size(), writer.op_size());
+  EXPECT_EQ(stats.folded_ops, 0);
+}
+
+TEST(OptimizeTest, RejectsInvalid) {
+  PostfixWriter writer;
+  writer.add_op(PostfixOp::Add);
+
+  PostfixWriter optimized;
+  EXPECT_EQ(OptimizePostfix(writer, 1, optimized), EvalStatus::StackUnderflow);
+}
+
+}
+}
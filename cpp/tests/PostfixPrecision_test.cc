@@ -0,0 +1,156 @@
+#include <WickedWinchProtocol/PostfixBatch.h>
+#include <WickedWinchProtocol/PostfixProgram.h>
+#include <WickedWinchProtocol/Postfix.h>
+
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace wickedwinch::protocol {
+namespace {
+
+struct TestStack : PostfixStack {
+  float buffer[8];
+
+  TestStack() {
+    stack_data = buffer;
+    stack_size = 0;
+    stack_capacity = std::size(buffer);
+  }
+};
+
+float Eval(PostfixOp op, std::initializer_list<float> inputs, PostfixPrecision precision) {
+  PostfixWriter writer;
+  writer.add_op(op);
+  TestStack stack;
+  for (float v : inputs) stack.push(v);
+  EXPECT_EQ(stack.Eval(writer, precision), EvalStatus::Ok);
+  EXPECT_EQ(stack.stack_size, 1);
+  return stack[0];
+}
+
+float Fast(PostfixOp op, std::initializer_list<float> inputs) {
+  return Eval(op, inputs, PostfixPrecision::Fast);
+}
+
+double RelativeError(float actual, double expected) {
+  return std::abs(actual - expected) / std::abs(expected);
+}
+
+TEST(FastPrecisionTest, Exp) {
+  double max = 0;
+  for (float x = -86; x < 88; x += 0.0173f) {
+    max = std::max(max, RelativeError(Fast(PostfixOp::Exp, {x}), std::exp(double(x))));
+  }
+  EXPECT_LT(max, 1e-5);
+}
+
+TEST(FastPrecisionTest, Ln) {
+  double max = 0;
+  for (float x = 1e-37f; x < 1e37f; x *= 1.0171f) {
+    if (x == 1) continue;
+    max = std::max(max, RelativeError(Fast(PostfixOp::Ln, {x}), std::log(double(x))));
+  }
+  EXPECT_LT(max, 1e-5);
+}
+
+TEST(FastPrecisionTest, Pow) {
+  for (float a = 0.01f; a < 100; a *= 1.07f) {
+    for (float b = -8; b < 8; b += 0.37f) {
+      double expected = std::pow(double(a), double(b));
+      double bound = 1e-5 * std::max(1.0, std::abs(b * std::log(double(a))));
+      EXPECT_LT(RelativeError(Fast(PostfixOp::Pow, {a, b}), expected), bound) << a << "^" << b;
+    }
+  }
+}
+
+TEST(FastPrecisionTest, Trigonometric) {
+  double sin_max = 0, cos_max = 0, tan_max = 0;
+  for (float x = -8000; x < 8000; x += 0.731f) {
+    sin_max = std::max(sin_max, std::abs(Fast(PostfixOp::Sin, {x}) - std::sin(double(x))));
+    cos_max = std::max(cos_max, std::abs(Fast(PostfixOp::Cos, {x}) - std::cos(double(x))));
+    double tan = std::tan(double(x));
+    if (std::abs(tan) < 1e3) {
+      tan_max = std::max(tan_max, RelativeError(Fast(PostfixOp::Tan, {x}), tan));
+    }
+  }
+  EXPECT_LT(sin_max, 1e-6);
+  EXPECT_LT(cos_max, 1e-6);
+  EXPECT_LT(tan_max, 1e-5);
+}
+
+TEST(FastPrecisionTest, InverseTrigonometric) {
+  double asin_max = 0, acos_max = 0;
+  for (float x = -1; x <= 1; x += 0.000731f) {
+    if (x != 0) {
+      asin_max = std::max(asin_max, RelativeError(Fast(PostfixOp::Asin, {x}), std::asin(double(x))));
+    }
+    acos_max = std::max(acos_max, RelativeError(Fast(PostfixOp::Acos, {x}), std::acos(double(x))));
+  }
+  EXPECT_LT(asin_max, 1e-5);
+  EXPECT_LT(acos_max, 1e-5);
+
+  double atan2_max = 0;
+  for (float a = -3.14f; a < 3.14f; a += 0.00371f) {
+    for (float r : {1e-3f, 1.0f, 1e4f}) {
+      float y = r * std::sin(a);
+      float x = r * std::cos(a);
+      atan2_max = std::max(atan2_max, RelativeError(Fast(PostfixOp::Atan2, {y, x}), std::atan2(double(y), double(x))));
+    }
+  }
+  EXPECT_LT(atan2_max, 1e-5);
+}
+
+TEST(FastPrecisionTest, EdgeCasesMatchExact) {
+  float inf = std::numeric_limits<float>::infinity();
+  float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<std::pair<PostfixOp, std::vector<float>>> cases = {
+    {PostfixOp::Exp, {inf}}, {PostfixOp::Exp, {-inf}}, {PostfixOp::Exp, {100}}, {PostfixOp::Exp, {-100}},
+    {PostfixOp::Ln, {0}}, {PostfixOp::Ln, {-1}}, {PostfixOp::Ln, {inf}}, {PostfixOp::Ln, {1e-40f}},
+    {PostfixOp::Pow, {-2, 3}}, {PostfixOp::Pow, {0, 2}}, {PostfixOp::Pow, {2, inf}},
+    {PostfixOp::Sin, {inf}}, {PostfixOp::Sin, {1e6f}}, {PostfixOp::Cos, {-1e6f}}, {PostfixOp::Tan, {1e6f}},
+    {PostfixOp::Asin, {2}}, {PostfixOp::Acos, {-2}},
+    {PostfixOp::Atan2, {0, 0}}, {PostfixOp::Atan2, {0, -1}}, {PostfixOp::Atan2, {inf, 1}}, {PostfixOp::Atan2, {nan, 1}},
+  };
+  for (const auto& [op, inputs] : cases) {
+    SCOPED_TRACE(testing::Message() << int(op) << " " << inputs[0]);
+    auto eval = [&](PostfixPrecision precision) {
+      return inputs.size() == 1 ? Eval(op, {inputs[0]}, precision) : Eval(op, {inputs[0], inputs[1]}, precision);
+    };
+    float exact = eval(PostfixPrecision::Exact);
+    float fast = eval(PostfixPrecision::Fast);
+    if (std::isnan(exact)) {
+      EXPECT_TRUE(std::isnan(fast));
+    } else {
+      EXPECT_EQ(fast, exact);
+    }
+  }
+}
+
+TEST(FastPrecisionTest, BatchMatchesScalar) {
+  PostfixWriter writer;
+  writer.add_op(PostfixOp::Sin);
+  writer.add_op(PostfixOp::Exp);
+  writer.Push({0.5f});
+  writer.add_op(PostfixOp::Atan2);
+  PostfixProgram program;
+  ASSERT_EQ(program.Verify(writer, 1), EvalStatus::Ok);
+
+  float buffer[8 * kBatchLanes];
+  PostfixBatchStack batch{buffer, 1, 8};
+  for (size_t l = 0; l < kBatchLanes; ++l) batch.slot(0)[l] = 0.3f * l - 1;
+  ASSERT_EQ(batch.Eval(program, PostfixPrecision::Fast), EvalStatus::Ok);
+
+  for (size_t l = 0; l < kBatchLanes; ++l) {
+    TestStack stack;
+    stack.push(0.3f * l - 1);
+    ASSERT_EQ(stack.Eval(program, PostfixPrecision::Fast), EvalStatus::Ok);
+    EXPECT_EQ(batch.slot(0)[l], stack[0]) << "lane " << l;
+  }
+}
+
+}
+}
@@ -0,0 +1,360 @@
+#include <WickedWinchProtocol/PostfixProgram.h>
+#include <WickedWinchProtocol/Postfix.h>
+
+#include <cmath>
+#include <span>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+
+namespace wickedwinch::protocol {
+namespace {
+
+struct TestStack : PostfixStack {
+  TestStack(size_t capacity, std::initializer_list<float> values) {
+    assert(capacity >= values.size());
+    stack_data = new float[capacity];
+    stack_size = values.size();
+    stack_capacity = capacity;
+    float* v = stack_data;
+    for (float value : values) {
+      *v++ = value;
+    }
+  }
+
+  ~TestStack() {
+    delete[] stack_data;
+  }
+};
+
+// Evaluates expr both checked and as a fused program from the input t.
+void ExpectFusedMatches(const PostfixWriter& writer, float t) {
+  PostfixProgram program;
+  ASSERT_EQ(program.Verify(writer, 1), EvalStatus::Ok);
+  program.Fuse();
+
+  TestStack checked(16, {t});
+  EXPECT_EQ(checked.Eval(writer), EvalStatus::Ok);
+  TestStack fused(16, {t});
+  EXPECT_EQ(fused.Eval(program), EvalStatus::Ok);
+  EXPECT_THAT(fused, ElementsAreArray(checked.begin(), checked.end()));
+}
+
+TEST(VerifyTest, Empty) {
+  PostfixWriter writer;
+
+  PostfixProgram program;
+  EXPECT_EQ(program.Verify(writer, 1), EvalStatus::Ok);
+  EXPECT_TRUE(program.verified());
+  EXPECT_EQ(program.input_size(), 1);
+  EXPECT_EQ(program.max_stack_size(), 1);
+  EXPECT_EQ(program.output_size(), 1);
+}
+
+TEST(VerifyTest, StackSizes) {
+  PostfixWriter writer;
+  writer.Push({1, 2, 3});
+  writer.add_op(PostfixOp::MulAdd);
+  writer.add_op(PostfixOp::Add);
+
+  PostfixProgram program;
+  EXPECT_EQ(program.Verify(writer, 1), EvalStatus::Ok);
+  EXPECT_EQ(program.max_stack_size(), 4);
+  EXPECT_EQ(program.output_size(), 1);
+}
+
+TEST(VerifyTest, ImplicitPush) {
+  PostfixWriter writer;
+  writer.add_op(PostfixOp::PolyMat);
+  writer.add_i(2);
+  writer.add_i(3 << 1 | 1);
+  for (int i = 0; i < 6; ++i) writer.add_f(i);
+
+  PostfixProgram program;
+  EXPECT_EQ(program.Verify(writer, 1), EvalStatus::Ok);
+  EXPECT_EQ(program.max_stack_size(), 7);
+  EXPECT_EQ(program.output_size(), 3);
+}
+
+TEST(VerifyTest, StackUnderflow) {
+  PostfixWriter writer;
+  writer.add_op(PostfixOp::Add);
+
+  PostfixProgram program;
+  EXPECT_EQ(program.Verify(writer, 1), EvalStatus::StackUnderflow);
+  EXPECT_FALSE(program.verified());
+  EXPECT_EQ(program.Verify(writer, 2), EvalStatus::Ok);
+}
+
+TEST(VerifyTest, DupStackUnderflow) {
+  PostfixWriter writer;
+  writer.add_op(PostfixOp::Dup);
+  writer.add_i(0);
+
+  PostfixProgram program;
+  EXPECT_EQ(program.Verify(writer, 0), EvalStatus::StackUnderflow);
+}
+
+TEST(VerifyTest, IntUnderflow) {
+  PostfixWriter writer;
+  writer.add_op(PostfixOp::Pop);
+
+  PostfixProgram program;
+  EXPECT_EQ(program.Verify(writer, 1), EvalStatus::IntLiteralsUnderflow);
+}
+
+TEST(VerifyTest, FloatUnderflow) {
+  PostfixWriter writer;
+  writer.add_op(PostfixOp::AddVec);
+  writer.add_i(2 << 1 | 1);
+  writer.add_f(1);
+
+  PostfixProgram program;
+  EXPECT_EQ(program.Verify(writer, 2), EvalStatus::FloatLiteralsUnderflow);
+}
+
+TEST(VerifyTest, UndefinedOperation) {
+  PostfixWriter writer;
+  writer.add_op(PostfixOp::Undefined);
+
+  PostfixProgram program;
+  EXPECT_EQ(program.Verify(writer, 1), EvalStatus::UndefinedOperation);
+}
+
+TEST(VerifyTest, IllegalOperation) {
+  PostfixWriter writer;
+  writer.add_op(PostfixOp::Lut);
+  writer.add_i(0);
+  writer.add_i(2);
+
+  PostfixProgram program;
+  EXPECT_EQ(program.Verify(writer, 1), EvalStatus::IllegalOperation);
+}
+
+TEST(DecodeTest, Operands) {
+  PostfixWriter writer;
+  writer.Push({1, 2});
+  writer.add_op(PostfixOp::Transpose);
+  writer.add_i(1);
+  writer.add_i(2 << 1 | 1);
+  writer.add_f(3);
+  writer.add_f(4);
+  writer.add_op(PostfixOp::MulMat);
+  writer.add_i(2);
+  writer.add_i(1);
+  writer.add_i(1 << 1);
+
+  PostfixProgram program;
+  EXPECT_EQ(program.Verify(writer, 0), EvalStatus::Ok);
+  ASSERT_EQ(program.instrs().size(), 3);
+
+  const PostfixInstr& push = program.instrs()[0];
+  EXPECT_EQ(push.op, PostfixOp::Push);
+  EXPECT_EQ(push.f_offset, 0);
+  EXPECT_EQ(push.f_size, 2);
+
+  const PostfixInstr& transpose = program.instrs()[1];
+  EXPECT_EQ(transpose.op, PostfixOp::Transpose);
+  EXPECT_EQ(transpose.arg[0], 1);
+  EXPECT_EQ(transpose.arg[1], 2);
+  EXPECT_EQ(transpose.f_offset, 2);
+  EXPECT_EQ(transpose.f_size, 2);
+
+  const PostfixInstr& mulmat = program.instrs()[2];
+  EXPECT_EQ(mulmat.op, PostfixOp::MulMat);
+  EXPECT_EQ(mulmat.arg[0], 2);
+  EXPECT_EQ(mulmat.arg[1], 1);
+  EXPECT_EQ(mulmat.arg[2], 1);
+  EXPECT_EQ(mulmat.f_size, 0);
+}
+
+TEST(FuseTest, ConstOps) {
+  PostfixWriter writer;
+  writer.Push({2});
+  writer.add_op(PostfixOp::Mul);
+  writer.Push({1});
+  writer.add_op(PostfixOp::Add);
+  writer.Push({4});
+  writer.add_op(PostfixOp::Sub);
+  writer.Push({8});
+  writer.add_op(PostfixOp::Div);
+
+  PostfixProgram program;
+  ASSERT_EQ(program.Verify(writer, 1), EvalStatus::Ok);
+  PostfixFusionStats stats = program.Fuse();
+  EXPECT_EQ(stats.input_instrs, 8);
+  EXPECT_EQ(stats.output_instrs, 4);
+  EXPECT_EQ(stats.const_ops, 4);
+  EXPECT_EQ(program.instrs()[0].op, PostfixOp::MulConst);
+  EXPECT_EQ(program.instrs()[1].op, PostfixOp::AddConst);
+  EXPECT_EQ(program.instrs()[2].op, PostfixOp::SubConst);
+  EXPECT_EQ(program.instrs()[3].op, PostfixOp::DivConst);
+
+  ExpectFusedMatches(writer, 3);
+}
+
+TEST(FuseTest, PushBeforeConstOp) {
+  PostfixWriter writer;
+  writer.Push({5});
+  writer.Push({2});
+  writer.add_op(PostfixOp::Mul);
+  writer.add_op(PostfixOp::Add);
+
+  PostfixProgram program;
+  ASSERT_EQ(program.Verify(writer, 1), EvalStatus::Ok);
+  PostfixFusionStats stats = program.Fuse();
+  EXPECT_EQ(stats.merged_pushes, 0);
+  EXPECT_EQ(stats.const_ops, 1);
+  ASSERT_EQ(program.instrs().size(), 3);
+  EXPECT_EQ(program.instrs()[0].op, PostfixOp::Push);
+  EXPECT_EQ(program.instrs()[1].op, PostfixOp::MulConst);
+
+  ExpectFusedMatches(writer, 3);
+}
+
+TEST(FuseTest, Square) {
+  PostfixWriter writer;
+  writer.add_op(PostfixOp::Dup);
+  writer.add_i(0);
+  writer.add_op(PostfixOp::Mul);
+
+  PostfixProgram program;
+  ASSERT_EQ(program.Verify(writer, 1), EvalStatus::Ok);
+  PostfixFusionStats stats = program.Fuse();
+  EXPECT_EQ(stats.squares, 1);
+  ASSERT_EQ(program.instrs().size(), 1);
+  EXPECT_EQ(program.instrs()[0].op, PostfixOp::Square);
+
+  ExpectFusedMatches(writer, -3);
+}
+
+TEST(FuseTest, MergedPushes) {
+  PostfixWriter writer;
+  writer.Push({1});
+  writer.Push({2, 3});
+  writer.add_op(PostfixOp::PolyVec);
+  writer.add_i(3 << 1);
+
+  PostfixProgram program;
+  ASSERT_EQ(program.Verify(writer, 1), EvalStatus::Ok);
+  PostfixFusionStats stats = program.Fuse();
+  EXPECT_EQ(stats.merged_pushes, 2);
+  ASSERT_EQ(program.instrs().size(), 1);
+  EXPECT_EQ(program.instrs()[0].op, PostfixOp::PolyVec);
+  EXPECT_EQ(program.instrs()[0].f_size, 3);
+
+  ExpectFusedMatches(writer, 2);
+}
+
+TEST(FuseTest, Axpy) {
+  PostfixWriter writer;
+  writer.Push({1, 2});
+  writer.add_op(PostfixOp::RotL);
+  writer.add_i(3);
+  writer.add_op(PostfixOp::ScaleVec);
+  writer.add_i(2 << 1 | 1);
+  writer.add_f(4);
+  writer.add_f(5);
+  writer.add_op(PostfixOp::AddVec);
+  writer.add_i(2 << 1);
+
+  PostfixProgram program;
+  ASSERT_EQ(program.Verify(writer, 1), EvalStatus::Ok);
+  PostfixFusionStats stats = program.Fuse();
+  EXPECT_EQ(stats.axpys, 1);
+  ASSERT_EQ(program.instrs().size(), 3);
+  EXPECT_EQ(program.instrs()[2].op, PostfixOp::Axpy);
+
+  TestStack stack(8, {10, 20});
+  EXPECT_EQ(stack.Eval(program), EvalStatus::Ok);
+  EXPECT_THAT(stack, ElementsAre(10, 1 + 20 * 4, 2 + 20 * 5));
+}
+
+TEST(FuseTest, SerializedSuperinstruction) {
+  PostfixWriter writer;
+  writer.add_op(PostfixOp::Square);
+
+  PostfixProgram program;
+  EXPECT_EQ(program.Verify(writer, 1), EvalStatus::UndefinedOperation);
+
+  TestStack stack(4, {2});
+  EXPECT_EQ(stack.Eval(writer), EvalStatus::UndefinedOperation);
+}
+
+TEST(ProgramEvalTest, MatchesChecked) {
+  PostfixWriter writer;
+  writer.Push({2});
+  writer.add_op(PostfixOp::Mul);
+  writer.add_op(PostfixOp::Lut);
+  writer.add_i(3);
+  writer.add_i(3 << 1 | 1);
+  for (float f : {0, 0, 10, 1, 10, 20, 4, 40, 0}) writer.add_f(f);
+  writer.add_op(PostfixOp::Transpose);
+  writer.add_i(1);
+  writer.add_i(2 << 1);
+
+  PostfixReader reader;
+  auto buffer = writer.Write();
+  EXPECT_TRUE(reader.Read(buffer));
+
+  PostfixProgram program;
+  EXPECT_EQ(program.Verify(reader, 1), EvalStatus::Ok);
+
+  for (float t : {-1.0f, 0.25f, 1.0f, 3.0f}) {
+    TestStack checked(16, {t});
+    EXPECT_EQ(checked.Eval(reader), EvalStatus::Ok);
+    TestStack unchecked(16, {t});
+    EXPECT_EQ(unchecked.Eval(program), EvalStatus::Ok);
+    EXPECT_THAT(unchecked, ElementsAreArray(checked.begin(), checked.end()));
+    EXPECT_EQ(unchecked.size(), program.output_size());
+  }
+}
+
+TEST(ProgramEvalTest, ExtraStack) {
+  PostfixWriter writer;
+  writer.add_op(PostfixOp::Add);
+
+  PostfixProgram program;
+  EXPECT_EQ(program.Verify(writer, 2), EvalStatus::Ok);
+
+  TestStack stack(4, {1, 2, 3});
+  EXPECT_EQ(stack.Eval(program), EvalStatus::Ok);
+  EXPECT_THAT(stack, ElementsAre(1, 5));
+}
+
+TEST(ProgramEvalTest, StackUnderflow) {
+  PostfixWriter writer;
+  writer.add_op(PostfixOp::Add);
+
+  PostfixProgram program;
+  EXPECT_EQ(program.Verify(writer, 2), EvalStatus::Ok);
+
+  TestStack stack(4, {1});
+  EXPECT_EQ(stack.Eval(program), EvalStatus::StackUnderflow);
+}
+
+TEST(ProgramEvalTest, StackOverflow) {
+  PostfixWriter writer;
+  writer.Push({1, 2, 3});
+
+  PostfixProgram program;
+  EXPECT_EQ(program.Verify(writer, 1), EvalStatus::Ok);
+
+  TestStack stack(3, {0});
+  EXPECT_EQ(stack.Eval(program), EvalStatus::StackOverflow);
+  EXPECT_THAT(stack, ElementsAre(0));
+}
+
+TEST(ProgramEvalTest, Unverified) {
+  PostfixProgram program;
+
+  TestStack stack(4, {0});
+  EXPECT_EQ(stack.Eval(program), EvalStatus::IllegalOperation);
+}
+
+}
+}
@@ -0,0 +1,160 @@
+#include <WickedWinchProtocol/PostfixBatch.h>
+#include <WickedWinchProtocol/PostfixProgram.h>
+#include <WickedWinchProtocol/Postfix.h>
+
+#include <cstdlib>
+#include <new>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::ElementsAre;
+
+// Counts heap allocations made while counting is enabled.
+static bool counting = false;
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+  if (counting) ++allocations;
+  if (void* p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace wickedwinch::protocol {
+namespace {
+
+struct CountAllocations {
+  CountAllocations() { allocations = 0; counting = true; }
+  ~CountAllocations() { counting = false; }
+};
+
+struct TestStack : PostfixStack {
+  float buffer[32];
+
+  TestStack(size_t capacity, std::initializer_list<float> values) {
+    stack_data = buffer;
+    stack_size = 0;
+    stack_capacity = capacity;
+    for (float value : values) push(value);
+  }
+};
+
+PostfixReader Read(const PostfixWriter& writer, std::vector<uint8_t>& buffer) {
+  PostfixReader reader;
+  buffer = writer.Write();
+  EXPECT_TRUE(reader.Read(buffer));
+  return reader;
+}
+
+PostfixWriter TransposeExpr() {
+  PostfixWriter writer;
+  writer.add_op(PostfixOp::Transpose);
+  writer.add_i(2);
+  writer.add_i(3 << 1);
+  return writer;
+}
+
+PostfixWriter MulMatExpr() {
+  PostfixWriter writer;
+  writer.add_op(PostfixOp::MulMat);
+  writer.add_i(2);
+  writer.add_i(2);
+  writer.add_i(2 << 1 | 1);
+  writer.add_f(1);
+  writer.add_f(2);
+  writer.add_f(3);
+  writer.add_f(4);
+  return writer;
+}
+
+TEST(ScratchTest, TransposeUsesHeadroom) {
+  std::vector<uint8_t> buffer;
+  PostfixReader reader = Read(TransposeExpr(), buffer);
+
+  TestStack stack(32, {0, 1, 2, 3, 4, 5, 6});
+  {
+    CountAllocations count;
+    EXPECT_EQ(stack.Eval(reader), EvalStatus::Ok);
+  }
+  EXPECT_EQ(allocations, 0);
+  EXPECT_THAT(stack, ElementsAre(0, 1, 4, 2, 5, 3, 6));
+}
+
+TEST(ScratchTest, MulMatUsesHeadroom) {
+  std::vector<uint8_t> buffer;
+  PostfixReader reader = Read(MulMatExpr(), buffer);
+
+  TestStack stack(32, {0, 1, 2, 3, 4});
+  {
+    CountAllocations count;
+    EXPECT_EQ(stack.Eval(reader), EvalStatus::Ok);
+  }
+  EXPECT_EQ(allocations, 0);
+  EXPECT_THAT(stack, ElementsAre(0, 1*1 + 2*3, 1*2 + 2*4, 3*1 + 4*3, 3*2 + 4*4));
+}
+
+TEST(ScratchTest, TightStackUsesArena) {
+  std::vector<uint8_t> buffer;
+  PostfixReader reader = Read(MulMatExpr(), buffer);
+
+  float arena[4];
+  TestStack stack(9, {0, 1, 2, 3, 4});
+  stack.scratch_data = arena;
+  stack.scratch_capacity = std::size(arena);
+  {
+    CountAllocations count;
+    EXPECT_EQ(stack.Eval(reader), EvalStatus::Ok);
+  }
+  EXPECT_EQ(allocations, 0);
+  EXPECT_THAT(stack, ElementsAre(0, 1*1 + 2*3, 1*2 + 2*4, 3*1 + 4*3, 3*2 + 4*4));
+}
+
+TEST(ScratchTest, TightStackWithoutArena) {
+  std::vector<uint8_t> buffer;
+  PostfixReader reader = Read(MulMatExpr(), buffer);
+
+  TestStack stack(9, {0, 1, 2, 3, 4});
+  EXPECT_EQ(stack.Eval(reader), EvalStatus::Ok);
+  EXPECT_THAT(stack, ElementsAre(0, 1*1 + 2*3, 1*2 + 2*4, 3*1 + 4*3, 3*2 + 4*4));
+}
+
+TEST(ScratchTest, VerifiedProgramReservesScratch) {
+  PostfixWriter writer = MulMatExpr();
+  PostfixProgram program;
+  ASSERT_EQ(program.Verify(writer, 5), EvalStatus::Ok);
+  EXPECT_EQ(program.max_stack_size(), 5 + 4 + 4);
+
+  TestStack stack(program.max_stack_size(), {0, 1, 2, 3, 4});
+  {
+    CountAllocations count;
+    EXPECT_EQ(stack.Eval(program), EvalStatus::Ok);
+  }
+  EXPECT_EQ(allocations, 0);
+  EXPECT_THAT(stack, ElementsAre(0, 1*1 + 2*3, 1*2 + 2*4, 3*1 + 4*3, 3*2 + 4*4));
+
+  TestStack tight(program.max_stack_size() - 1, {0, 1, 2, 3, 4});
+  EXPECT_EQ(tight.Eval(program), EvalStatus::StackOverflow);
+}
+
+TEST(ScratchTest, BatchTransposeDoesNotAllocate) {
+  PostfixProgram program;
+  ASSERT_EQ(program.Verify(TransposeExpr(), 7), EvalStatus::Ok);
+
+  float data[16 * kBatchLanes] = {};
+  PostfixBatchStack batch{data, 7, 16};
+  for (size_t s = 0; s < 7; ++s) batch.slot(s)[0] = s;
+  {
+    CountAllocations count;
+    EXPECT_EQ(batch.Eval(program), EvalStatus::Ok);
+  }
+  EXPECT_EQ(allocations, 0);
+  float lane[7];
+  for (size_t s = 0; s < 7; ++s) lane[s] = batch.slot(s)[0];
+  EXPECT_THAT(lane, ElementsAre(0, 1, 4, 2, 5, 3, 6));
+}
+
+}
+}
@@ -0,0 +1,198 @@
+#include <WickedWinchProtocol/Postfix.h>
+#include <WickedWinchProtocol/Simd.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::FloatEq;
+using ::testing::FloatNear;
+using ::testing::Pointwise;
+
+namespace wickedwinch::protocol {
+namespace {
+
+struct TestStack : PostfixStack {
+  std::vector<float> buffer;
+
+  TestStack(std::vector<float> values) : buffer(4 * values.size() + 16) {
+    stack_data = buffer.data();
+    stack_size = 0;
+    stack_capacity = buffer.size();
+    for (float value : values) push(value);
+  }
+
+  std::vector<float> values() const { return {begin(), end()}; }
+};
+
+std::vector<float> Inputs(size_t n) {
+  std::vector<float> v(n);
+  for (size_t i = 0; i < n; ++i) v[i] = 0.25f + 0.5f * float((i * 5) % 11);
+  return v;
+}
+
+std::vector<float> Eval(PostfixOp op, std::initializer_list<uint8_t> i, const std::vector<float>& inputs) {
+  PostfixWriter writer;
+  writer.add_op(op);
+  for (uint8_t v : i) writer.add_i(v);
+  TestStack stack(inputs);
+  EXPECT_EQ(stack.Eval(writer), EvalStatus::Ok);
+  return stack.values();
+}
+
+class SimdTest : public ::testing::TestWithParam<SimdLevel> {
+protected:
+  void SetUp() override {
+    if (GetParam() > SupportedSimdLevel()) GTEST_SKIP() << "not supported";
+    SetSimdLevel(GetParam());
+  }
+
+  void TearDown() override { SetSimdLevel(SupportedSimdLevel()); }
+};
+
+// Sizes around every register width, so both the vector loop and the tail
+// run.
+constexpr uint8_t kSizes[] = {1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33};
+
+TEST_P(SimdTest, Elementwise) {
+  for (uint8_t n : kSizes) {
+    SCOPED_TRACE(int(n));
+    std::vector<float> in = Inputs(3 * n + 1);
+    const float* x = &in[1];
+    const float* y = &in[1 + n];
+    const float* z = &in[1 + 2 * n];
+    float t = in[0];
+
+    std::vector<float> add(in.begin(), in.begin() + 1 + n), sub = add, mul = add, mad = add, axpy;
+    std::vector<float> scale(in.begin(), in.begin() + 1 + n), neg = scale, lerp(1, 0);
+    for (size_t i = 0; i < n; ++i) {
+      add[1 + i] = x[i] + y[i];
+      sub[1 + i] = x[i] - y[i];
+      mul[1 + i] = x[i] * y[i];
+      mad[1 + i] = x[i] * y[i] + z[i];
+      neg[1 + i] = -x[i];
+    }
+    scale.assign(n, 0);
+    for (size_t i = 0; i < n; ++i) scale[i] = t * x[i];
+    lerp.assign(n, 0);
+    for (size_t i = 0; i < n; ++i) lerp[i] = (1-t)*x[i] + t*y[i];
+
+    std::vector<float> two(in.begin(), in.begin() + 1 + 2 * n);
+    std::vector<float> one(in.begin(), in.begin() + 1 + n);
+    EXPECT_THAT(Eval(PostfixOp::AddVec, {uint8_t(n << 1)}, two), Pointwise(FloatEq(), add));
+    EXPECT_THAT(Eval(PostfixOp::SubVec, {uint8_t(n << 1)}, two), Pointwise(FloatEq(), sub));
+    EXPECT_THAT(Eval(PostfixOp::MulVec, {uint8_t(n << 1)}, two), Pointwise(FloatEq(), mul));
+    EXPECT_THAT(Eval(PostfixOp::MulAddVec, {uint8_t(n << 2)}, in), Pointwise(FloatEq(), mad));
+    EXPECT_THAT(Eval(PostfixOp::ScaleVec, {uint8_t(n << 1)}, one), Pointwise(FloatEq(), scale));
+    EXPECT_THAT(Eval(PostfixOp::NegVec, {uint8_t(n << 1)}, one), Pointwise(FloatEq(), neg));
+    EXPECT_THAT(Eval(PostfixOp::Lerp, {uint8_t(n << 2)}, two), Pointwise(FloatEq(), lerp));
+
+    float norm = 0;
+    for (size_t i = 0; i < n; ++i) norm += x[i] * x[i];
+    std::vector<float> norm_in(x, x + n);
+    EXPECT_THAT(Eval(PostfixOp::NormVec, {uint8_t(n << 1)}, norm_in),
+                Pointwise(FloatNear(1e-5f * std::sqrt(norm)), std::vector<float>{std::sqrt(norm)}));
+  }
+}
+
+// Checks Horner evaluation against a double precision power sum, within the
+// documented 2(n-1) ulp of sum |c_i t^i|.
+TEST_P(SimdTest, Polynomials) {
+  for (uint8_t rows : {1, 2, 4, 6, 9}) {
+    for (uint8_t cols : {1, 3, 6, 8, 11}) {
+      SCOPED_TRACE(testing::Message() << int(rows) << "x" << int(cols));
+      std::vector<float> in = Inputs(1 + rows * cols);
+      for (size_t i = 1; i < in.size(); i += 3) in[i] = -in[i];
+      in[0] = -0.7f;
+
+      // Column j of the expected values and its error bound.
+      auto expected = [&](size_t j) {
+        double sum = 0, abs_sum = 0, p = 1;
+        for (size_t i = 0; i < rows; ++i) {
+          double term = in[1 + cols * i + j] * p;
+          sum += term;
+          abs_sum += std::abs(term);
+          p *= in[0];
+        }
+        double ulp = abs_sum * std::ldexp(1.0, -23);
+        return std::pair(sum, 2 * std::max(rows - 1, 1) * ulp);
+      };
+
+      std::vector<float> out = Eval(PostfixOp::PolyMat, {rows, uint8_t(cols << 1)}, in);
+      ASSERT_EQ(out.size(), cols);
+      for (size_t j = 0; j < cols; ++j) {
+        auto [sum, bound] = expected(j);
+        EXPECT_NEAR(out[j], sum, bound) << "column " << j;
+      }
+
+      std::vector<float> column{in[0]};
+      for (size_t i = 0; i < rows; ++i) column.push_back(in[1 + cols * i]);
+      std::vector<float> vec = Eval(PostfixOp::PolyVec, {uint8_t(rows << 1)}, column);
+      ASSERT_EQ(vec.size(), 1);
+      auto [sum, bound] = expected(0);
+      EXPECT_NEAR(vec[0], sum, bound);
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Levels, SimdTest,
+    ::testing::Values(SimdLevel::Scalar, SimdLevel::Sse, SimdLevel::Avx2));
+
+TEST(SimdLevelTest, Clamped) {
+  SetSimdLevel(SimdLevel::Avx2);
+  EXPECT_EQ(ActiveSimdLevel(), SupportedSimdLevel());
+  SetSimdLevel(SimdLevel::Scalar);
+  EXPECT_EQ(ActiveSimdLevel(), SimdLevel::Scalar);
+  SetSimdLevel(SupportedSimdLevel());
+}
+
+// Reference row-major product.
+std::vector<float> MulMat(const float* a, const float* b, size_t arows, size_t brows, size_t bcols) {
+  std::vector<float> c(arows * bcols);
+  for (size_t i = 0; i < arows; ++i) {
+    for (size_t j = 0; j < bcols; ++j) {
+      float r = 0;
+      for (size_t k = 0; k < brows; ++k) r += a[brows * i + k] * b[bcols * k + j];
+      c[bcols * i + j] = r;
+    }
+  }
+  return c;
+}
+
+TEST(MatrixTest, MulMatShapes) {
+  for (auto [arows, brows, bcols] : std::vector<std::array<uint8_t, 3>>{
+      {2, 2, 2}, {3, 3, 3}, {4, 4, 4}, {3, 3, 1}, {4, 4, 1}, {2, 3, 4}, {5, 5, 5},
+      // Wide products that share the low bits of a fixed shape's columns.
+      {2, 2, 34}, {3, 3, 51}, {3, 3, 49}, {4, 4, 68}, {4, 4, 65}, {0, 0, 34}}) {
+    SCOPED_TRACE(testing::Message() << int(arows) << "x" << int(brows) << "x" << int(bcols));
+    std::vector<float> in = Inputs(1 + arows * brows + brows * bcols);
+    std::vector<float> expected = MulMat(&in[1], &in[1 + arows * brows], arows, brows, bcols);
+    expected.insert(expected.begin(), in[0]);
+    EXPECT_THAT(Eval(PostfixOp::MulMat, {arows, brows, uint8_t(bcols << 1)}, in),
+                Pointwise(FloatEq(), expected));
+  }
+}
+
+TEST(MatrixTest, TransposeShapes) {
+  for (auto [rows, cols] : std::vector<std::array<uint8_t, 2>>{
+      {2, 2}, {3, 3}, {4, 4}, {3, 1}, {1, 4}, {2, 3}, {5, 5}}) {
+    SCOPED_TRACE(testing::Message() << int(rows) << "x" << int(cols));
+    std::vector<float> in = Inputs(1 + rows * cols);
+    std::vector<float> expected(in.size());
+    expected[0] = in[0];
+    for (size_t i = 0; i < rows; ++i) {
+      for (size_t j = 0; j < cols; ++j) expected[1 + rows * j + i] = in[1 + cols * i + j];
+    }
+    EXPECT_THAT(Eval(PostfixOp::Transpose, {rows, uint8_t(cols << 1)}, in),
+                Pointwise(FloatEq(), expected));
+  }
+}
+
+}
+}
@@ -0,0 +1,380 @@
+// Drives a device, or WickedWinchProtocol_sim, with protocol traffic and
+// reports throughput and latency.
+//
+//   WickedWinchProtocol_loadgen (--socket PATH | --simulator SIM)
+//       [--targets N] [--seconds S] [--cue-hz HZ] [--segments N]
+//       [--ping-window N] [--tick-hz HZ] [--status-hz HZ]
+//
+// A cue sends every target a new path of the given number of segments in
+// one MessageBatch, followed by a ping; the time until that ping's response
+// is the path upload latency, as the device handles messages in order.
+// Between cues, pings are sent as fast as the device answers them, with up
+// to ping-window outstanding, which measures message throughput and round
+// trip time. Tick jitter is the spread of the intervals between target 0's
+// status messages around the status period.
+//
+// With --simulator, the simulator is started on a socketpair with the same
+// targets, tick and status rates. Exits with status 1 if no pings, uploads
+// or status messages made the round trip.
+
+#include <WickedWinchProtocol/Message.h>
+#include <WickedWinchProtocol/MessageBatch.h>
+#include <WickedWinchProtocol/MessageDispatch.h>
+#include <WickedWinchProtocol/MessageFramer.h>
+#include <WickedWinchProtocol/PathBuilder.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace wickedwinch::protocol {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  const char* socket_path = nullptr;
+  const char* simulator = nullptr;
+  size_t targets = 8;
+  double seconds = 5;
+  uint32_t cue_hz = 10;
+  size_t segments = 16;
+  uint32_t ping_window = 64;
+  uint32_t tick_hz = 1000;
+  uint32_t status_hz = 100;
+};
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const char* arg = argv[i];
+    const char* value = argv[i + 1];
+    if (std::strcmp(arg, "--socket") == 0) {
+      options.socket_path = value;
+    } else if (std::strcmp(arg, "--simulator") == 0) {
+      options.simulator = value;
+    } else if (std::strcmp(arg, "--targets") == 0) {
+      options.targets = std::strtoul(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--seconds") == 0) {
+      options.seconds = std::strtod(value, nullptr);
+    } else if (std::strcmp(arg, "--cue-hz") == 0) {
+      options.cue_hz = std::strtoul(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--segments") == 0) {
+      options.segments = std::strtoul(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--ping-window") == 0) {
+      options.ping_window = std::strtoul(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--tick-hz") == 0) {
+      options.tick_hz = std::strtoul(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--status-hz") == 0) {
+      options.status_hz = std::strtoul(value, nullptr, 10);
+    } else {
+      return false;
+    }
+  }
+  return argc % 2 == 1 && (options.socket_path != nullptr) != (options.simulator != nullptr) &&
+      options.targets >= 1 && options.targets <= 255 && options.seconds > 0 &&
+      options.cue_hz >= 1 && options.segments >= 1 &&
+      options.ping_window >= 1 && options.ping_window <= 4096 &&
+      options.tick_hz >= 1 && options.status_hz >= 1 && options.status_hz <= options.tick_hz;
+}
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+bool WriteAll(int fd, std::span<const uint8_t> data) {
+  while (!data.empty()) {
+    ssize_t written = write(fd, data.data(), data.size());
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data = data.subspan(written);
+  }
+  return true;
+}
+
+// Connects to the device, or starts the simulator on a socketpair. Returns
+// the socket, or -1.
+int Connect(const Options& options, pid_t& child) {
+  child = -1;
+  if (options.socket_path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, options.socket_path, sizeof(address.sun_path) - 1);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+      std::perror("loadgen: connect");
+      return -1;
+    }
+    return fd;
+  }
+
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+    std::perror("loadgen: socketpair");
+    return -1;
+  }
+  std::string targets = std::to_string(options.targets);
+  std::string tick_hz = std::to_string(options.tick_hz);
+  std::string status_hz = std::to_string(options.status_hz);
+  child = fork();
+  if (child < 0) {
+    std::perror("loadgen: fork");
+    return -1;
+  }
+  if (child == 0) {
+    dup2(fds[1], STDIN_FILENO);
+    dup2(fds[1], STDOUT_FILENO);
+    close(fds[0]);
+    close(fds[1]);
+    const char* args[] = {
+        options.simulator, "--stdio", "--targets", targets.c_str(),
+        "--tick-hz", tick_hz.c_str(), "--status-hz", status_hz.c_str(), nullptr};
+    execv(options.simulator, const_cast<char**>(args));
+    std::perror("loadgen: exec");
+    _exit(127);
+  }
+  close(fds[1]);
+  return fds[0];
+}
+
+// Samples in us, summarized by percentile.
+class Samples {
+public:
+  void add(double value) { values_.push_back(value); }
+  size_t size() const { return values_.size(); }
+  std::span<const double> values() const { return values_; }
+
+  double percentile(double p) {
+    if (values_.empty()) return 0;
+    size_t i = std::min(values_.size() - 1, size_t(p * values_.size()));
+    std::nth_element(values_.begin(), values_.begin() + i, values_.end());
+    return values_[i];
+  }
+
+  void Print(const char* name) {
+    std::printf("%-20s n %8zu  p50 %9.1f  p99 %9.1f  max %9.1f\n",
+        name, size(), percentile(0.5), percentile(0.99), percentile(1.0));
+  }
+
+private:
+  std::vector<double> values_;
+};
+
+// Ping ids with this bit set follow a cue's paths.
+constexpr uint32_t kCuePing = 0x80000000;
+// Send times of outstanding pings and cues, indexed by id.
+constexpr size_t kSlots = 8192;
+
+// Reads and handles everything the device sends, on its own thread.
+class Receiver {
+public:
+  explicit Receiver(int fd) : fd_(fd) {}
+
+  void Run() {
+    MessageFramer framer;
+    while (true) {
+      std::span<uint8_t> space = framer.write_span();
+      ssize_t size = read(fd_, space.data(), space.size());
+      if (size < 0 && errno == EINTR) continue;
+      if (size <= 0) break;
+      framer.Commit(size);
+      bytes += size;
+      for (std::span<const uint8_t> message = framer.Next(); !message.empty(); message = framer.Next()) {
+        ++messages;
+        if (DispatchMessage(message, *this) == 0) ++bad_messages;
+      }
+    }
+    closed.store(true, std::memory_order_release);
+    events.fetch_add(1, std::memory_order_release);
+    events.notify_one();
+  }
+
+  void operator()(MessageTag<WickedMessageType_PingResponse>, uint8_t, const WickedPingResponse& ping) {
+    int64_t now = NowNs();
+    uint32_t id = ping.ping_id & ~kCuePing;
+    if (ping.ping_id & kCuePing) {
+      upload_us.add((now - cue_send_ns[id % kSlots].load(std::memory_order_relaxed)) * 1e-3);
+      cues_answered.fetch_add(1, std::memory_order_release);
+    } else {
+      ping_us.add((now - ping_send_ns[id % kSlots].load(std::memory_order_relaxed)) * 1e-3);
+      pings_answered.fetch_add(1, std::memory_order_release);
+      events.fetch_add(1, std::memory_order_release);
+      events.notify_one();
+    }
+  }
+
+  void operator()(MessageTag<WickedMessageType_NotifyWinchStatus>, uint8_t target_id, const WickedWinchStatus&) {
+    ++statuses;
+    if (target_id != 0) return;
+    int64_t now = NowNs();
+    if (last_status_ns_ != 0) status_interval_us.add((now - last_status_ns_) * 1e-3);
+    last_status_ns_ = now;
+  }
+
+  void operator()(MessageTag<WickedMessageType_NotifyBmpStatus>, uint8_t, const WickedBmpStatus&) { ++statuses; }
+
+  // Written by the sender before it sends the ping or cue.
+  std::atomic<int64_t> ping_send_ns[kSlots] = {};
+  std::atomic<int64_t> cue_send_ns[kSlots] = {};
+  std::atomic<uint64_t> pings_answered = 0;
+  std::atomic<uint64_t> cues_answered = 0;
+  // Counts ping responses and the end of the stream, for the sender to wait
+  // on.
+  std::atomic<uint64_t> events = 0;
+  std::atomic<bool> closed = false;
+
+  // Read once the receiver has stopped.
+  uint64_t messages = 0;
+  uint64_t bytes = 0;
+  uint64_t bad_messages = 0;
+  uint64_t statuses = 0;
+  Samples ping_us;
+  Samples upload_us;
+  Samples status_interval_us;
+
+private:
+  int fd_;
+  int64_t last_status_ns_ = 0;
+};
+
+// Builds target's path for a cue: a cubic ease per segment over one second.
+void BuildPath(PathBuilder& builder, size_t segments, size_t target, uint32_t cue) {
+  builder.reset();
+  for (size_t s = 0; s < segments; ++s) {
+    builder.BeginSegment(s * 1000);
+    builder.add_op(PostfixOp::PolyVec);
+    builder.add_i(4 << 1 | 1);
+    float base = float(cue % 100) + float(target) + float(s);
+    for (float c : {base, 0.5f, 0.25f, -0.125f}) builder.add_f(c);
+  }
+}
+
+int Run(const Options& options) {
+  pid_t child;
+  int fd = Connect(options, child);
+  if (fd < 0) return 1;
+
+  auto receiver = std::make_unique<Receiver>(fd);
+  std::thread receive_thread([&] { receiver->Run(); });
+
+  std::vector<std::vector<uint8_t>> paths(options.targets);
+  PathBuilder builder;
+  MessageBatch batch;
+  MessageWriter writer;
+  uint64_t messages_sent = 0;
+  uint64_t bytes_sent = 0;
+  uint32_t next_ping = 0;
+  uint32_t cues = 0;
+  bool ok = true;
+
+  Clock::time_point start = Clock::now();
+  Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.seconds));
+  Clock::duration cue_period = std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) / options.cue_hz;
+  Clock::time_point next_cue = start;
+  while (ok && !receiver->closed.load() && Clock::now() < end) {
+    if (Clock::now() >= next_cue) {
+      batch.clear();
+      for (size_t t = 0; t < options.targets; ++t) {
+        BuildPath(builder, options.segments, t, cues);
+        builder.Write(paths[t]);
+        batch.AddWinchPath(t, WickedWinchMode_LinearPosition, paths[t]);
+      }
+      WickedPingRequest ping = {cues | kCuePing};
+      batch.Add(0, WickedMessageType_PingRequest, {reinterpret_cast<const uint8_t*>(&ping), sizeof(ping)});
+      receiver->cue_send_ns[cues % kSlots].store(NowNs(), std::memory_order_relaxed);
+      ok = batch.Flush(fd);
+      messages_sent += batch.message_size();
+      bytes_sent += batch.data_size();
+      ++cues;
+      next_cue += cue_period;
+      continue;
+    }
+
+    // Fill the ping window, then wait for a response.
+    uint64_t events = receiver->events.load(std::memory_order_acquire);
+    uint64_t answered = receiver->pings_answered.load(std::memory_order_acquire);
+    writer.clear();
+    while (next_ping - answered < options.ping_window) {
+      receiver->ping_send_ns[next_ping % kSlots].store(NowNs(), std::memory_order_relaxed);
+      writer.Write(next_ping % options.targets, WickedPingRequest{next_ping});
+      ++next_ping;
+      ++messages_sent;
+    }
+    if (!writer.data().empty()) {
+      ok = WriteAll(fd, writer.data());
+      bytes_sent += writer.data().size();
+    }
+    receiver->events.wait(events, std::memory_order_acquire);
+  }
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  // Let outstanding responses arrive, then close our side so the device
+  // sees the end of the stream.
+  Clock::time_point drain = Clock::now() + std::chrono::seconds(1);
+  while (Clock::now() < drain &&
+      (receiver->pings_answered.load() < next_ping || receiver->cues_answered.load() < cues)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  shutdown(fd, SHUT_WR);
+  if (child < 0) shutdown(fd, SHUT_RD);
+  receive_thread.join();
+  close(fd);
+  if (child > 0) waitpid(child, nullptr, 0);
+
+  std::printf("targets %zu, %zu segments per path, %u cues/s, ping window %u, %.2f s\n",
+      options.targets, options.segments, options.cue_hz, options.ping_window, elapsed);
+  std::printf("sent     %10llu msgs %12.0f msgs/s %8.1f MB/s\n",
+      (unsigned long long)messages_sent, messages_sent / elapsed, bytes_sent / elapsed * 1e-6);
+  std::printf("received %10llu msgs %12.0f msgs/s %8.1f MB/s (%llu bad)\n",
+      (unsigned long long)receiver->messages, receiver->messages / elapsed, receiver->bytes / elapsed * 1e-6,
+      (unsigned long long)receiver->bad_messages);
+  std::printf("pings answered %llu of %u, cues answered %llu of %u, %llu status messages\n",
+      (unsigned long long)receiver->pings_answered.load(), next_ping,
+      (unsigned long long)receiver->cues_answered.load(), cues,
+      (unsigned long long)receiver->statuses);
+  receiver->ping_us.Print("ping rtt (us)");
+  receiver->upload_us.Print("path upload (us)");
+  double period_us = 1e6 / options.status_hz;
+  Samples jitter_us;
+  for (double interval : receiver->status_interval_us.values()) jitter_us.add(std::abs(interval - period_us));
+  std::printf("status period %.1f us\n", period_us);
+  receiver->status_interval_us.Print("status interval (us)");
+  jitter_us.Print("tick jitter (us)");
+
+  bool answered = receiver->pings_answered.load() > 0 && receiver->cues_answered.load() > 0 && receiver->statuses > 0;
+  return ok && answered ? 0 : 1;
+}
+
+}
+}
+
+int main(int argc, char** argv) {
+  using namespace wickedwinch::protocol;
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    std::fprintf(stderr,
+        "usage: %s (--socket PATH | --simulator SIM) [--targets N (1-255)] [--seconds S]\n"
+        "    [--cue-hz HZ] [--segments N] [--ping-window N (1-4096)] [--tick-hz HZ] [--status-hz HZ]\n",
+        argv[0]);
+    return 2;
+  }
+  std::signal(SIGPIPE, SIG_IGN);
+  return Run(options);
+}
@@ -0,0 +1,374 @@
+// Emulates winch and DMX targets speaking the WickedMessage protocol, for
+// load testing without hardware.
+//
+//   WickedWinchProtocol_sim [--socket PATH | --stdio] [--targets N]
+//       [--tick-hz HZ] [--status-hz HZ]
+//
+// Every tick, each target with a path evaluates it at the device time, in
+// ms since the connection opened. Every status period, each target sends a
+// NotifyWinchStatus with the path's first value as its position, and
+// target 0 sends a NotifyBmpStatus. Pings are answered with the device time,
+// and paths, configs and target lists can be set and queried as on a device.
+// Messages are handled in order, so a ping answered after a SetWinchPath
+// means the path has been loaded.
+//
+// With --socket, connections to the Unix socket are served one at a time
+// until the process is killed. With --stdio, one connection on stdin and
+// stdout is served until it closes.
+
+#include <WickedWinchProtocol/Message.h>
+#include <WickedWinchProtocol/MessageDispatch.h>
+#include <WickedWinchProtocol/MessageFramer.h>
+#include <WickedWinchProtocol/Path.h>
+#include <WickedWinchProtocol/PathProgram.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace wickedwinch::protocol {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  const char* socket_path = nullptr;
+  bool stdio = false;
+  size_t targets = 8;
+  uint32_t tick_hz = 1000;
+  uint32_t status_hz = 100;
+};
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (std::strcmp(arg, "--stdio") == 0) {
+      options.stdio = true;
+      continue;
+    }
+    if (value == nullptr) return false;
+    if (std::strcmp(arg, "--socket") == 0) {
+      options.socket_path = value;
+    } else if (std::strcmp(arg, "--targets") == 0) {
+      options.targets = std::strtoul(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--tick-hz") == 0) {
+      options.tick_hz = std::strtoul(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--status-hz") == 0) {
+      options.status_hz = std::strtoul(value, nullptr, 10);
+    } else {
+      return false;
+    }
+    ++i;
+  }
+  return (options.socket_path != nullptr) != options.stdio &&
+      options.targets >= 1 && options.targets <= 255 &&
+      options.tick_hz >= 1 && options.status_hz >= 1 && options.status_hz <= options.tick_hz;
+}
+
+bool WriteAll(int fd, std::span<const uint8_t> data) {
+  while (!data.empty()) {
+    ssize_t written = write(fd, data.data(), data.size());
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data = data.subspan(written);
+  }
+  return true;
+}
+
+// A path a target has been sent, with its playback state.
+struct TargetPath {
+  bool Load(std::span<const uint8_t> path_data) {
+    buffer.assign(path_data.begin(), path_data.end());
+    PathReader reader;
+    loaded = reader.Read(buffer);
+    if (loaded) program.Load(reader);
+    cursor = {};
+    return loaded;
+  }
+
+  std::vector<uint8_t> buffer;
+  PathProgram program;
+  PathCursor cursor;
+  bool loaded = false;
+};
+
+struct Target {
+  TargetPath winch;
+  TargetPath dmx;
+  uint8_t mode = WickedWinchMode_Disengage;
+  float position = 0;
+  WickedWinchConfig winch_config = {200, 4000, 0.1f};
+  uint8_t dmx_channel_offset = 0;
+  std::vector<uint8_t> dmx_channel_map;
+};
+
+struct Stats {
+  uint64_t ticks = 0;
+  uint64_t late_ticks = 0;
+  Clock::duration max_lateness = {};
+  uint64_t messages_in = 0;
+  uint64_t messages_out = 0;
+  uint64_t paths_loaded = 0;
+  uint64_t bad_messages = 0;
+  uint64_t eval_errors = 0;
+};
+
+class Simulator {
+public:
+  explicit Simulator(const Options& options)
+      : options_(options), targets_(options.targets),
+        tick_period_(std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) / options.tick_hz),
+        status_ticks_(options.tick_hz / options.status_hz) {
+    stack_.stack_data = stack_buffer_;
+    stack_.stack_size = 0;
+    stack_.stack_capacity = std::size(stack_buffer_);
+  }
+
+  const Stats& stats() const { return stats_; }
+
+  // Serves one connection until the peer closes it. Returns false on an I/O
+  // error.
+  bool Serve(int in_fd, int out_fd) {
+    start_ = Clock::now();
+    Clock::time_point next_tick = start_;
+    framer_.clear();
+    writer_.clear();
+    for (Target& target : targets_) target = Target();
+
+    while (true) {
+      Clock::time_point now = Clock::now();
+      if (now >= next_tick) {
+        Clock::duration lateness = now - next_tick;
+        stats_.max_lateness = std::max(stats_.max_lateness, lateness);
+        if (lateness >= tick_period_) ++stats_.late_ticks;
+        Tick();
+        next_tick += tick_period_;
+        // Skip the ticks missed after a long stall rather than bursting them.
+        if (now - next_tick > 100 * tick_period_) next_tick = now + tick_period_;
+      } else {
+        auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(next_tick - now);
+        timespec timeout = {time_t(wait.count() / 1000000000), long(wait.count() % 1000000000)};
+        pollfd fd = {in_fd, POLLIN, 0};
+        int ready = ppoll(&fd, 1, &timeout, nullptr);
+        if (ready < 0 && errno != EINTR) return false;
+        if (ready > 0) {
+          std::span<uint8_t> space = framer_.write_span();
+          ssize_t size = read(in_fd, space.data(), space.size());
+          if (size < 0 && errno != EINTR) return false;
+          if (size == 0) return WriteAll(out_fd, writer_.data());
+          if (size > 0) framer_.Commit(size);
+          for (std::span<const uint8_t> message = framer_.Next(); !message.empty(); message = framer_.Next()) {
+            ++stats_.messages_in;
+            if (DispatchMessage(message, *this) == 0) ++stats_.bad_messages;
+          }
+        }
+      }
+      if (!writer_.data().empty()) {
+        if (!WriteAll(out_fd, writer_.data())) return false;
+        writer_.clear();
+      }
+    }
+  }
+
+  // Message handlers, called by DispatchMessage.
+  void operator()(MessageTag<WickedMessageType_PingRequest>, uint8_t target_id, const WickedPingRequest& ping) {
+    Reply(writer_.Write(target_id, WickedPingResponse{ping.ping_id, device_time()}));
+  }
+
+  void operator()(MessageTag<WickedMessageType_SetWinchPath>, uint8_t target_id, const MessageWinchPath& path) {
+    if (Target* target = target_at(target_id)) {
+      target->mode = path.mode;
+      LoadPath(target->winch, path.path_data);
+    }
+  }
+
+  void operator()(MessageTag<WickedMessageType_SetDmxPath>, uint8_t target_id, std::span<const uint8_t> path_data) {
+    if (Target* target = target_at(target_id)) LoadPath(target->dmx, path_data);
+  }
+
+  void operator()(MessageTag<WickedMessageType_GetWinchTargetsRequest>, uint8_t, MessageNoPayload) {
+    Reply(writer_.WriteTargets(0, WickedMessageType_GetWinchTargetsResponse, target_ids()));
+  }
+
+  void operator()(MessageTag<WickedMessageType_GetDmxTargetsRequest>, uint8_t, MessageNoPayload) {
+    Reply(writer_.WriteTargets(0, WickedMessageType_GetDmxTargetsResponse, target_ids()));
+  }
+
+  void operator()(MessageTag<WickedMessageType_GetWinchConfigRequest>, uint8_t target_id, MessageNoPayload) {
+    if (Target* target = target_at(target_id)) {
+      Reply(writer_.Write(target_id, WickedMessageType_GetWinchConfigResponse, target->winch_config));
+    }
+  }
+
+  void operator()(MessageTag<WickedMessageType_SetWinchConfig>, uint8_t target_id, const WickedWinchConfig& config) {
+    if (Target* target = target_at(target_id)) target->winch_config = config;
+  }
+
+  void operator()(MessageTag<WickedMessageType_GetDmxConfigRequest>, uint8_t target_id, MessageNoPayload) {
+    if (Target* target = target_at(target_id)) {
+      Reply(writer_.WriteDmxConfig(
+          target_id, WickedMessageType_GetDmxConfigResponse,
+          target->dmx_channel_offset, target->dmx_channel_map));
+    }
+  }
+
+  void operator()(MessageTag<WickedMessageType_SetDmxConfig>, uint8_t target_id, const MessageDmxConfig& config) {
+    if (Target* target = target_at(target_id)) {
+      target->dmx_channel_offset = config.channel_offset;
+      target->dmx_channel_map.assign(config.channel_map.begin(), config.channel_map.end());
+    }
+  }
+
+  // Messages a device does not accept.
+  void operator()(WickedMessageType, uint8_t, std::span<const uint8_t>) { ++stats_.bad_messages; }
+
+private:
+  uint32_t device_time() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start_).count();
+  }
+
+  Target* target_at(uint8_t target_id) {
+    if (target_id >= targets_.size()) {
+      ++stats_.bad_messages;
+      return nullptr;
+    }
+    return &targets_[target_id];
+  }
+
+  std::vector<uint8_t> target_ids() const {
+    std::vector<uint8_t> ids(targets_.size());
+    for (size_t i = 0; i < ids.size(); ++i) ids[i] = i;
+    return ids;
+  }
+
+  void Reply(bool written) {
+    if (written) ++stats_.messages_out;
+  }
+
+  void LoadPath(TargetPath& path, std::span<const uint8_t> path_data) {
+    if (path.Load(path_data)) {
+      ++stats_.paths_loaded;
+    } else {
+      ++stats_.bad_messages;
+    }
+  }
+
+  // Evaluates the path at t, returning its first value in value.
+  bool Eval(TargetPath& path, uint32_t t, float& value) {
+    if (!path.loaded) return false;
+    if (path.program.Eval(t, path.cursor, stack_) != EvalStatus::Ok || stack_.stack_size == 0) {
+      ++stats_.eval_errors;
+      return false;
+    }
+    value = stack_.stack_data[0];
+    return true;
+  }
+
+  void Tick() {
+    uint32_t t = device_time();
+    bool status = stats_.ticks % status_ticks_ == 0;
+    ++stats_.ticks;
+    for (size_t i = 0; i < targets_.size(); ++i) {
+      Target& target = targets_[i];
+      float value;
+      if (target.mode != WickedWinchMode_Disengage && Eval(target.winch, t, value)) target.position = value;
+      Eval(target.dmx, t, value);
+      if (status) {
+        uint8_t flags = target.winch.loaded ? WickedWinchStatusFlag_PositionKnown : 0;
+        uint32_t position = uint32_t(int32_t(std::lround(target.position)));
+        Reply(writer_.Write(i, WickedWinchStatus{t, position, flags}));
+      }
+    }
+    if (status) {
+      float celsius = 21.0f + 0.5f * std::sin(t * 1e-4f);
+      Reply(writer_.Write(0, WickedBmpStatus{t, celsius, 101325.0f}));
+    }
+  }
+
+  Options options_;
+  std::vector<Target> targets_;
+  Clock::duration tick_period_;
+  uint64_t status_ticks_;
+  Clock::time_point start_;
+
+  MessageFramer framer_;
+  MessageWriter writer_;
+  PostfixStack stack_;
+  float stack_buffer_[64];
+  Stats stats_;
+};
+
+void PrintStats(const Stats& stats) {
+  std::fprintf(stderr,
+      "sim: %llu ticks, %llu late, max lateness %.1f us; "
+      "%llu messages in, %llu out; %llu paths loaded, %llu bad messages, %llu eval errors\n",
+      (unsigned long long)stats.ticks, (unsigned long long)stats.late_ticks,
+      std::chrono::duration<double, std::micro>(stats.max_lateness).count(),
+      (unsigned long long)stats.messages_in, (unsigned long long)stats.messages_out,
+      (unsigned long long)stats.paths_loaded, (unsigned long long)stats.bad_messages,
+      (unsigned long long)stats.eval_errors);
+}
+
+int ServeSocket(Simulator& simulator, const char* path) {
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (std::strlen(path) >= sizeof(address.sun_path)) {
+    std::fprintf(stderr, "sim: socket path too long\n");
+    return 1;
+  }
+  std::strcpy(address.sun_path, path);
+  unlink(path);
+  if (listener < 0 ||
+      bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+      listen(listener, 1) < 0) {
+    std::perror("sim: listen");
+    return 1;
+  }
+  while (true) {
+    int fd = accept(listener, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR) continue;
+      std::perror("sim: accept");
+      return 1;
+    }
+    if (!simulator.Serve(fd, fd)) std::perror("sim: connection");
+    close(fd);
+    PrintStats(simulator.stats());
+  }
+}
+
+}
+}
+
+int main(int argc, char** argv) {
+  using namespace wickedwinch::protocol;
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    std::fprintf(stderr,
+        "usage: %s (--socket PATH | --stdio) [--targets N (1-255)] [--tick-hz HZ] [--status-hz HZ]\n",
+        argv[0]);
+    return 2;
+  }
+  std::signal(SIGPIPE, SIG_IGN);
+
+  Simulator simulator(options);
+  if (options.socket_path) return ServeSocket(simulator, options.socket_path);
+  bool ok = simulator.Serve(STDIN_FILENO, STDOUT_FILENO);
+  PrintStats(simulator.stats());
+  return ok ? 0 : 1;
+}